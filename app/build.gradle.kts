@@ -77,6 +77,11 @@ android {
         }
     }
     
+    // Bundled GGUF models must stay uncompressed so they can be mapped and copied without extraction
+    androidResources {
+        noCompress += "gguf"
+    }
+    
     // Packaging options for native libraries
     packaging {
         jniLibs {
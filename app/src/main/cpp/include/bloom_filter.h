@@ -0,0 +1,60 @@
+#ifndef SCROLLGUARD_BLOOM_FILTER_H
+#define SCROLLGUARD_BLOOM_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/**
+ * Rotating blocked Bloom filter of content hashes known to be productive.
+ * Every probe for a key lands in one 64-byte block, so a check touches a
+ * single cache line. Two generations bound memory for long sessions: once the
+ * current generation holds its capacity it becomes the previous one and the
+ * oldest generation is cleared for reuse. Queries check both generations.
+ * False positives are possible, false negatives only right after a rotation.
+ */
+
+namespace scrollguard {
+
+class RotatingBloomFilter {
+public:
+    static constexpr size_t kDefaultCapacity = 16384;   // Keys per generation
+    static constexpr size_t kBitsPerKey = 12;
+    static constexpr int kProbes = 6;
+
+    explicit RotatingBloomFilter(size_t capacity = kDefaultCapacity);
+
+    // Process-wide filter shared by the JNI layer
+    static RotatingBloomFilter& instance();
+
+    bool might_contain(uint64_t key) const;
+    void insert(uint64_t key);
+    void clear();
+
+    size_t memory_bytes() const;
+
+private:
+    struct alignas(64) Block {
+        std::atomic<uint64_t> words[8];
+    };
+
+    struct Generation {
+        std::unique_ptr<Block[]> blocks;
+        std::atomic<size_t> count{0};
+    };
+
+    bool generation_contains(const Generation& generation, uint64_t key) const;
+    void rotate();
+
+    const size_t capacity_;
+    const size_t block_count_;
+    Generation generations_[2];
+    std::atomic<int> current_{0};
+    std::mutex rotate_mutex_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_BLOOM_FILTER_H
@@ -0,0 +1,55 @@
+#ifndef SCROLLGUARD_CONTENT_CANONICALIZER_H
+#define SCROLLGUARD_CONTENT_CANONICALIZER_H
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Canonicalizes post text before it is hashed into a cache key.
+ * Strips tokens that change between re-renders of the same post
+ * ("2m ago" -> "3m ago", "1.2K likes" -> "1.3K likes", trailing "See more")
+ * so re-renders map to the same key. Rules are configured per app package.
+ */
+
+namespace scrollguard {
+
+/**
+ * Volatile-token rules for one app
+ */
+struct CanonicalizerRules {
+    // Nouns that turn a preceding number into a volatile counter ("12 likes")
+    std::vector<std::string> count_nouns;
+    // UI suffixes dropped from the end of the text ("see more")
+    std::vector<std::string> trailing_phrases;
+    // Drop relative timestamps ("2h", "5 min ago", "yesterday"); "5 min" without "ago" is kept
+    bool strip_relative_times = true;
+    // Drop standalone abbreviated counters ("1.2k") that have no noun
+    bool strip_bare_counts = false;
+};
+
+class ContentCanonicalizer {
+public:
+    ContentCanonicalizer();
+
+    // Process-wide instance with the built-in per-app rules
+    static ContentCanonicalizer& instance();
+
+    std::string canonicalize(const std::string& content, const std::string& app_package) const;
+    uint64_t canonical_hash(const std::string& content, const std::string& app_package) const;
+
+    void set_rules(const std::string& app_package, const CanonicalizerRules& rules);
+
+    static CanonicalizerRules default_rules();
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, CanonicalizerRules> rules_by_package_;
+    CanonicalizerRules default_rules_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_CONTENT_CANONICALIZER_H
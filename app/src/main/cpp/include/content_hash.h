@@ -0,0 +1,120 @@
+#ifndef SCROLLGUARD_CONTENT_HASH_H
+#define SCROLLGUARD_CONTENT_HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * Fast 64-bit content hashing shared by the native caches.
+ * wyhash-style construction: 128-bit multiply-fold over 8-byte reads,
+ * good avalanche and far fewer collisions than Java's 32-bit String.hashCode().
+ */
+
+namespace scrollguard {
+namespace content_hash {
+
+constexpr uint64_t kSecret0 = 0x2d358dccaa6c78a5ull;
+constexpr uint64_t kSecret1 = 0x8bb84b93962eacc9ull;
+constexpr uint64_t kSecret2 = 0x4b33a62ed433d4a3ull;
+constexpr uint64_t kSecret3 = 0x4d5a2da51de1aa47ull;
+constexpr uint64_t kDefaultSeed = 0x5343524f4c4c4744ull; // "SCROLLGD"
+
+inline void multiply128(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = static_cast<__uint128_t>(*a) * *b;
+    *a = static_cast<uint64_t>(r);
+    *b = static_cast<uint64_t>(r >> 64);
+#else
+    // Portable fallback for 32-bit ABIs
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    multiply128(&a, &b);
+    return a ^ b;
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read_small(const uint8_t* p, size_t k) {
+    return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+inline uint64_t hash64(const void* data, size_t len, uint64_t seed = kDefaultSeed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    seed ^= mix(seed ^ kSecret0, kSecret1);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read_small(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read64(p) ^ kSecret1, read64(p + 8) ^ seed);
+                see1 = mix(read64(p + 16) ^ kSecret2, read64(p + 24) ^ see1);
+                see2 = mix(read64(p + 32) ^ kSecret3, read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read64(p) ^ kSecret1, read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+
+    a ^= kSecret1;
+    b ^= seed;
+    multiply128(&a, &b);
+    return mix(a ^ kSecret0 ^ len, b ^ kSecret1);
+}
+
+inline uint64_t hash_string(const std::string& s, uint64_t seed = kDefaultSeed) {
+    return hash64(s.data(), s.size(), seed);
+}
+
+/**
+ * Combine two hashes (e.g. content hash with a model or package hash)
+ */
+inline uint64_t combine(uint64_t h1, uint64_t h2) {
+    return mix(h1 ^ kSecret2, h2 ^ kSecret3);
+}
+
+} // namespace content_hash
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_CONTENT_HASH_H
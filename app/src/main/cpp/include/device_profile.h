@@ -0,0 +1,82 @@
+#ifndef SCROLLGUARD_DEVICE_PROFILE_H
+#define SCROLLGUARD_DEVICE_PROFILE_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Per-device model load profile.
+ * The CPU backend repacks Q4_0/IQ4_NL/Q8_0 (and on newer builds Q4_K)
+ * weights into interleaved layouts when extra buffer types are enabled.
+ * That costs load time and an anonymous copy of the weights on every
+ * start, and only pays off on some CPU/model pairs. The first load on a
+ * device measures both layouts and records the winner in a small sidecar
+ * next to the model, keyed by the model's SHA-256 and the CPU feature set;
+ * later loads apply it without measuring again.
+ */
+
+namespace scrollguard {
+
+struct CpuFeatures {
+    std::string arch;       // "arm64", "x86_64", ...
+    bool dotprod = false;   // ARMv8.2 SDOT/UDOT
+    bool i8mm = false;      // ARMv8.6 SMMLA
+    bool sve = false;
+    bool fp16 = false;      // Half-precision arithmetic
+    bool avx2 = false;
+    bool avx512 = false;
+    int cores = 0;
+
+    // Stable description used as part of cache keys, e.g. "arm64+dotprod+i8mm/8"
+    std::string fingerprint() const;
+};
+
+namespace cpu_features {
+    // Detected once per process
+    const CpuFeatures& detect();
+}
+
+/**
+ * Measured cost of one weight layout
+ */
+struct LayoutTiming {
+    uint32_t load_ms = 0;
+    uint32_t eval_ms = 0;   // Prefill of the calibration prompt
+};
+
+struct WeightLayoutProfile {
+    std::string model_sha256;
+    uint64_t model_size = 0;
+    int64_t model_mtime = 0;
+    std::string cpu_fingerprint;
+
+    bool use_extra_bufts = true;
+    LayoutTiming repacked;
+    LayoutTiming mapped;
+};
+
+namespace device_profile {
+    // Classifications expected per process start, used to weigh load time against eval time
+    constexpr uint32_t kCallsPerLaunch = 32;
+
+    std::string profile_path(const std::string& model_path);
+
+    /**
+     * Load the profile for model_path if it was measured for this model
+     * content and CPU. A changed size/mtime triggers a rehash, so a copied
+     * but identical model keeps its profile.
+     */
+    bool load(const std::string& model_path, WeightLayoutProfile* profile);
+
+    /**
+     * Fill in identity fields (hashing the model) and write the profile
+     */
+    bool store(const std::string& model_path, WeightLayoutProfile* profile);
+
+    // Pick the layout with the lower expected cost per launch
+    bool prefer_repacked(const LayoutTiming& repacked, const LayoutTiming& mapped);
+}
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_DEVICE_PROFILE_H
@@ -0,0 +1,128 @@
+#ifndef SCROLLGUARD_GGUF_PARSER_H
+#define SCROLLGUARD_GGUF_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Zero-copy GGUF header and metadata parser.
+ * Maps the model file read-only and walks the header, KV metadata and tensor
+ * infos in one pass without loading the model. Tensor names and string
+ * metadata are views into the mapping and stay valid until close().
+ * Validation covers the version, every KV entry, tensor dims and types, and
+ * tensor offsets/alignment against the file size.
+ */
+
+namespace scrollguard {
+
+/**
+ * One tensor info entry
+ */
+struct GgufTensorInfo {
+    std::string_view name;
+    uint32_t type = 0;          // ggml_type
+    uint32_t n_dims = 0;
+    uint64_t dims[4] = {1, 1, 1, 1};
+    uint64_t offset = 0;        // Relative to the data section
+    uint64_t size_bytes = 0;    // 0 if the type is unknown to this parser
+};
+
+/**
+ * Model facts extracted from the header and metadata
+ */
+struct GgufModelInfo {
+    uint32_t version = 0;
+    uint64_t tensor_count = 0;
+    uint64_t kv_count = 0;
+    uint32_t alignment = 32;
+    uint64_t data_offset = 0;   // Start of tensor data in the file
+    uint64_t file_size = 0;
+
+    std::string architecture;
+    std::string name;
+    uint32_t file_type = 0;     // general.file_type (llama_ftype), 0 if absent
+    uint32_t dominant_type = 0; // ggml_type holding the most weight bytes
+
+    uint64_t vocab_size = 0;
+    uint64_t context_length = 0;
+    uint64_t block_count = 0;
+    uint64_t embedding_length = 0;
+    uint64_t head_count = 0;
+    uint64_t head_count_kv = 0;
+    uint64_t key_length = 0;    // Per-head K size, defaults to embedding/head_count
+    uint64_t value_length = 0;  // Per-head V size, defaults to embedding/head_count
+
+    uint64_t weights_bytes = 0; // Sum of tensor sizes
+};
+
+namespace gguf {
+    /**
+     * Name of a ggml tensor type ("Q4_K", "F16"), "unknown" if not recognized
+     */
+    const char* type_name(uint32_t type);
+
+    /**
+     * Whether the size of a ggml type is known; tensors of other types are rejected
+     */
+    bool is_known_type(uint32_t type);
+
+    /**
+     * Bytes needed for n_elements of a known ggml type, UINT64_MAX if that
+     * overflows; 0 if the type is unknown
+     */
+    uint64_t tensor_bytes(uint32_t type, uint64_t n_elements);
+}
+
+class GgufFile {
+public:
+    GgufFile();
+    ~GgufFile();
+
+    GgufFile(const GgufFile&) = delete;
+    GgufFile& operator=(const GgufFile&) = delete;
+
+    /**
+     * Map and parse a GGUF file. Returns false (see error()) if the file is
+     * not a valid GGUF model.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Map and parse a GGUF embedded at [offset, offset + length) of an open
+     * file, e.g. a stored zip entry. The fd is not kept. Offsets in info()
+     * and tensors() are relative to the start of the embedded GGUF.
+     */
+    bool open(int fd, uint64_t offset, uint64_t length);
+    void close();
+
+    bool is_valid() const { return valid_; }
+    const std::string& error() const { return error_; }
+
+    const GgufModelInfo& info() const { return info_; }
+    const std::vector<GgufTensorInfo>& tensors() const { return tensors_; }
+
+    // Human-readable one-line description
+    std::string summary() const;
+
+private:
+    bool map(int fd, uint64_t offset, uint64_t length);
+    bool parse();
+    bool fail(const std::string& message);
+
+    void* mapping_ = nullptr;   // Page-aligned start of the mapping
+    size_t mapping_size_ = 0;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    bool valid_ = false;
+    std::string error_;
+    GgufModelInfo info_;
+    std::vector<GgufTensorInfo> tensors_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_GGUF_PARSER_H
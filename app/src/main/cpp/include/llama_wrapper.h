@@ -2,13 +2,16 @@
 #define SCROLLGUARD_LLAMA_WRAPPER_H
 
 #include <jni.h>
+#include <functional>
 #include <string>
 #include <memory>
+#include <vector>
 
 // Check if we have actual llama.cpp available
 #ifdef LLAMA_CPP_AVAILABLE
 #include "llama.h"
 #include "ggml.h"
+#include "ggml-cpu.h"
 #endif
 
 /**
@@ -25,27 +28,93 @@ namespace scrollguard {
 struct ModelConfig {
     std::string model_path;
     int n_ctx = 2048;          // Context length
+    int n_seq_max = 8;         // Sequences sharing the KV cache; 0 serves one-shot requests, the rest sessions and cached prefixes
+    int type_k = 1;            // ggml_type of the K cache (1 = F16)
+    int type_v = 1;            // ggml_type of the V cache (1 = F16)
     int n_threads = 4;         // Number of threads
     float temperature = 0.1f;  // Low temperature for consistent classification
     int top_k = 1;            // Focus on most likely token
     float top_p = 0.1f;       // Low top_p for deterministic results
     bool use_mmap = true;     // Use memory mapping for efficiency
     bool use_mlock = false;   // Don't lock model in memory (mobile consideration)
+    bool use_extra_bufts = true; // Let the CPU backend repack weights (see device_profile.h)
     int n_gpu_layers = 0;     // CPU only on mobile
+    size_t checkpoint_budget_bytes = 32 * 1024 * 1024; // States of reclaimed app heads and sessions, 0 = off
 };
 
+/**
+ * Two-model cascade settings
+ */
+struct CascadeConfig {
+    float escalation_margin = 0.3f;     // Re-score when |P(productive) - P(unproductive)| is below this
+    int idle_release_seconds = 120;     // Page out the escalation model after this long unused, 0 = never
+};
+
+/**
+ * Explanation generation settings
+ */
+struct ExplanationConfig {
+    int max_tokens = 48;    // Hard cap on generated tokens
+    int draft_tokens = 4;   // Draft tokens proposed per target pass (speculative decoding)
+};
+
+/**
+ * Caption session settings
+ */
+struct CaptionSessionConfig {
+    int stable_updates = 3;             // Consecutive agreeing updates before the verdict is final
+    float stable_confidence = 0.8f;     // Minimum confidence of each of those updates
+};
+
+/**
+ * A post the user corrected, shown to the model as a few-shot example
+ */
+struct FewShotExample {
+    std::string content;
+    bool is_productive = true;  // Verdict the user says is right
+};
+
+/**
+ * Generated explanation and decoding statistics
+ */
+struct ExplanationResult {
+    bool success = false;
+    std::string text;
+    int n_tokens = 0;
+    int n_drafted = 0;
+    int n_accepted = 0;     // Draft tokens the target agreed with
+    int target_passes = 0;  // Forward passes of the target model, prompt included
+    int processing_time_ms = 0;
+    std::string error_message;
+};
+
+/**
+ * Receives generated text as it is produced (complete UTF-8 sequences);
+ * return false to stop generation
+ */
+using TokenCallback = std::function<bool(const std::string& piece)>;
+
 /**
  * Result of content classification
  */
 struct ClassificationResult {
     bool is_productive;
     float confidence;
-    std::string reason;
+    std::string reason;         // Tag for how the verdict was reached, or generated text (classify_content_streaming)
     int processing_time_ms;
     bool success;
     std::string error_message;
 };
 
+/**
+ * Verdict for a caption session after an update
+ */
+struct CaptionResult {
+    ClassificationResult classification{};
+    bool stable = false;    // Verdict is final; later updates return it without scoring
+    int n_decoded = 0;      // Caption tokens prefilled by this update
+};
+
 /**
  * Main wrapper class for llama.cpp functionality
  */
@@ -55,16 +124,56 @@ public:
     ~LlamaWrapper();
 
     // Model management
+    // Loading while a model is loaded swaps it: the old model serves until the
+    // new one is warm and is freed once requests already running on it finish
     bool load_model(const ModelConfig& config);
     bool is_model_loaded() const;
     void unload_model();
     
+    // Cascade: the loaded model screens every post, and posts it scores with a
+    // low margin are re-scored by the escalation model. Both share one threadpool.
+    bool load_escalation_model(const ModelConfig& config, const CascadeConfig& cascade = CascadeConfig());
+    void unload_escalation_model();
+    bool is_escalation_model_loaded() const;
+    
     // Content classification
     ClassificationResult classify_content(
         const std::string& content,
         const std::string& context = ""
     );
     
+    // Classify, then generate the reason with the model's sampler chain (temperature,
+    // top_k, top_p from its ModelConfig) and stream it to on_reason. The generated
+    // text replaces the reason tag; the tag stays if no text could be generated.
+    ClassificationResult classify_content_streaming(
+        const std::string& content,
+        const std::string& context,
+        const TokenCallback& on_reason,
+        int max_reason_tokens = ExplanationConfig().max_tokens
+    );
+    
+    // Caption sessions: a growing caption (Live Caption on a video) keeps its own
+    // KV sequence, so an update prefills only the tokens added since the last one.
+    // Updates pass the whole caption so far. Returns the session id, or -1.
+    int open_caption_session(const std::string& context = "",
+                             const CaptionSessionConfig& config = CaptionSessionConfig());
+    CaptionResult update_caption_session(int session, const std::string& caption);
+    void close_caption_session(int session);
+    
+    // Few-shot prompting with the user's corrections (oldest first; the most
+    // recent few are used). Prompt heads are rebuilt in the background from
+    // the first changed token, so requests cost the same as zero-shot.
+    void set_few_shot_examples(const std::vector<FewShotExample>& examples);
+    
+    // Short reason for a verdict, streamed to on_token. Drafted by the main model
+    // and verified by the escalation model when both are loaded.
+    ExplanationResult generate_explanation(
+        const std::string& content,
+        bool is_productive,
+        const ExplanationConfig& config = ExplanationConfig(),
+        const TokenCallback& on_token = nullptr
+    );
+    
     // Performance utilities
     void warm_up();
     size_t get_memory_usage() const;
@@ -91,10 +200,33 @@ namespace content_utils {
      */
     std::string prepare_content_for_analysis(const std::string& raw_content);
     
+    /**
+     * One-line description of the app content comes from ("This is a LinkedIn
+     * post."), or empty for apps without a prompt variant
+     */
+    std::string app_prompt_context(const std::string& package_name);
+    
+    /**
+     * Prompt text for the most recent few-shot examples, or empty for none
+     */
+    std::string format_few_shot_examples(const std::vector<FewShotExample>& examples);
+    
+    /**
+     * Classification prompt up to the content; depends only on the app and
+     * the few-shot examples
+     */
+    std::string classification_prompt_head(const std::string& package_name, const std::string& few_shot = "");
+    
     /**
      * Generate classification prompt for llama.cpp
      */
-    std::string generate_classification_prompt(const std::string& content);
+    std::string generate_classification_prompt(const std::string& content, const std::string& package_name = "",
+                                               const std::string& few_shot = "");
+    
+    /**
+     * Generate the prompt asking for a one-sentence reason for a verdict
+     */
+    std::string generate_explanation_prompt(const std::string& content, bool is_productive);
 }
 
 } // namespace scrollguard
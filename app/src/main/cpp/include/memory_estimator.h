@@ -0,0 +1,63 @@
+#ifndef SCROLLGUARD_MEMORY_ESTIMATOR_H
+#define SCROLLGUARD_MEMORY_ESTIMATOR_H
+
+#include "gguf_parser.h"
+#include "llama_wrapper.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * Memory requirement estimation from GGUF tensor metadata.
+ * Sizes weights, KV cache and compute buffers for a ModelConfig and checks
+ * them against what the system can actually give us (MemAvailable and the
+ * process cgroup limit), so a load that would be killed by the low-memory
+ * killer is rejected or downsized before it starts.
+ */
+
+namespace scrollguard {
+
+/**
+ * Estimated footprint of a model loaded with one ModelConfig
+ */
+struct MemoryEstimate {
+    uint64_t weights_bytes = 0;
+    uint64_t kv_cache_bytes = 0;
+    uint64_t compute_bytes = 0;
+    uint64_t overhead_bytes = 0;
+    uint64_t total_bytes = 0;
+};
+
+/**
+ * Memory the process can still allocate
+ */
+struct SystemMemory {
+    uint64_t mem_available = 0;     // /proc/meminfo MemAvailable
+    uint64_t cgroup_limit = 0;      // 0 if unlimited or unknown
+    uint64_t cgroup_usage = 0;
+    uint64_t headroom = 0;          // min(MemAvailable, cgroup limit - usage)
+};
+
+namespace memory_estimator {
+    // Kept free for the rest of the app and the system
+    constexpr uint64_t kSafetyMarginBytes = 192ull * 1024 * 1024;
+    // Smallest context a classification prompt fits in
+    constexpr int kMinContext = 512;
+
+    MemoryEstimate estimate(const GgufModelInfo& info, const ModelConfig& config);
+
+    SystemMemory read_system_memory();
+
+    /**
+     * Pick the largest configuration that fits: the requested one, else
+     * shrink n_ctx down to kMinContext, then a single sequence, then a Q8_0
+     * K cache. Returns false if even the smallest configuration does not fit.
+     */
+    bool select_config(const GgufModelInfo& info, const ModelConfig& requested,
+                       const SystemMemory& memory, ModelConfig* selected, MemoryEstimate* selected_estimate);
+
+    std::string describe(const MemoryEstimate& estimate);
+}
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MEMORY_ESTIMATOR_H
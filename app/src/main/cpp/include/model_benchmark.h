@@ -0,0 +1,50 @@
+#ifndef SCROLLGUARD_MODEL_BENCHMARK_H
+#define SCROLLGUARD_MODEL_BENCHMARK_H
+
+#include "device_profile.h"
+#include "llama_wrapper.h"
+
+/**
+ * Short load-and-prefill benchmark used to compare model files and load
+ * options on the device itself. Each run loads the model standalone (its
+ * own llama_model and context), so it must not be run while memory is
+ * tight; callers check headroom first.
+ */
+
+namespace scrollguard {
+
+/**
+ * Prefill latency distribution over the calibration posts
+ */
+struct LatencyStats {
+    int runs = 0;
+    uint32_t p50_ms = 0;
+    uint32_t p95_ms = 0;
+    uint32_t max_ms = 0;
+};
+
+namespace model_benchmark {
+    /**
+     * Read a file once so it sits in the page cache; layouts compared one
+     * after the other then all load from a warm cache instead of the first
+     * paying for the disk reads
+     */
+    bool warm_file(const std::string& path);
+
+    /**
+     * Load config.model_path, prefill a fixed classification prompt once to
+     * fault in the weights, then time a second prefill. Returns false if
+     * llama.cpp is unavailable or the model fails to load or decode.
+     */
+    bool measure(const ModelConfig& config, LayoutTiming* timing);
+
+    /**
+     * Load config.model_path once and time `runs` classification prefills
+     * over a fixed set of posts of varying length, after one untimed pass
+     */
+    bool measure_latency(const ModelConfig& config, int runs, LatencyStats* stats);
+}
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MODEL_BENCHMARK_H
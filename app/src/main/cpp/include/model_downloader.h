@@ -0,0 +1,99 @@
+#ifndef SCROLLGUARD_MODEL_DOWNLOADER_H
+#define SCROLLGUARD_MODEL_DOWNLOADER_H
+
+#include "sha256.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * Resumable, multi-connection model downloader.
+ * The target is preallocated as <target>.part and fetched in fixed-size
+ * chunks over several concurrent HTTP Range requests. Completed chunks are
+ * recorded in a <target>.chunks sidecar together with the SHA-256 state of
+ * the contiguous prefix hashed so far, so an interrupted download resumes
+ * where it stopped without refetching or rehashing. The finished file is
+ * verified and renamed into place atomically.
+ */
+
+namespace scrollguard {
+
+/**
+ * Source of byte ranges. The downloader only needs the total length and
+ * arbitrary ranges, so a plain HTTP client, a platform HTTPS stack bridged
+ * over JNI, or a local test server can all stand in.
+ */
+class RangeFetcher {
+public:
+    // Receives body bytes in order; return false to abort the transfer
+    using Sink = std::function<bool(const uint8_t* data, size_t len)>;
+
+    virtual ~RangeFetcher() = default;
+
+    virtual bool content_length(const std::string& url, uint64_t* length, std::string* error) = 0;
+
+    /**
+     * Fetch [offset, offset + length) into sink. Must deliver exactly
+     * length bytes to report success.
+     */
+    virtual bool fetch_range(const std::string& url, uint64_t offset, uint64_t length,
+                             const Sink& sink, std::string* error) = 0;
+};
+
+/**
+ * Minimal HTTP/1.1 range client over plain sockets. Follows http://
+ * redirects; https:// URLs are rejected, since the library links no TLS
+ * stack; the app passes a JNI-backed fetcher for those.
+ */
+class HttpRangeFetcher : public RangeFetcher {
+public:
+    static constexpr int kTimeoutSeconds = 30;
+    static constexpr int kMaxRedirects = 5;
+
+    bool content_length(const std::string& url, uint64_t* length, std::string* error) override;
+    bool fetch_range(const std::string& url, uint64_t offset, uint64_t length,
+                     const Sink& sink, std::string* error) override;
+};
+
+struct DownloadOptions {
+    std::string url;
+    std::string target_path;
+    std::string expected_sha256;        // Empty skips verification
+    int connections = 4;
+    uint64_t chunk_size = 4ull * 1024 * 1024;
+    int max_retries = 3;                // Per chunk
+};
+
+struct DownloadResult {
+    bool success = false;
+    bool cancelled = false;
+    bool resumed = false;               // Picked up chunks from an earlier attempt
+    uint64_t total_bytes = 0;
+    uint64_t fetched_bytes = 0;         // Transferred by this attempt
+    std::string sha256;
+    std::string error;
+};
+
+class ModelDownloader {
+public:
+    // Bytes on disk and total; return false to cancel (progress is kept for resume)
+    using ProgressCallback = std::function<bool(uint64_t bytes_done, uint64_t total_bytes)>;
+
+    explicit ModelDownloader(std::shared_ptr<RangeFetcher> fetcher);
+
+    DownloadResult download(const DownloadOptions& options, const ProgressCallback& progress = nullptr);
+
+    // Discard any partial download of target_path
+    static void discard_partial(const std::string& target_path);
+
+    static std::string partial_path(const std::string& target_path) { return target_path + ".part"; }
+    static std::string sidecar_path(const std::string& target_path) { return target_path + ".chunks"; }
+
+private:
+    std::shared_ptr<RangeFetcher> fetcher_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MODEL_DOWNLOADER_H
@@ -0,0 +1,84 @@
+#ifndef SCROLLGUARD_MODEL_PREFETCHER_H
+#define SCROLLGUARD_MODEL_PREFETCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Background page-in of model weights.
+ * With use_mmap the first inference after boot faults hundreds of MB of
+ * weights in random order. The prefetcher walks the tensor regions in the
+ * order llama.cpp evaluates them (embeddings, blk.0 .. blk.N, output) on an
+ * idle-priority thread, issuing readahead in large sequential requests, and
+ * reports page-cache residency through mincore so the cold first verdict
+ * is paid during service startup instead.
+ */
+
+namespace scrollguard {
+
+enum class PrefetchState {
+    IDLE,
+    RUNNING,
+    DONE,
+    CANCELLED,
+    FAILED
+};
+
+struct PrefetchProgress {
+    PrefetchState state = PrefetchState::IDLE;
+    uint64_t total_bytes = 0;       // Tensor data to page in
+    uint64_t requested_bytes = 0;   // Readahead issued so far
+    uint64_t resident_bytes = 0;    // In the page cache (mincore) as of the last check
+};
+
+class ModelPrefetcher {
+public:
+    // Readahead request size; large enough for sequential flash reads
+    static constexpr uint64_t kRequestBytes = 8ull * 1024 * 1024;
+
+    static ModelPrefetcher& instance();
+
+    ~ModelPrefetcher();
+
+    /**
+     * Start paging in path's tensor data. No-op if the same file is already
+     * being or has been prefetched; a different path cancels the current run.
+     * Stops early when the weights would not fit in available memory, since
+     * pages read now would only be evicted again before use.
+     */
+    bool start(const std::string& path);
+
+    // Cancel and wait for the worker
+    void stop();
+
+    PrefetchProgress progress() const;
+
+    /**
+     * Page-cache residency of a file region, in bytes
+     */
+    static uint64_t resident_bytes(const std::string& path, uint64_t offset, uint64_t length);
+
+private:
+    ModelPrefetcher() = default;
+    ModelPrefetcher(const ModelPrefetcher&) = delete;
+    ModelPrefetcher& operator=(const ModelPrefetcher&) = delete;
+
+    void run(std::string path);
+
+    mutable std::mutex mutex_;
+    std::thread worker_;
+    std::string path_;
+    std::atomic<bool> cancel_{false};
+
+    std::atomic<int> state_{static_cast<int>(PrefetchState::IDLE)};
+    std::atomic<uint64_t> total_bytes_{0};
+    std::atomic<uint64_t> requested_bytes_{0};
+    std::atomic<uint64_t> resident_bytes_{0};
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MODEL_PREFETCHER_H
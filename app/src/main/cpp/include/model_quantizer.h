@@ -0,0 +1,82 @@
+#ifndef SCROLLGUARD_MODEL_QUANTIZER_H
+#define SCROLLGUARD_MODEL_QUANTIZER_H
+
+#include "device_profile.h"
+#include "llama_wrapper.h"
+#include <string>
+#include <vector>
+
+/**
+ * On-device requantization.
+ * Models ship as Q4_K_M, but on CPUs with dotprod/i8mm (or AVX2) the CPU
+ * backend's repacked Q4_0 and Q8_0 kernels can prefill faster. The optional
+ * job below converts the model to each candidate format with llama.cpp's
+ * quantize API, benchmarks every format against the original, keeps the
+ * fastest and records it in a selection file next to the model. Loads
+ * resolve the model path through that selection.
+ *
+ * Requantizing an already quantized model loses a little accuracy, so a
+ * variant is only kept when it is clearly faster than the original.
+ */
+
+namespace scrollguard {
+
+/**
+ * One format considered by the job
+ */
+struct QuantVariant {
+    std::string type;           // "Q4_K_M", "Q4_0", ...
+    std::string path;
+    uint64_t size_bytes = 0;
+    bool measured = false;
+    LayoutTiming timing;
+};
+
+struct QuantizeResult {
+    bool success = false;
+    std::string selected_type;
+    std::string selected_path;  // The original model if no variant won
+    std::vector<QuantVariant> variants;
+    std::string error;
+};
+
+namespace model_quantizer {
+    // A variant must cost at most this fraction of the original per launch to be kept
+    constexpr float kRequiredSpeedup = 0.9f;
+
+    // Disk space left free after writing a variant
+    constexpr uint64_t kDiskMarginBytes = 64ull * 1024 * 1024;
+
+    // <model>.format
+    std::string selection_path(const std::string& model_path);
+
+    // <model>.<TYPE>.requant
+    std::string variant_path(const std::string& model_path, const std::string& type);
+
+    /**
+     * Target llama_ftypes worth trying on this CPU, best guess first
+     */
+    std::vector<int> candidate_ftypes(const CpuFeatures& cpu);
+
+    /**
+     * Run the job for config.model_path: requantize to each candidate,
+     * benchmark with config's context and thread settings, keep the winner
+     * and delete the rest. Blocks for minutes on large models; only one job
+     * runs at a time.
+     */
+    QuantizeResult optimize(const ModelConfig& config);
+
+    /**
+     * Path to load for model_path: the selected variant if the selection
+     * was made for this model content and CPU and the variant still exists,
+     * otherwise model_path itself
+     */
+    std::string resolve(const std::string& model_path);
+
+    // Remove all variants and the selection for model_path
+    void discard(const std::string& model_path);
+}
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MODEL_QUANTIZER_H
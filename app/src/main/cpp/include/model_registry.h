@@ -0,0 +1,123 @@
+#ifndef SCROLLGUARD_MODEL_REGISTRY_H
+#define SCROLLGUARD_MODEL_REGISTRY_H
+
+#include "llama_wrapper.h"
+#include "model_benchmark.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Model registry loaded from a manifest.
+ * The manifest lists each model with its quantized variants, sizes and
+ * checksums, in a line format like the other sidecar files:
+ *
+ *   scrollguard-models 1
+ *   [gemma-270m]
+ *   description=Gemma 3 270M - Optimized for mobile inference
+ *   parameters=270000000
+ *   role=screening
+ *   variant=Q4_K_M <size_bytes> <sha256 or -> <filename> <url>
+ *
+ * Variants are listed in order of preference. A model with
+ * role=escalation is never selected to screen posts; once downloaded it
+ * re-scores the low-margin ones (the cascade). A built-in manifest is used
+ * until the app supplies one. Selection benchmarks the downloaded models on
+ * the device and picks the largest one that meets a p95 latency and memory
+ * budget; the choice is kept in models_dir until the manifest, the hardware,
+ * the set of downloaded files (names and sizes) or the budget changes.
+ */
+
+namespace scrollguard {
+
+struct ModelVariant {
+    std::string type;           // "Q4_K_M", "Q8_0", ...
+    uint64_t size_bytes = 0;    // 0 if unknown
+    std::string sha256;         // Empty if not published
+    std::string filename;
+    std::string url;
+};
+
+struct RegistryModel {
+    std::string name;
+    std::string description;
+    uint64_t parameters = 0;
+    bool escalation = false;    // role=escalation
+    std::vector<ModelVariant> variants;
+};
+
+struct SelectionBudget {
+    uint32_t p95_latency_ms = 400;
+    uint64_t memory_bytes = 0;  // 0 = whatever headroom the system has
+};
+
+struct ModelSelection {
+    std::string model;
+    std::string variant;
+    std::string path;
+    bool meets_budget = false;  // False if no model met the budget and the fastest was taken
+    bool from_cache = false;
+    LatencyStats latency;
+    uint64_t memory_bytes = 0;  // Estimated footprint
+};
+
+class ModelRegistry {
+public:
+    // Timed prefills per candidate
+    static constexpr int kCalibrationRuns = 20;
+
+    static ModelRegistry& instance();
+
+    /**
+     * Replace the registry with a parsed manifest. On error the current
+     * registry is kept.
+     */
+    bool load_manifest(const std::string& text, std::string* error);
+    bool load_manifest_file(const std::string& path, std::string* error);
+
+    std::vector<RegistryModel> models() const;
+    bool find(const std::string& name, RegistryModel* model) const;
+
+    // SHA-256 of the manifest text, part of the persisted selection key
+    std::string manifest_digest() const;
+
+    /**
+     * Select among the models with a variant downloaded in models_dir,
+     * reusing the persisted choice when it is still valid. base supplies
+     * context and thread settings for the benchmark. Without benchmark only
+     * a still-valid persisted choice is returned, which is cheap enough for
+     * the model load path.
+     */
+    bool select(const std::string& models_dir, const ModelConfig& base, const SelectionBudget& budget,
+                bool benchmark, ModelSelection* selection, std::string* error);
+
+    /**
+     * Path of the preferred downloaded variant of the manifest's escalation
+     * model, false if none is listed or downloaded
+     */
+    bool escalation_model(const std::string& models_dir, std::string* path) const;
+
+    // Last selection made or loaded in this process
+    bool current_selection(ModelSelection* selection) const;
+
+    static std::string selection_path(const std::string& models_dir);
+
+private:
+    ModelRegistry();
+
+    bool load_persisted(const std::string& models_dir, const SelectionBudget& budget,
+                        const std::string& downloads, ModelSelection* selection);
+    void persist(const std::string& models_dir, const SelectionBudget& budget,
+                 const std::string& downloads, const ModelSelection& selection);
+
+    mutable std::mutex mutex_;
+    std::mutex select_mutex_;   // Serializes benchmarks
+    std::vector<RegistryModel> models_;
+    std::string digest_;
+    ModelSelection selection_;
+    bool has_selection_ = false;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MODEL_REGISTRY_H
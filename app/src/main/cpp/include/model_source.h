@@ -0,0 +1,69 @@
+#ifndef SCROLLGUARD_MODEL_SOURCE_H
+#define SCROLLGUARD_MODEL_SOURCE_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Model sources other than a plain file in app storage.
+ * A bundled or side-loaded GGUF can be stored uncompressed inside an APK or
+ * zip and addressed as (fd, offset, length): an AssetFileDescriptor for APK
+ * assets, or the zip locator below for other archives. GgufFile maps such a
+ * range directly for validation and sizing; loading it still needs a copy,
+ * see resolve_loadable_path.
+ */
+
+namespace scrollguard {
+
+/**
+ * A GGUF held in [offset, offset + length) of an open file. The fd is
+ * borrowed, not owned.
+ */
+struct ModelSource {
+    int fd = -1;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+/**
+ * Location of one zip entry's data
+ */
+struct ZipEntryLocation {
+    uint64_t data_offset = 0;       // First byte of the entry data in the archive
+    uint64_t compressed_size = 0;
+    uint64_t uncompressed_size = 0;
+    uint16_t method = 0;            // 0 = stored, 8 = deflate
+    uint32_t crc32 = 0;
+};
+
+namespace zip {
+    /**
+     * Find an entry through the central directory (Zip64 aware) and resolve
+     * its data offset from the local header
+     */
+    bool locate_entry(int fd, const std::string& name, ZipEntryLocation* location, std::string* error);
+
+    /**
+     * Locate an uncompressed entry as a model source; compressed or
+     * encrypted entries cannot be mapped and are rejected
+     */
+    bool locate_stored_entry(int fd, const std::string& name, ModelSource* source, std::string* error);
+}
+
+namespace model_source {
+    /**
+     * Resolve a source to a path llama_model_load_from_file can open.
+     * A source covering the whole file is opened in place through
+     * /proc/self/fd/N. llama.cpp's loader only takes a path and cannot start
+     * at an offset, so an embedded range is copied once into cache_dir with
+     * sendfile and the copy is reused until the archive changes. That costs
+     * the model size again in storage; cache_dir should be durable so the
+     * copy is not repeated after the OS trims caches.
+     */
+    bool resolve_loadable_path(const ModelSource& source, const std::string& cache_dir,
+                               std::string* path, std::string* error);
+}
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_MODEL_SOURCE_H
@@ -0,0 +1,88 @@
+#ifndef SCROLLGUARD_PERSISTENT_CACHE_H
+#define SCROLLGUARD_PERSISTENT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Persistent classification cache backed by a memory-mapped file.
+ * Fixed-size open-addressing table (linear probing) that survives app restarts.
+ * Readers are lock-free (per-slot sequence counters); a slot left half-written
+ * by a crash is detected by its odd sequence and treated as empty.
+ * Entries are tagged with an epoch derived from the model and lexicon versions,
+ * so changing either invalidates the whole table without rewriting it.
+ */
+
+namespace scrollguard {
+
+/**
+ * Verdict stored in the persistent cache
+ */
+struct PersistentVerdict {
+    bool is_productive = true;
+    float confidence = 0.0f;
+    uint32_t model_version = 0; // Epoch tag of the model/lexicon that produced it
+    int64_t timestamp_ms = 0;
+};
+
+class PersistentCache {
+public:
+    static constexpr uint32_t kDefaultCapacity = 1u << 16; // 65536 slots, 2MB file
+    static constexpr uint32_t kMaxProbes = 16;
+
+    PersistentCache();
+    ~PersistentCache();
+
+    PersistentCache(const PersistentCache&) = delete;
+    PersistentCache& operator=(const PersistentCache&) = delete;
+
+    // Process-wide instance used by the JNI layer
+    static PersistentCache& instance();
+
+    /**
+     * Open or create the cache file. An existing file written for a different
+     * model or lexicon version is kept but all of its entries become misses.
+     */
+    bool open(
+        const std::string& path,
+        const std::string& model_version,
+        const std::string& lexicon_version,
+        uint32_t capacity = kDefaultCapacity
+    );
+    void close(); // Callers must stop issuing lookups first
+    bool is_open() const;
+
+    bool lookup(uint64_t key, PersistentVerdict* out) const;
+    bool insert(uint64_t key, bool is_productive, float confidence, int64_t timestamp_ms);
+
+    // Switch to a new model/lexicon epoch, invalidating every stored entry.
+    // Returns true if the epoch actually changed.
+    bool invalidate(const std::string& model_version, const std::string& lexicon_version);
+
+    // Schedule (or with sync=true, wait for) write-back of dirty pages
+    void flush(bool sync = false);
+
+    uint32_t get_epoch() const;
+
+private:
+    struct Header;
+    struct Slot;
+
+    static uint32_t compute_epoch(const std::string& model_version, const std::string& lexicon_version);
+
+    bool initialize_file(int fd, uint32_t capacity, uint32_t epoch);
+
+    mutable std::mutex write_mutex_;
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    Header* header_ = nullptr;
+    Slot* slots_ = nullptr;
+    uint32_t mask_ = 0;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_PERSISTENT_CACHE_H
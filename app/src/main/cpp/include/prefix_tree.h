@@ -0,0 +1,61 @@
+#ifndef SCROLLGUARD_PREFIX_TREE_H
+#define SCROLLGUARD_PREFIX_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Radix tree over the token sequences held in KV cache sequences ("slots").
+ * Each slot holds one sequence at positions [0, n). A lookup returns the
+ * slot sharing the longest token prefix with a new prompt, so only the
+ * rest of the prompt has to be prefilled: expanded posts ("See more"),
+ * shared thread context and the classification template all hit.
+ *
+ * Not thread-safe; the wrapper guards it with the context's compute mutex.
+ */
+
+namespace scrollguard {
+
+class TokenPrefixTree {
+public:
+    using Token = int32_t;
+
+    /**
+     * Longest prefix of tokens held by any slot
+     * @param slot Set to a slot holding that prefix when the result is non-zero
+     * @return Number of leading tokens matched
+     */
+    size_t longest_prefix(const Token* tokens, size_t n, int* slot) const;
+
+    // Record that slot holds tokens; replaces what the slot held before
+    void insert(int slot, const Token* tokens, size_t n);
+
+    // Forget the slot's sequence
+    void erase(int slot);
+
+    void clear();
+
+    // Tokens recorded for slot (empty if none)
+    const std::vector<Token>& tokens_of(int slot) const;
+
+    size_t slot_count() const { return stored_.size(); }
+
+private:
+    struct Node {
+        std::vector<Token> edge;        // Tokens on the edge from the parent
+        std::vector<int> slots;         // Slots whose sequence covers the whole edge
+        std::unordered_map<Token, std::unique_ptr<Node>> children;  // Keyed by edge[0]
+    };
+
+    static void split(Node* node, size_t at);
+
+    Node root_;
+    std::unordered_map<int, std::vector<Token>> stored_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_PREFIX_TREE_H
@@ -0,0 +1,81 @@
+#ifndef SCROLLGUARD_RESULT_CACHE_H
+#define SCROLLGUARD_RESULT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * Content-addressed cache of classification verdicts.
+ * Keyed by a 64-bit content hash (see content_hash.h), sharded to keep lock
+ * contention low, bounded by a byte budget and evicted with CLOCK.
+ */
+
+namespace scrollguard {
+
+/**
+ * Cached classification verdict
+ */
+struct CachedVerdict {
+    bool is_productive = true;
+    float confidence = 0.0f;
+    std::string reason;
+    int processing_time_ms = 0;
+};
+
+/**
+ * Cache counters and occupancy
+ */
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t byte_budget = 0;
+};
+
+class ResultCache {
+public:
+    static constexpr size_t kShardCount = 16;
+    static constexpr size_t kDefaultByteBudget = 2 * 1024 * 1024; // 2MB
+
+    explicit ResultCache(size_t byte_budget = kDefaultByteBudget);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Process-wide cache shared by every classification call site
+    static ResultCache& instance();
+
+    bool lookup(uint64_t key, CachedVerdict* out);
+    void insert(uint64_t key, const CachedVerdict& verdict);
+
+    /**
+     * Warm the cache with stored verdicts, taking each shard lock once.
+     * Keys already cached are kept and nothing is evicted: once a shard is at
+     * its budget the remaining keys for it are skipped, so callers should pass
+     * the most valuable (newest) verdicts first.
+     * @return Number of verdicts inserted
+     */
+    size_t preload(const uint64_t* keys, const uint8_t* is_productive, const float* confidences,
+                   size_t count, const std::string& reason);
+    void erase(uint64_t key);
+    void clear();
+
+    void set_byte_budget(size_t byte_budget);
+    CacheStats get_stats() const;
+
+private:
+    class Shard;
+    std::unique_ptr<Shard[]> shards_;
+
+    Shard& shard_for(uint64_t key) const;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_RESULT_CACHE_H
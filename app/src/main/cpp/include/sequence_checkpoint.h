@@ -0,0 +1,65 @@
+#ifndef SCROLLGUARD_SEQUENCE_CHECKPOINT_H
+#define SCROLLGUARD_SEQUENCE_CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Serialized KV state of sequences the wrapper had to reclaim (an app's
+ * prompt head, a caption session), kept so that switching back to the app
+ * restores the state with a copy instead of prefilling it again. Bounded
+ * by a byte budget and evicted least recently stored first.
+ *
+ * Not thread-safe; the wrapper guards it with the context's compute mutex.
+ */
+
+namespace scrollguard {
+
+struct SequenceCheckpoint {
+    std::vector<int32_t> tokens;    // Tokens the state covers, when the owner tracks them
+    size_t n_past = 0;              // Positions held
+    std::vector<uint8_t> state;     // llama_state_seq_get_data output
+};
+
+class SequenceCheckpointStore {
+public:
+    static constexpr size_t kDefaultByteBudget = 32 * 1024 * 1024; // 32MB
+
+    explicit SequenceCheckpointStore(size_t byte_budget = kDefaultByteBudget) : byte_budget_(byte_budget) {}
+
+    // Store a checkpoint under key, replacing any older one; dropped if larger than the budget
+    void put(const std::string& key, SequenceCheckpoint checkpoint);
+
+    // Move the checkpoint for key out of the store
+    bool take(const std::string& key, SequenceCheckpoint* out);
+
+    void erase(const std::string& key);
+    void clear();
+
+    void set_byte_budget(size_t byte_budget);
+    size_t byte_budget() const { return byte_budget_; }
+    size_t bytes() const { return bytes_; }
+    size_t size() const { return index_.size(); }
+
+private:
+    struct Entry {
+        std::string key;
+        SequenceCheckpoint checkpoint;
+    };
+
+    static size_t entry_cost(const Entry& entry);
+    void evict_to_budget(size_t incoming);
+
+    std::list<Entry> entries_;      // Most recently stored first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t bytes_ = 0;
+    size_t byte_budget_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_SEQUENCE_CHECKPOINT_H
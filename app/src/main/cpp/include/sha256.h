@@ -0,0 +1,78 @@
+#ifndef SCROLLGUARD_SHA256_H
+#define SCROLLGUARD_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * Streaming SHA-256 for model file verification.
+ * The block function is picked once at runtime: ARMv8 SHA2 instructions on
+ * arm64 devices that report them, SHA-NI on x86 emulators, portable C++
+ * otherwise. A hasher can be fed incrementally while a download is written,
+ * and its state can be saved and restored so a resumed download does not
+ * rehash what is already on disk.
+ */
+
+namespace scrollguard {
+
+class Sha256 {
+public:
+    static constexpr size_t kDigestSize = 32;
+    static constexpr size_t kBlockSize = 64;
+
+    /**
+     * Serializable hashing state (plain bytes, native endianness)
+     */
+    struct State {
+        uint32_t h[8];
+        uint64_t length;            // Bytes hashed so far
+        uint8_t buffer[kBlockSize]; // Pending partial block
+        uint32_t buffered;
+        uint32_t reserved;
+    };
+
+    Sha256();
+
+    void reset();
+    void update(const void* data, size_t len);
+
+    // Finish and return the lower-case hex digest; the hasher must be reset before reuse
+    std::string finish_hex();
+    void finish(uint8_t digest[kDigestSize]);
+
+    uint64_t bytes_hashed() const { return state_.length; }
+
+    const State& save_state() const { return state_; }
+    void restore_state(const State& state) { state_ = state; }
+
+    // Block function in use: "armv8-sha2", "sha-ni" or "portable"
+    static const char* backend_name();
+
+private:
+    State state_;
+};
+
+namespace sha256 {
+    /**
+     * Progress callback: bytes hashed and total; return false to cancel
+     */
+    using ProgressCallback = std::function<bool(uint64_t bytes_hashed, uint64_t total_bytes)>;
+
+    /**
+     * Hash a file with pread in large chunks, reading the next chunk while the
+     * current one is hashed. Returns false on I/O error or cancellation.
+     */
+    bool hash_file(const std::string& path, std::string* hex_digest, const ProgressCallback& progress = nullptr);
+
+    /**
+     * Hash a file and compare against an expected hex digest (case-insensitive)
+     */
+    bool verify_file(const std::string& path, const std::string& expected_hex,
+                     const ProgressCallback& progress = nullptr);
+}
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_SHA256_H
@@ -0,0 +1,105 @@
+#ifndef SCROLLGUARD_SIMHASH_INDEX_H
+#define SCROLLGUARD_SIMHASH_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Near-duplicate verdict lookup for reposts and lightly edited captions.
+ * Texts are fingerprinted with a 64-bit SimHash over word unigrams and bigrams.
+ * The index splits fingerprints into (k + 1) bit blocks with one table per block:
+ * by pigeonhole, any fingerprint within Hamming distance k matches at least one
+ * block exactly, so a lookup only verifies the candidates in k + 1 buckets.
+ */
+
+namespace scrollguard {
+
+/**
+ * Verdict found for a near-duplicate
+ */
+struct NearDuplicateMatch {
+    bool is_productive = true;
+    float confidence = 0.0f;
+    int distance = 0;
+};
+
+namespace simhash {
+    // Minimum number of words before a fingerprint is considered meaningful
+    constexpr size_t kMinWords = 6;
+
+    // Words of text per bit of allowed drift: each edited word moves a larger
+    // share of a short text's features, and the edit matters more to its meaning
+    constexpr size_t kWordsPerDistanceBit = 3;
+
+    /**
+     * Fingerprint text; returns false if it is too short to fingerprint reliably
+     * @param word_count Receives the number of words, if not null
+     */
+    bool compute(const std::string& text, uint64_t* fingerprint, size_t* word_count = nullptr);
+
+    /**
+     * Largest Hamming distance still treated as a near-duplicate of a text
+     * with word_count words: 2 bits at the 6-word minimum, growing to the
+     * index's limit for captions of 30 words and more
+     */
+    int max_distance_for(size_t word_count);
+
+    inline int hamming_distance(uint64_t a, uint64_t b) {
+        return __builtin_popcountll(a ^ b);
+    }
+}
+
+class SimHashIndex {
+public:
+    static constexpr size_t kDefaultCapacity = 4096;
+    // Short posts drift further than long documents: a two-word edit of a
+    // 30-word caption typically lands 6-10 bits away, unrelated posts 20+
+    static constexpr int kDefaultMaxDistance = 10;
+    static constexpr int kMaxSupportedDistance = 15;
+
+    explicit SimHashIndex(size_t capacity = kDefaultCapacity, int max_distance = kDefaultMaxDistance);
+
+    // Process-wide index shared by the JNI layer
+    static SimHashIndex& instance();
+
+    // max_distance tightens the index's distance for this lookup; -1 keeps it
+    bool find(uint64_t fingerprint, NearDuplicateMatch* out, int max_distance = -1) const;
+    void insert(uint64_t fingerprint, bool is_productive, float confidence);
+
+    // Drop every entry within max_distance of fingerprint (-1 keeps the index's
+    // distance), so a corrected verdict is not shadowed by its near-duplicates
+    size_t erase_near(uint64_t fingerprint, int max_distance = -1);
+    void clear();
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        uint64_t fingerprint = 0;
+        float confidence = 0.0f;
+        bool is_productive = true;
+        bool occupied = false;
+    };
+
+    uint32_t block_of(uint64_t fingerprint, int table) const;
+    void unlink(uint32_t entry_index);
+
+    const size_t capacity_;
+    const int max_distance_;
+    const int block_count_;
+    const int block_bits_;
+
+    mutable std::shared_mutex mutex_;
+    std::vector<Entry> entries_;        // Ring buffer, oldest overwritten first
+    size_t next_slot_ = 0;
+    size_t size_ = 0;
+    std::vector<std::unordered_map<uint32_t, std::vector<uint32_t>>> tables_;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_SIMHASH_INDEX_H
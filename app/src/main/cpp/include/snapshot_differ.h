@@ -0,0 +1,52 @@
+#ifndef SCROLLGUARD_SNAPSHOT_DIFFER_H
+#define SCROLLGUARD_SNAPSHOT_DIFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Diffs successive accessibility snapshots of a window.
+ * Keeps the set of content hashes seen in the previous snapshot of each window
+ * and reports only the entries that are new or changed, so steady-state
+ * scrolling does work proportional to newly revealed content.
+ */
+
+namespace scrollguard {
+
+class SnapshotDiffer {
+public:
+    static constexpr size_t kMaxWindows = 16;
+
+    // Process-wide instance used by the JNI layer
+    static SnapshotDiffer& instance();
+
+    /**
+     * Replace the window's snapshot with these hashes and return the indices
+     * whose hash was not in the previous snapshot (first occurrence only)
+     */
+    std::vector<int> diff(const std::string& window_key, const std::vector<uint64_t>& hashes);
+
+    // Forget one window's snapshot, or every window if window_key is empty
+    void reset(const std::string& window_key);
+
+private:
+    struct WindowState {
+        std::unordered_set<uint64_t> hashes;
+        uint64_t last_used = 0;
+    };
+
+    void evict_least_recent();
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, WindowState> windows_;
+    uint64_t tick_ = 0;
+};
+
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_SNAPSHOT_DIFFER_H
@@ -0,0 +1,113 @@
+#include "../include/bloom_filter.h"
+#include "../include/content_hash.h"
+#include <android/log.h>
+#include <algorithm>
+
+#define LOG_TAG "ScrollGuard-BloomFilter"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+size_t block_count_for(size_t capacity) {
+    // Round up to a power of two so the block index is a mask
+    size_t needed = std::max<size_t>(capacity * RotatingBloomFilter::kBitsPerKey / 512, 1);
+    size_t count = 1;
+    while (count < needed) {
+        count <<= 1;
+    }
+    return count;
+}
+
+} // namespace
+
+RotatingBloomFilter::RotatingBloomFilter(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      block_count_(block_count_for(capacity_)) {
+    for (auto& generation : generations_) {
+        generation.blocks.reset(new Block[block_count_]);
+    }
+    clear();
+}
+
+RotatingBloomFilter& RotatingBloomFilter::instance() {
+    static RotatingBloomFilter filter;
+    return filter;
+}
+
+bool RotatingBloomFilter::generation_contains(const Generation& generation, uint64_t key) const {
+    const Block& block = generation.blocks[key & (block_count_ - 1)];
+
+    // Probe bit positions come from a remix of the key, 9 bits each
+    uint64_t bits = content_hash::mix(key, content_hash::kDefaultSeed);
+    for (int i = 0; i < kProbes; i++) {
+        uint32_t bit = static_cast<uint32_t>(bits >> (i * 9)) & 511u;
+        if ((block.words[bit >> 6].load(std::memory_order_relaxed) & (1ull << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RotatingBloomFilter::might_contain(uint64_t key) const {
+    int current = current_.load(std::memory_order_acquire);
+    return generation_contains(generations_[current], key) ||
+           generation_contains(generations_[current ^ 1], key);
+}
+
+void RotatingBloomFilter::insert(uint64_t key) {
+    Generation& generation = generations_[current_.load(std::memory_order_acquire)];
+    Block& block = generation.blocks[key & (block_count_ - 1)];
+
+    uint64_t bits = content_hash::mix(key, content_hash::kDefaultSeed);
+    for (int i = 0; i < kProbes; i++) {
+        uint32_t bit = static_cast<uint32_t>(bits >> (i * 9)) & 511u;
+        block.words[bit >> 6].fetch_or(1ull << (bit & 63), std::memory_order_relaxed);
+    }
+
+    if (generation.count.fetch_add(1, std::memory_order_relaxed) + 1 >= capacity_) {
+        rotate();
+    }
+}
+
+void RotatingBloomFilter::rotate() {
+    std::lock_guard<std::mutex> lock(rotate_mutex_);
+
+    int current = current_.load(std::memory_order_relaxed);
+    if (generations_[current].count.load(std::memory_order_relaxed) < capacity_) {
+        return; // Another thread already rotated
+    }
+
+    // Clear the oldest generation and make it current
+    Generation& oldest = generations_[current ^ 1];
+    for (size_t i = 0; i < block_count_; i++) {
+        for (auto& word : oldest.blocks[i].words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+    oldest.count.store(0, std::memory_order_relaxed);
+    current_.store(current ^ 1, std::memory_order_release);
+
+    LOGD("Rotated bloom filter generation (%zu keys per generation)", capacity_);
+}
+
+void RotatingBloomFilter::clear() {
+    std::lock_guard<std::mutex> lock(rotate_mutex_);
+
+    for (auto& generation : generations_) {
+        for (size_t i = 0; i < block_count_; i++) {
+            for (auto& word : generation.blocks[i].words) {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+        generation.count.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t RotatingBloomFilter::memory_bytes() const {
+    return 2 * block_count_ * sizeof(Block);
+}
+
+} // namespace scrollguard
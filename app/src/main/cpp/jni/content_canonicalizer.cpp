@@ -0,0 +1,323 @@
+#include "../include/content_canonicalizer.h"
+#include "../include/content_hash.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+#define LOG_TAG "ScrollGuard-Canonicalizer"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+const char* const kEllipsis = "\xE2\x80\xA6"; // U+2026
+
+const std::vector<std::string> kSeparators = {
+    "\xC2\xB7",     // U+00B7 middle dot
+    "\xE2\x80\xA2", // U+2022 bullet
+    "\xE2\x80\x94", // U+2014 em dash
+    "|", "-", "/"
+};
+
+const std::vector<std::string> kCompactTimeUnits = {
+    "s", "m", "h", "d", "w", "y", "mo", "min", "mins", "hr", "hrs",
+    "sec", "secs", "wk", "wks", "yr", "yrs"
+};
+
+const std::vector<std::string> kTimeUnitWords = {
+    "second", "seconds", "sec", "secs", "minute", "minutes", "min", "mins",
+    "hour", "hours", "hr", "hrs", "day", "days", "week", "weeks",
+    "month", "months", "year", "years"
+};
+
+bool contains(const std::vector<std::string>& list, const std::string& value) {
+    return std::find(list.begin(), list.end(), value) != list.end();
+}
+
+bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * Lower-case ASCII and strip surrounding punctuation and ellipses,
+ * keeping a leading '#' or '@' so hashtags and mentions stay distinct
+ */
+std::string core_token(const std::string& token) {
+    std::string t = token;
+    std::transform(t.begin(), t.end(), t.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    bool changed = true;
+    while (changed && !t.empty()) {
+        changed = false;
+        if (starts_with(t, kEllipsis)) {
+            t.erase(0, 3);
+            changed = true;
+        } else if (ends_with(t, kEllipsis)) {
+            t.erase(t.size() - 3);
+            changed = true;
+        } else if (std::ispunct(static_cast<unsigned char>(t.front())) && t.front() != '#' && t.front() != '@') {
+            t.erase(0, 1);
+            changed = true;
+        } else if (std::ispunct(static_cast<unsigned char>(t.back()))) {
+            t.pop_back();
+            changed = true;
+        }
+    }
+    return t;
+}
+
+/**
+ * Digits with optional separators/decimal and an optional k/m/b suffix ("1.2k", "1,234")
+ */
+bool is_count(const std::string& t, bool* abbreviated) {
+    if (t.empty() || !std::isdigit(static_cast<unsigned char>(t[0]))) {
+        return false;
+    }
+
+    size_t i = 0;
+    bool has_separator = false;
+    while (i < t.size() && (std::isdigit(static_cast<unsigned char>(t[i])) || t[i] == '.' || t[i] == ',')) {
+        has_separator |= (t[i] == '.' || t[i] == ',');
+        i++;
+    }
+
+    bool has_suffix = false;
+    if (i < t.size() && (t[i] == 'k' || t[i] == 'm' || t[i] == 'b') && i + 1 == t.size()) {
+        has_suffix = true;
+        i++;
+    }
+
+    if (abbreviated) {
+        *abbreviated = has_suffix || has_separator;
+    }
+    return i == t.size();
+}
+
+/**
+ * Compact relative time such as "2m", "3h", "5d", "10min"
+ */
+bool is_compact_time(const std::string& t) {
+    size_t i = 0;
+    while (i < t.size() && std::isdigit(static_cast<unsigned char>(t[i]))) {
+        i++;
+    }
+    return i > 0 && i < t.size() && contains(kCompactTimeUnits, t.substr(i));
+}
+
+/**
+ * Core form of a token and whether a separator ("·", "|") sits on either side of it
+ */
+struct Word {
+    std::string text;
+    bool after_separator;
+    bool before_separator;
+};
+
+std::vector<std::string> split_phrase(const std::string& phrase) {
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < phrase.size()) {
+        size_t end = phrase.find(' ', pos);
+        if (end == std::string::npos) end = phrase.size();
+        if (end > pos) {
+            std::string token = core_token(phrase.substr(pos, end - pos));
+            if (!token.empty()) tokens.push_back(token);
+        }
+        pos = end + 1;
+    }
+    return tokens;
+}
+
+} // namespace
+
+CanonicalizerRules ContentCanonicalizer::default_rules() {
+    CanonicalizerRules rules;
+    rules.count_nouns = {
+        "like", "likes", "view", "views", "comment", "comments", "reply", "replies",
+        "share", "shares", "repost", "reposts", "retweet", "retweets", "quote", "quotes",
+        "follower", "followers", "reaction", "reactions", "play", "plays", "vote", "votes"
+    };
+    rules.trailing_phrases = {
+        "see more", "see translation"
+    };
+    return rules;
+}
+
+ContentCanonicalizer::ContentCanonicalizer() : default_rules_(default_rules()) {
+    // Built-in per-app rules for the supported packages
+    CanonicalizerRules tiktok = default_rules_;
+    tiktok.strip_bare_counts = true; // Like/comment/share counters render without nouns
+    rules_by_package_["com.zhiliaoapp.musically"] = tiktok;
+
+    CanonicalizerRules instagram = default_rules_;
+    instagram.strip_bare_counts = true;
+    instagram.trailing_phrases.push_back("view all comments");
+    rules_by_package_["com.instagram.android"] = instagram;
+
+    CanonicalizerRules twitter = default_rules_;
+    twitter.count_nouns.insert(twitter.count_nouns.end(), {"bookmark", "bookmarks"});
+    twitter.trailing_phrases.insert(twitter.trailing_phrases.end(), {"show more", "show this thread"});
+    rules_by_package_["com.twitter.android"] = twitter;
+
+    CanonicalizerRules reddit = default_rules_;
+    reddit.count_nouns.insert(reddit.count_nouns.end(), {"point", "points", "upvote", "upvotes", "award", "awards"});
+    rules_by_package_["com.reddit.frontpage"] = reddit;
+
+    CanonicalizerRules youtube = default_rules_;
+    youtube.count_nouns.insert(youtube.count_nouns.end(), {"subscriber", "subscribers", "watching"});
+    rules_by_package_["com.youtube.android"] = youtube;
+    rules_by_package_["com.google.android.youtube"] = youtube;
+
+    CanonicalizerRules facebook = default_rules_;
+    facebook.strip_bare_counts = true;
+    rules_by_package_["com.facebook.katana"] = facebook;
+}
+
+ContentCanonicalizer& ContentCanonicalizer::instance() {
+    static ContentCanonicalizer canonicalizer;
+    return canonicalizer;
+}
+
+void ContentCanonicalizer::set_rules(const std::string& app_package, const CanonicalizerRules& rules) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    LOGD("Setting canonicalizer rules for %s", app_package.c_str());
+
+    if (app_package.empty()) {
+        default_rules_ = rules;
+    } else {
+        rules_by_package_[app_package] = rules;
+    }
+}
+
+std::string ContentCanonicalizer::canonicalize(const std::string& content, const std::string& app_package) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    auto it = rules_by_package_.find(app_package);
+    const CanonicalizerRules& rules = it != rules_by_package_.end() ? it->second : default_rules_;
+
+    // Ellipses glue truncated text to expanders ("comments…See more"), split on them
+    std::string text = content;
+    for (const std::string& ellipsis : {std::string(kEllipsis), std::string("...")}) {
+        size_t found = 0;
+        while ((found = text.find(ellipsis, found)) != std::string::npos) {
+            text.replace(found, ellipsis.size(), " ");
+        }
+    }
+
+    // Tokenize on ASCII whitespace; separators are not words but mark segment edges
+    std::vector<Word> words;
+    bool pending_separator = false;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        size_t start = pos;
+        while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        if (pos == start) {
+            continue;
+        }
+        std::string token = text.substr(start, pos - start);
+        if (contains(kSeparators, token)) {
+            pending_separator = true;
+            if (!words.empty()) words.back().before_separator = true;
+            continue;
+        }
+        std::string t = core_token(token);
+        if (!t.empty()) {
+            words.push_back({t, pending_separator, false});
+            pending_separator = false;
+        }
+    }
+
+    // Strip trailing expanders ("See more") repeatedly
+    bool stripped = true;
+    while (stripped && !words.empty()) {
+        stripped = false;
+        for (const auto& phrase : rules.trailing_phrases) {
+            std::vector<std::string> phrase_tokens = split_phrase(phrase);
+            if (phrase_tokens.empty() || phrase_tokens.size() > words.size()) {
+                continue;
+            }
+            if (std::equal(phrase_tokens.begin(), phrase_tokens.end(), words.end() - phrase_tokens.size(),
+                           [](const std::string& p, const Word& w) { return p == w.text; })) {
+                words.resize(words.size() - phrase_tokens.size());
+                stripped = true;
+                break;
+            }
+        }
+    }
+
+    std::vector<std::string> kept;
+    kept.reserve(words.size());
+
+    for (size_t i = 0; i < words.size(); i++) {
+        const std::string& t = words[i].text;
+        // Lookahead stays within the separator-delimited segment
+        std::string next = i + 1 < words.size() && !words[i].before_separator ? words[i + 1].text : "";
+        std::string after_next = !next.empty() && i + 2 < words.size() && !words[i + 1].before_separator
+            ? words[i + 2].text : "";
+
+        if (rules.strip_relative_times) {
+            // "3d" is a timestamp as "3d ago", at either end of the text or beside a
+            // separator ("alice · 3d"), but a word in "3d printing tutorial"
+            if (is_compact_time(t)) {
+                bool standalone = words[i].after_separator || i + 1 == words.size() ||
+                                  (i == 0 && words[i].before_separator);
+                if (next == "ago" || standalone) {
+                    if (next == "ago") i++;
+                    continue;
+                }
+            }
+            // Spelled-out units only as a timestamp ("5 years ago"), not "lived there 5 years"
+            bool quantity = is_count(t, nullptr) || t == "a" || t == "an";
+            if (quantity && contains(kTimeUnitWords, next) && after_next == "ago") {
+                i += 2;
+                continue;
+            }
+            if (t == "yesterday" || (t == "just" && next == "now")) {
+                if (t == "just") i++;
+                continue;
+            }
+        }
+
+        bool abbreviated = false;
+        if (is_count(t, &abbreviated)) {
+            if (contains(rules.count_nouns, next)) {
+                i++;
+                continue;
+            }
+            if (rules.strip_bare_counts && abbreviated) {
+                continue;
+            }
+        }
+
+        kept.push_back(t);
+    }
+
+    std::string canonical;
+    canonical.reserve(content.size());
+    for (const auto& t : kept) {
+        if (!canonical.empty()) canonical += ' ';
+        canonical += t;
+    }
+
+    // Text made only of volatile tokens must not collapse onto one shared key
+    if (canonical.empty()) {
+        canonical = content;
+    }
+    return canonical;
+}
+
+uint64_t ContentCanonicalizer::canonical_hash(const std::string& content, const std::string& app_package) const {
+    return content_hash::hash_string(canonicalize(content, app_package));
+}
+
+} // namespace scrollguard
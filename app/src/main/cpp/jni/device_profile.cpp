@@ -0,0 +1,209 @@
+#include "../include/device_profile.h"
+#include "../include/sha256.h"
+#include <android/log.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_FPHP
+#define HWCAP_FPHP (1 << 9)
+#endif
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1 << 22)
+#endif
+#ifndef HWCAP2_I8MM
+#define HWCAP2_I8MM (1 << 13)
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#define LOG_TAG "ScrollGuard-DeviceProfile"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+constexpr const char* kProfileHeader = "scrollguard-profile 1";
+
+CpuFeatures detect_features() {
+    CpuFeatures features;
+    features.cores = static_cast<int>(std::thread::hardware_concurrency());
+
+#if defined(__aarch64__)
+    features.arch = "arm64";
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    features.fp16 = hwcap & HWCAP_FPHP;
+    features.dotprod = hwcap & HWCAP_ASIMDDP;
+    features.sve = hwcap & HWCAP_SVE;
+    features.i8mm = hwcap2 & HWCAP2_I8MM;
+#elif defined(__x86_64__) || defined(__i386__)
+    features.arch = sizeof(void*) == 8 ? "x86_64" : "x86";
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        features.fp16 = ecx & bit_F16C;
+    }
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        features.avx2 = ebx & bit_AVX2;
+        features.avx512 = ebx & bit_AVX512F;
+    }
+#else
+    features.arch = "other";
+#endif
+    return features;
+}
+
+bool read_profile(const std::string& path, std::map<std::string, std::string>* values) {
+    std::ifstream file(path);
+    std::string line;
+    if (!file.good() || !std::getline(file, line) || line != kProfileHeader) {
+        return false;
+    }
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            (*values)[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+    }
+    return true;
+}
+
+uint64_t to_u64(const std::map<std::string, std::string>& values, const char* key) {
+    auto it = values.find(key);
+    return it == values.end() ? 0 : std::strtoull(it->second.c_str(), nullptr, 10);
+}
+
+} // namespace
+
+std::string CpuFeatures::fingerprint() const {
+    std::string result = arch;
+    if (dotprod) result += "+dotprod";
+    if (i8mm) result += "+i8mm";
+    if (sve) result += "+sve";
+    if (fp16) result += "+fp16";
+    if (avx2) result += "+avx2";
+    if (avx512) result += "+avx512";
+    return result + "/" + std::to_string(cores);
+}
+
+namespace cpu_features {
+
+const CpuFeatures& detect() {
+    static const CpuFeatures features = detect_features();
+    return features;
+}
+
+} // namespace cpu_features
+
+namespace device_profile {
+
+std::string profile_path(const std::string& model_path) {
+    return model_path + ".profile";
+}
+
+bool load(const std::string& model_path, WeightLayoutProfile* profile) {
+    std::map<std::string, std::string> values;
+    if (!read_profile(profile_path(model_path), &values)) {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(model_path.c_str(), &st) != 0) {
+        return false;
+    }
+
+    profile->model_sha256 = values["model_sha256"];
+    profile->model_size = to_u64(values, "model_size");
+    profile->model_mtime = static_cast<int64_t>(to_u64(values, "model_mtime"));
+    profile->cpu_fingerprint = values["cpu"];
+    profile->use_extra_bufts = values["use_extra_bufts"] == "1";
+    profile->repacked.load_ms = static_cast<uint32_t>(to_u64(values, "repacked_load_ms"));
+    profile->repacked.eval_ms = static_cast<uint32_t>(to_u64(values, "repacked_eval_ms"));
+    profile->mapped.load_ms = static_cast<uint32_t>(to_u64(values, "mapped_load_ms"));
+    profile->mapped.eval_ms = static_cast<uint32_t>(to_u64(values, "mapped_eval_ms"));
+
+    if (profile->cpu_fingerprint != cpu_features::detect().fingerprint()) {
+        LOGD("Profile for %s was measured on %s, re-measuring", model_path.c_str(), profile->cpu_fingerprint.c_str());
+        return false;
+    }
+    if (profile->model_size != static_cast<uint64_t>(st.st_size)) {
+        return false;
+    }
+    if (profile->model_mtime == static_cast<int64_t>(st.st_mtime)) {
+        return true;
+    }
+
+    // Same size, new mtime (re-downloaded or copied): trust the content hash
+    std::string digest;
+    if (!sha256::hash_file(model_path, &digest) || digest != profile->model_sha256) {
+        return false;
+    }
+    profile->model_mtime = static_cast<int64_t>(st.st_mtime);
+    store(model_path, profile);
+    return true;
+}
+
+bool store(const std::string& model_path, WeightLayoutProfile* profile) {
+    struct stat st;
+    if (stat(model_path.c_str(), &st) != 0) {
+        return false;
+    }
+    if (profile->model_sha256.empty() || profile->model_size != static_cast<uint64_t>(st.st_size)) {
+        if (!sha256::hash_file(model_path, &profile->model_sha256)) {
+            return false;
+        }
+    }
+    profile->model_size = static_cast<uint64_t>(st.st_size);
+    profile->model_mtime = static_cast<int64_t>(st.st_mtime);
+    profile->cpu_fingerprint = cpu_features::detect().fingerprint();
+
+    std::string path = profile_path(model_path);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        if (!file.good()) {
+            LOGE("Cannot write %s", temp.c_str());
+            return false;
+        }
+        file << kProfileHeader << "\n"
+             << "model_sha256=" << profile->model_sha256 << "\n"
+             << "model_size=" << profile->model_size << "\n"
+             << "model_mtime=" << profile->model_mtime << "\n"
+             << "cpu=" << profile->cpu_fingerprint << "\n"
+             << "use_extra_bufts=" << (profile->use_extra_bufts ? 1 : 0) << "\n"
+             << "repacked_load_ms=" << profile->repacked.load_ms << "\n"
+             << "repacked_eval_ms=" << profile->repacked.eval_ms << "\n"
+             << "mapped_load_ms=" << profile->mapped.load_ms << "\n"
+             << "mapped_eval_ms=" << profile->mapped.eval_ms << "\n";
+        if (!file.good()) {
+            return false;
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool prefer_repacked(const LayoutTiming& repacked, const LayoutTiming& mapped) {
+    uint64_t repacked_cost = repacked.load_ms + static_cast<uint64_t>(kCallsPerLaunch) * repacked.eval_ms;
+    uint64_t mapped_cost = mapped.load_ms + static_cast<uint64_t>(kCallsPerLaunch) * mapped.eval_ms;
+    return repacked_cost <= mapped_cost;
+}
+
+} // namespace device_profile
+
+} // namespace scrollguard
@@ -0,0 +1,433 @@
+#include "../include/gguf_parser.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#define LOG_TAG "ScrollGuard-GGUF"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x46554747; // "GGUF" little-endian
+constexpr uint32_t kMaxDims = 4;
+
+enum ValueType : uint32_t {
+    TYPE_UINT8 = 0, TYPE_INT8 = 1, TYPE_UINT16 = 2, TYPE_INT16 = 3,
+    TYPE_UINT32 = 4, TYPE_INT32 = 5, TYPE_FLOAT32 = 6, TYPE_BOOL = 7,
+    TYPE_STRING = 8, TYPE_ARRAY = 9, TYPE_UINT64 = 10, TYPE_INT64 = 11,
+    TYPE_FLOAT64 = 12
+};
+
+struct TypeTraits {
+    const char* name;
+    uint32_t block_size;  // Elements per block
+    uint32_t type_size;   // Bytes per block
+};
+
+// Indexed by ggml_type; null names are removed or unassigned ids
+const TypeTraits kTypeTraits[] = {
+    {"F32", 1, 4}, {"F16", 1, 2}, {"Q4_0", 32, 18}, {"Q4_1", 32, 20},
+    {nullptr, 0, 0}, {nullptr, 0, 0}, {"Q5_0", 32, 22}, {"Q5_1", 32, 24},
+    {"Q8_0", 32, 34}, {"Q8_1", 32, 36}, {"Q2_K", 256, 84}, {"Q3_K", 256, 110},
+    {"Q4_K", 256, 144}, {"Q5_K", 256, 176}, {"Q6_K", 256, 210}, {"Q8_K", 256, 292},
+    {"IQ2_XXS", 256, 66}, {"IQ2_XS", 256, 74}, {"IQ3_XXS", 256, 98}, {"IQ1_S", 256, 50},
+    {"IQ4_NL", 32, 18}, {"IQ3_S", 256, 110}, {"IQ2_S", 256, 82}, {"IQ4_XS", 256, 136},
+    {"I8", 1, 1}, {"I16", 1, 2}, {"I32", 1, 4}, {"I64", 1, 8},
+    {"F64", 1, 8}, {"IQ1_M", 256, 56}, {"BF16", 1, 2}, {nullptr, 0, 0},
+    {nullptr, 0, 0}, {nullptr, 0, 0}, {"TQ1_0", 256, 54}, {"TQ2_0", 256, 66},
+    {nullptr, 0, 0}, {nullptr, 0, 0}, {nullptr, 0, 0}, {"MXFP4", 32, 17}
+};
+
+constexpr uint32_t kTypeCount = sizeof(kTypeTraits) / sizeof(kTypeTraits[0]);
+
+size_t scalar_size(uint32_t type) {
+    switch (type) {
+        case TYPE_UINT8: case TYPE_INT8: case TYPE_BOOL: return 1;
+        case TYPE_UINT16: case TYPE_INT16: return 2;
+        case TYPE_UINT32: case TYPE_INT32: case TYPE_FLOAT32: return 4;
+        case TYPE_UINT64: case TYPE_INT64: case TYPE_FLOAT64: return 8;
+        default: return 0;
+    }
+}
+
+/**
+ * Bounds-checked little-endian cursor over the mapping
+ */
+class Reader {
+public:
+    Reader(const uint8_t* begin, const uint8_t* end) : pos_(begin), begin_(begin), end_(end) {}
+
+    size_t offset() const { return static_cast<size_t>(pos_ - begin_); }
+    size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+
+    template <typename T>
+    bool read(T* out) {
+        if (remaining() < sizeof(T)) return false;
+        std::memcpy(out, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool read_string(std::string_view* out) {
+        uint64_t length;
+        if (!read(&length) || length > remaining()) return false;
+        *out = std::string_view(reinterpret_cast<const char*>(pos_), static_cast<size_t>(length));
+        pos_ += length;
+        return true;
+    }
+
+    bool skip(uint64_t bytes) {
+        if (bytes > remaining()) return false;
+        pos_ += bytes;
+        return true;
+    }
+
+    // Read an integer scalar of any width as uint64
+    bool read_integer(uint32_t type, uint64_t* out) {
+        switch (type) {
+            case TYPE_UINT8: case TYPE_INT8: case TYPE_BOOL: { uint8_t v; if (!read(&v)) return false; *out = v; return true; }
+            case TYPE_UINT16: case TYPE_INT16: { uint16_t v; if (!read(&v)) return false; *out = v; return true; }
+            case TYPE_UINT32: case TYPE_INT32: { uint32_t v; if (!read(&v)) return false; *out = v; return true; }
+            case TYPE_UINT64: case TYPE_INT64: { uint64_t v; if (!read(&v)) return false; *out = v; return true; }
+            default: return false;
+        }
+    }
+
+private:
+    const uint8_t* pos_;
+    const uint8_t* begin_;
+    const uint8_t* end_;
+};
+
+bool is_integer_type(uint32_t type) {
+    return type <= TYPE_INT32 || type == TYPE_BOOL || type == TYPE_UINT64 || type == TYPE_INT64;
+}
+
+} // namespace
+
+namespace gguf {
+
+const char* type_name(uint32_t type) {
+    if (type < kTypeCount && kTypeTraits[type].name) {
+        return kTypeTraits[type].name;
+    }
+    return "unknown";
+}
+
+bool is_known_type(uint32_t type) {
+    return type < kTypeCount && kTypeTraits[type].name;
+}
+
+uint64_t tensor_bytes(uint32_t type, uint64_t n_elements) {
+    if (!is_known_type(type)) {
+        return 0;
+    }
+    const TypeTraits& traits = kTypeTraits[type];
+    uint64_t blocks = n_elements / traits.block_size + (n_elements % traits.block_size != 0 ? 1 : 0);
+    if (blocks > UINT64_MAX / traits.type_size) {
+        return UINT64_MAX;
+    }
+    return blocks * traits.type_size;
+}
+
+} // namespace gguf
+
+GgufFile::GgufFile() = default;
+
+GgufFile::~GgufFile() {
+    close();
+}
+
+bool GgufFile::fail(const std::string& message) {
+    error_ = message;
+    valid_ = false;
+    LOGE("Invalid GGUF file: %s", message.c_str());
+    return false;
+}
+
+bool GgufFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return fail("cannot open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return fail(std::string("cannot stat model file: ") + strerror(errno));
+    }
+
+    bool ok = map(fd, 0, static_cast<uint64_t>(st.st_size));
+    ::close(fd);
+    return ok;
+}
+
+bool GgufFile::open(int fd, uint64_t offset, uint64_t length) {
+    close();
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return fail(std::string("cannot stat model source: ") + strerror(errno));
+    }
+    if (offset > static_cast<uint64_t>(st.st_size) || length > static_cast<uint64_t>(st.st_size) - offset) {
+        return fail("model range " + std::to_string(offset) + "+" + std::to_string(length) +
+                    " exceeds source size " + std::to_string(st.st_size));
+    }
+    return map(fd, offset, length);
+}
+
+bool GgufFile::map(int fd, uint64_t offset, uint64_t length) {
+    if (length < 24) {
+        return fail("file too small for a GGUF header (" + std::to_string(length) + " bytes)");
+    }
+
+    // mmap offsets must be page aligned; an embedded GGUF generally is not
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t aligned = offset & ~(page - 1);
+    size_t lead = static_cast<size_t>(offset - aligned);
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(length) + lead, PROT_READ, MAP_PRIVATE, fd,
+                         static_cast<off_t>(aligned));
+    if (mapping == MAP_FAILED) {
+        return fail(std::string("mmap failed: ") + strerror(errno));
+    }
+
+    mapping_ = mapping;
+    mapping_size_ = static_cast<size_t>(length) + lead;
+    data_ = static_cast<const uint8_t*>(mapping) + lead;
+    size_ = static_cast<size_t>(length);
+
+    // The header is read front to back once
+    madvise(mapping_, mapping_size_, MADV_SEQUENTIAL);
+
+    valid_ = parse();
+    if (valid_) {
+        LOGD("Parsed GGUF: %s", summary().c_str());
+    }
+    return valid_;
+}
+
+void GgufFile::close() {
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    data_ = nullptr;
+    size_ = 0;
+    valid_ = false;
+    error_.clear();
+    info_ = GgufModelInfo();
+    tensors_.clear();
+}
+
+bool GgufFile::parse() {
+    Reader reader(data_, data_ + size_);
+    info_.file_size = size_;
+
+    uint32_t magic;
+    reader.read(&magic);
+    if (magic != kMagic) {
+        return fail("bad magic");
+    }
+
+    reader.read(&info_.version);
+    if (info_.version < 2 || info_.version > 3) {
+        // Version 1 used 32-bit counts and is no longer produced
+        return fail("unsupported version " + std::to_string(info_.version));
+    }
+
+    reader.read(&info_.tensor_count);
+    if (!reader.read(&info_.kv_count)) {
+        return fail("truncated header");
+    }
+
+    // Integer scalars, resolved against the architecture prefix after the pass
+    std::vector<std::pair<std::string_view, uint64_t>> integers;
+    std::string_view architecture;
+
+    for (uint64_t i = 0; i < info_.kv_count; i++) {
+        std::string_view key;
+        uint32_t type;
+        if (!reader.read_string(&key) || !reader.read(&type)) {
+            return fail("truncated metadata key " + std::to_string(i));
+        }
+
+        if (type == TYPE_STRING) {
+            std::string_view value;
+            if (!reader.read_string(&value)) {
+                return fail("truncated string value for " + std::string(key));
+            }
+            if (key == "general.architecture") {
+                architecture = value;
+            } else if (key == "general.name") {
+                info_.name = std::string(value);
+            }
+        } else if (type == TYPE_ARRAY) {
+            uint32_t element_type;
+            uint64_t count;
+            if (!reader.read(&element_type) || !reader.read(&count)) {
+                return fail("truncated array header for " + std::string(key));
+            }
+            if (key == "tokenizer.ggml.tokens") {
+                info_.vocab_size = count;
+            }
+
+            if (element_type == TYPE_STRING) {
+                for (uint64_t j = 0; j < count; j++) {
+                    std::string_view element;
+                    if (!reader.read_string(&element)) {
+                        return fail("truncated string array " + std::string(key));
+                    }
+                }
+            } else {
+                size_t element_size = scalar_size(element_type);
+                if (element_size == 0) {
+                    return fail("unsupported array element type " + std::to_string(element_type));
+                }
+                if (count > reader.remaining() / element_size || !reader.skip(count * element_size)) {
+                    return fail("truncated array " + std::string(key));
+                }
+            }
+        } else if (is_integer_type(type)) {
+            uint64_t value;
+            if (!reader.read_integer(type, &value)) {
+                return fail("truncated value for " + std::string(key));
+            }
+            if (key == "general.alignment") {
+                info_.alignment = static_cast<uint32_t>(value);
+            } else if (key == "general.file_type") {
+                info_.file_type = static_cast<uint32_t>(value);
+            } else {
+                integers.emplace_back(key, value);
+            }
+        } else {
+            size_t value_size = scalar_size(type);
+            if (value_size == 0 || !reader.skip(value_size)) {
+                return fail("bad value type " + std::to_string(type) + " for " + std::string(key));
+            }
+        }
+    }
+
+    if (info_.alignment == 0 || (info_.alignment & (info_.alignment - 1)) != 0) {
+        return fail("alignment " + std::to_string(info_.alignment) + " is not a power of two");
+    }
+
+    // Each tensor info is at least name length + n_dims + type + offset
+    if (info_.tensor_count > reader.remaining() / 24) {
+        return fail("tensor count " + std::to_string(info_.tensor_count) + " exceeds file size");
+    }
+
+    tensors_.reserve(static_cast<size_t>(info_.tensor_count));
+    for (uint64_t i = 0; i < info_.tensor_count; i++) {
+        GgufTensorInfo tensor;
+        if (!reader.read_string(&tensor.name) || !reader.read(&tensor.n_dims)) {
+            return fail("truncated tensor info " + std::to_string(i));
+        }
+        if (tensor.n_dims == 0 || tensor.n_dims > kMaxDims) {
+            return fail("tensor " + std::string(tensor.name) + " has " + std::to_string(tensor.n_dims) + " dims");
+        }
+
+        uint64_t n_elements = 1;
+        for (uint32_t d = 0; d < tensor.n_dims; d++) {
+            if (!reader.read(&tensor.dims[d])) {
+                return fail("truncated dims for " + std::string(tensor.name));
+            }
+            if (tensor.dims[d] != 0 && n_elements > UINT64_MAX / tensor.dims[d]) {
+                return fail("element count overflow in " + std::string(tensor.name));
+            }
+            n_elements *= tensor.dims[d];
+        }
+
+        if (!reader.read(&tensor.type) || !reader.read(&tensor.offset)) {
+            return fail("truncated tensor info for " + std::string(tensor.name));
+        }
+        // An unknown type has no size to check against the file, so the model
+        // cannot be validated or sized: fail closed rather than count it as empty
+        if (!gguf::is_known_type(tensor.type)) {
+            return fail("tensor " + std::string(tensor.name) + " has unsupported type " +
+                        std::to_string(tensor.type));
+        }
+        tensor.size_bytes = gguf::tensor_bytes(tensor.type, n_elements);
+        tensors_.push_back(tensor);
+    }
+
+    info_.data_offset = (reader.offset() + info_.alignment - 1) / info_.alignment * info_.alignment;
+    if (info_.data_offset > size_) {
+        return fail("tensor data section starts past end of file");
+    }
+
+    // Offsets must be aligned and every tensor must fit inside the file
+    uint64_t data_size = size_ - info_.data_offset;
+    uint64_t bytes_by_type[kTypeCount] = {0};
+    for (const auto& tensor : tensors_) {
+        if (tensor.offset % info_.alignment != 0) {
+            return fail("tensor " + std::string(tensor.name) + " offset is not aligned");
+        }
+        if (tensor.offset > data_size || tensor.size_bytes > data_size - tensor.offset) {
+            return fail("tensor " + std::string(tensor.name) + " extends past end of file (truncated download?)");
+        }
+
+        info_.weights_bytes += tensor.size_bytes;
+        bytes_by_type[tensor.type] += tensor.size_bytes;
+    }
+    info_.dominant_type = static_cast<uint32_t>(
+        std::max_element(bytes_by_type, bytes_by_type + kTypeCount) - bytes_by_type);
+
+    // Resolve architecture-prefixed hyperparameters ("llama.context_length")
+    info_.architecture = std::string(architecture);
+    for (const auto& kv : integers) {
+        std::string_view key = kv.first;
+        if (architecture.empty() || key.size() <= architecture.size() + 1 ||
+            key.compare(0, architecture.size(), architecture) != 0 || key[architecture.size()] != '.') {
+            continue;
+        }
+
+        std::string_view field = key.substr(architecture.size() + 1);
+        if (field == "context_length") info_.context_length = kv.second;
+        else if (field == "block_count") info_.block_count = kv.second;
+        else if (field == "embedding_length") info_.embedding_length = kv.second;
+        else if (field == "attention.head_count") info_.head_count = kv.second;
+        else if (field == "attention.head_count_kv") info_.head_count_kv = kv.second;
+        else if (field == "attention.key_length") info_.key_length = kv.second;
+        else if (field == "attention.value_length") info_.value_length = kv.second;
+        else if (field == "vocab_size" && info_.vocab_size == 0) info_.vocab_size = kv.second;
+    }
+
+    if (info_.head_count_kv == 0) {
+        info_.head_count_kv = info_.head_count;
+    }
+    if (info_.head_count > 0) {
+        if (info_.key_length == 0) info_.key_length = info_.embedding_length / info_.head_count;
+        if (info_.value_length == 0) info_.value_length = info_.embedding_length / info_.head_count;
+    }
+
+    return true;
+}
+
+std::string GgufFile::summary() const {
+    if (!valid_) {
+        return "Invalid model file: " + error_;
+    }
+
+    return "GGUF v" + std::to_string(info_.version) + " " +
+        (info_.architecture.empty() ? std::string("unknown") : info_.architecture) +
+        (info_.name.empty() ? "" : " (" + info_.name + ")") +
+        ", " + std::to_string(info_.tensor_count) + " tensors, " +
+        gguf::type_name(info_.dominant_type) + ", vocab " + std::to_string(info_.vocab_size) +
+        ", ctx " + std::to_string(info_.context_length) +
+        ", " + std::to_string(info_.file_size / 1024 / 1024) + " MB";
+}
+
+} // namespace scrollguard
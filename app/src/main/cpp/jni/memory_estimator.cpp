@@ -0,0 +1,199 @@
+#include "../include/memory_estimator.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#define LOG_TAG "ScrollGuard-Memory"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+constexpr uint32_t kTypeQ8_0 = 8;           // ggml_type
+constexpr uint64_t kKvCellPadding = 256;    // llama.cpp pads the KV cache to 256 cells
+constexpr uint64_t kMaxUbatch = 512;
+constexpr uint64_t kRuntimeOverheadBytes = 48ull * 1024 * 1024; // Graph metadata, threadpool, allocator slack
+
+/**
+ * Read a single integer from a sysfs/cgroup file; 0 for "max" or on failure
+ */
+uint64_t read_uint64_file(const std::string& path) {
+    std::ifstream file(path);
+    std::string value;
+    if (!file.is_open() || !(file >> value) || value == "max") {
+        return 0;
+    }
+    uint64_t parsed = std::strtoull(value.c_str(), nullptr, 10);
+    // cgroup v1 reports "unlimited" as a page-rounded LONG_MAX
+    return parsed >= (1ull << 60) ? 0 : parsed;
+}
+
+/**
+ * Locate this process's memory cgroup: v2 unified hierarchy first, then v1
+ */
+void read_cgroup_memory(SystemMemory* memory) {
+    std::ifstream cgroups("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(cgroups, line)) {
+        // Format: hierarchy-id:controllers:path
+        size_t first = line.find(':');
+        size_t second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            continue;
+        }
+
+        std::string controllers = line.substr(first + 1, second - first - 1);
+        std::string path = line.substr(second + 1);
+
+        if (line.compare(0, first, "0") == 0 && controllers.empty()) {
+            std::string base = "/sys/fs/cgroup" + path;
+            memory->cgroup_limit = read_uint64_file(base + "/memory.max");
+            memory->cgroup_usage = read_uint64_file(base + "/memory.current");
+        } else if (controllers.find("memory") != std::string::npos) {
+            std::string base = "/sys/fs/cgroup/memory" + path;
+            memory->cgroup_limit = read_uint64_file(base + "/memory.limit_in_bytes");
+            memory->cgroup_usage = read_uint64_file(base + "/memory.usage_in_bytes");
+        }
+
+        if (memory->cgroup_limit > 0) {
+            return;
+        }
+    }
+}
+
+uint64_t kv_type_size(int type, uint64_t n_elements) {
+    uint64_t bytes = gguf::tensor_bytes(static_cast<uint32_t>(type), n_elements);
+    return bytes > 0 ? bytes : n_elements * 2; // Unknown types sized as F16
+}
+
+std::string to_mb(uint64_t bytes) {
+    return std::to_string(bytes / 1024 / 1024) + " MB";
+}
+
+} // namespace
+
+namespace memory_estimator {
+
+MemoryEstimate estimate(const GgufModelInfo& info, const ModelConfig& config) {
+    MemoryEstimate result;
+
+    // Weights are touched on every token, so count every mapped byte as resident
+    result.weights_bytes = info.weights_bytes;
+
+    // KV cache: one K and one V row per layer per cell; cells are shared by all sequences
+    uint64_t cells = (static_cast<uint64_t>(std::max(config.n_ctx, 1)) + kKvCellPadding - 1) /
+                     kKvCellPadding * kKvCellPadding;
+    uint64_t k_row = info.head_count_kv * info.key_length;
+    uint64_t v_row = info.head_count_kv * info.value_length;
+    result.kv_cache_bytes = info.block_count *
+        (kv_type_size(config.type_k, cells * k_row) + kv_type_size(config.type_v, cells * v_row));
+
+    // Compute buffer: the widest activation of one micro-batch (attention
+    // scores or the FFN row), plus vocab-wide logits for the output rows only
+    // (one per sequence) and the host copy of those logits
+    uint64_t ubatch = std::min<uint64_t>(cells, kMaxUbatch);
+    uint64_t widest = std::max<uint64_t>(cells * info.head_count, 4 * info.embedding_length);
+    uint64_t outputs = static_cast<uint64_t>(std::max(config.n_seq_max, 1));
+    result.compute_bytes = (ubatch * widest + 2 * outputs * info.vocab_size) * sizeof(float);
+
+    result.overhead_bytes = kRuntimeOverheadBytes;
+    result.total_bytes = result.weights_bytes + result.kv_cache_bytes + result.compute_bytes + result.overhead_bytes;
+    return result;
+}
+
+SystemMemory read_system_memory() {
+    SystemMemory memory;
+
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        unsigned long long kb = 0;
+        if (std::sscanf(line.c_str(), "MemAvailable: %llu kB", &kb) == 1) {
+            memory.mem_available = kb * 1024;
+            break;
+        }
+    }
+
+    read_cgroup_memory(&memory);
+
+    memory.headroom = memory.mem_available;
+    if (memory.cgroup_limit > 0) {
+        uint64_t cgroup_free = memory.cgroup_limit > memory.cgroup_usage ? memory.cgroup_limit - memory.cgroup_usage : 0;
+        memory.headroom = memory.headroom > 0 ? std::min(memory.headroom, cgroup_free) : cgroup_free;
+    }
+    return memory;
+}
+
+bool select_config(const GgufModelInfo& info, const ModelConfig& requested,
+                   const SystemMemory& memory, ModelConfig* selected, MemoryEstimate* selected_estimate) {
+    if (memory.headroom == 0) {
+        // Nothing readable (unusual sandbox); don't block the load on a missing signal
+        LOGD("System memory unknown, keeping requested configuration");
+        *selected = requested;
+        if (selected_estimate) *selected_estimate = estimate(info, requested);
+        return true;
+    }
+
+    uint64_t budget = memory.headroom > kSafetyMarginBytes ? memory.headroom - kSafetyMarginBytes : 0;
+
+    ModelConfig candidate = requested;
+    auto fits = [&](const ModelConfig& config) {
+        MemoryEstimate e = estimate(info, config);
+        if (e.total_bytes <= budget) {
+            *selected = config;
+            if (selected_estimate) *selected_estimate = e;
+            return true;
+        }
+        return false;
+    };
+
+    if (fits(candidate)) {
+        return true;
+    }
+
+    // Classification prompts are short, so trade context first
+    while (candidate.n_ctx / 2 >= kMinContext) {
+        candidate.n_ctx /= 2;
+        if (fits(candidate)) {
+            LOGD("Reduced n_ctx to %d to fit %s", candidate.n_ctx, to_mb(budget).c_str());
+            return true;
+        }
+    }
+
+    if (candidate.n_seq_max > 1) {
+        candidate.n_seq_max = 1;
+        if (fits(candidate)) {
+            LOGD("Reduced to a single sequence to fit %s", to_mb(budget).c_str());
+            return true;
+        }
+    }
+
+    // Only K: a quantized V cache needs flash attention
+    candidate.type_k = kTypeQ8_0;
+    if (fits(candidate)) {
+        LOGD("Using a Q8_0 K cache to fit %s", to_mb(budget).c_str());
+        return true;
+    }
+
+    MemoryEstimate smallest = estimate(info, candidate);
+    LOGE("Model needs at least %s but only %s is available",
+         to_mb(smallest.total_bytes).c_str(), to_mb(budget).c_str());
+    if (selected_estimate) *selected_estimate = smallest;
+    return false;
+}
+
+std::string describe(const MemoryEstimate& estimate) {
+    return "weights " + to_mb(estimate.weights_bytes) +
+        ", kv " + to_mb(estimate.kv_cache_bytes) +
+        ", compute " + to_mb(estimate.compute_bytes) +
+        ", total " + to_mb(estimate.total_bytes);
+}
+
+} // namespace memory_estimator
+
+} // namespace scrollguard
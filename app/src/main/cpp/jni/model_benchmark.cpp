@@ -0,0 +1,200 @@
+#include "../include/model_benchmark.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+#define LOG_TAG "ScrollGuard-Benchmark"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace model_benchmark {
+
+namespace {
+
+// Typical feed posts of different lengths; latency runs cycle through them
+const char* const kCalibrationPosts[] = {
+    "A step-by-step guide to reading research papers efficiently",
+    "lol this cat video is everything 😂😂 #cats #funny #fyp",
+    "Thread: what I learned shipping my first Android app, from project setup "
+    "to Play Store review, including the mistakes that cost me two weeks",
+    "You won't BELIEVE what happened next... like and share before it's deleted!!!",
+    "New lecture series on linear algebra for machine learning, with exercises "
+    "and worked solutions for every chapter",
+    "Sunset at the beach 🌅",
+    "Breaking: markets react to the latest interest rate decision, analysts "
+    "expect further volatility over the coming weeks as inflation data lands",
+    "Day 47 of learning Spanish: today I finally understood the subjunctive",
+};
+constexpr size_t kCalibrationPostCount = sizeof(kCalibrationPosts) / sizeof(kCalibrationPosts[0]);
+
+uint32_t elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+#ifdef LLAMA_CPP_AVAILABLE
+/**
+ * A model and context loaded for benchmarking only
+ */
+struct Session {
+    llama_model* model = nullptr;
+    llama_context* ctx = nullptr;
+
+    ~Session() {
+        if (ctx) llama_free(ctx);
+        if (model) llama_model_free(model);
+    }
+
+    bool open(const ModelConfig& config) {
+        llama_backend_init();
+
+        llama_model_params model_params = llama_model_default_params();
+        model_params.use_mmap = config.use_mmap;
+        model_params.use_mlock = config.use_mlock;
+        model_params.n_gpu_layers = config.n_gpu_layers;
+        model_params.use_extra_bufts = config.use_extra_bufts;
+
+        model = llama_model_load_from_file(config.model_path.c_str(), model_params);
+        if (!model) {
+            LOGE("Benchmark could not load %s", config.model_path.c_str());
+            return false;
+        }
+
+        llama_context_params ctx_params = llama_context_default_params();
+        ctx_params.n_ctx = config.n_ctx;
+        ctx_params.n_threads = config.n_threads;
+        ctx_params.n_threads_batch = config.n_threads;
+        ctx_params.n_seq_max = config.n_seq_max;
+        ctx_params.kv_unified = true;
+        ctx_params.type_k = static_cast<ggml_type>(config.type_k);
+        ctx_params.type_v = static_cast<ggml_type>(config.type_v);
+
+        ctx = llama_init_from_model(model, ctx_params);
+        if (!ctx) {
+            LOGE("Benchmark could not create a context for %s", config.model_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<llama_token> tokenize(const char* post) const {
+        std::string prompt = content_utils::generate_classification_prompt(post);
+        std::vector<llama_token> tokens(prompt.size() + 8);
+        int32_t n_tokens = llama_tokenize(llama_model_get_vocab(model), prompt.c_str(),
+                                          static_cast<int32_t>(prompt.size()), tokens.data(),
+                                          static_cast<int32_t>(tokens.size()), true, true);
+        tokens.resize(n_tokens > 0 ? static_cast<size_t>(n_tokens) : 0);
+        return tokens;
+    }
+
+    // Prefill tokens into an empty cache
+    bool prefill(std::vector<llama_token>& tokens) {
+        llama_memory_clear(llama_get_memory(ctx), true);
+        return llama_decode(ctx, llama_batch_get_one(tokens.data(), static_cast<int32_t>(tokens.size()))) == 0;
+    }
+};
+#endif
+
+} // namespace
+
+bool warm_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<char> buffer(1 << 20);
+    ssize_t n;
+    do {
+        n = read(fd, buffer.data(), buffer.size());
+    } while (n > 0 || (n < 0 && errno == EINTR));
+    close(fd);
+    return n == 0;
+}
+
+bool measure(const ModelConfig& config, LayoutTiming* timing) {
+#ifdef LLAMA_CPP_AVAILABLE
+    auto load_start = std::chrono::steady_clock::now();
+    Session session;
+    if (!session.open(config)) {
+        return false;
+    }
+    timing->load_ms = elapsed_ms(load_start);
+
+    std::vector<llama_token> tokens = session.tokenize(kCalibrationPosts[0]);
+
+    // First pass faults in the weights; time the second
+    bool ok = !tokens.empty() && session.prefill(tokens);
+    auto eval_start = std::chrono::steady_clock::now();
+    ok = ok && session.prefill(tokens);
+    timing->eval_ms = elapsed_ms(eval_start);
+
+    if (ok) {
+        LOGD("Benchmark %s (%s): load %ums, prefill %zu tokens %ums", config.model_path.c_str(),
+             config.use_extra_bufts ? "repacked" : "mapped", timing->load_ms, tokens.size(), timing->eval_ms);
+    }
+    return ok;
+#else
+    (void)config;
+    (void)timing;
+    return false;
+#endif
+}
+
+bool measure_latency(const ModelConfig& config, int runs, LatencyStats* stats) {
+#ifdef LLAMA_CPP_AVAILABLE
+    Session session;
+    if (!session.open(config) || runs <= 0) {
+        return false;
+    }
+
+    std::vector<std::vector<llama_token>> prompts;
+    for (const char* post : kCalibrationPosts) {
+        prompts.push_back(session.tokenize(post));
+        if (prompts.back().empty()) {
+            return false;
+        }
+    }
+
+    // Untimed pass to fault in the weights
+    if (!session.prefill(prompts[0])) {
+        return false;
+    }
+
+    std::vector<uint32_t> samples;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!session.prefill(prompts[static_cast<size_t>(i) % kCalibrationPostCount])) {
+            return false;
+        }
+        samples.push_back(elapsed_ms(start));
+    }
+
+    std::sort(samples.begin(), samples.end());
+    stats->runs = runs;
+    stats->p50_ms = samples[samples.size() / 2];
+    // Nearest-rank percentile
+    stats->p95_ms = samples[std::min(samples.size() - 1, (samples.size() * 95 + 99) / 100 - 1)];
+    stats->max_ms = samples.back();
+
+    LOGD("Latency of %s over %d runs: p50 %ums, p95 %ums, max %ums", config.model_path.c_str(),
+         runs, stats->p50_ms, stats->p95_ms, stats->max_ms);
+    return true;
+#else
+    (void)config;
+    (void)runs;
+    (void)stats;
+    return false;
+#endif
+}
+
+} // namespace model_benchmark
+
+} // namespace scrollguard
@@ -0,0 +1,843 @@
+#include "../include/model_downloader.h"
+#include <android/log.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define LOG_TAG "ScrollGuard-Downloader"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// HTTP
+// ---------------------------------------------------------------------------
+
+constexpr size_t kMaxHeaderBytes = 16 * 1024;
+constexpr size_t kRecvBufferSize = 64 * 1024;
+
+struct HttpUrl {
+    std::string host;
+    std::string port = "80";
+    std::string path = "/";
+};
+
+struct HttpResponse {
+    int status = 0;
+    std::map<std::string, std::string> headers;   // Lower-case names
+    std::string body_prefix;                       // Body bytes read along with the headers
+};
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return s;
+}
+
+bool parse_http_url(const std::string& url, HttpUrl* out, std::string* error) {
+    static const std::string kScheme = "http://";
+    if (lower(url.substr(0, kScheme.size())) != kScheme) {
+        *error = "Unsupported URL scheme (native fetcher is plain HTTP only): " + url;
+        return false;
+    }
+
+    std::string rest = url.substr(kScheme.size());
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    out->path = slash == std::string::npos ? "/" : rest.substr(slash);
+
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos && authority.find(']') == std::string::npos) {
+        out->host = authority.substr(0, colon);
+        out->port = authority.substr(colon + 1);
+    } else {
+        out->host = authority;
+    }
+    if (out->host.size() > 2 && out->host.front() == '[' && out->host.back() == ']') {
+        out->host = out->host.substr(1, out->host.size() - 2);
+    }
+
+    if (out->host.empty()) {
+        *error = "Missing host in URL: " + url;
+        return false;
+    }
+    return true;
+}
+
+int connect_to(const HttpUrl& url, std::string* error) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = nullptr;
+    int rc = getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &addresses);
+    if (rc != 0) {
+        *error = "Cannot resolve " + url.host + ": " + gai_strerror(rc);
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* ai = addresses; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        struct timeval timeout = {HttpRangeFetcher::kTimeoutSeconds, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (fd < 0) {
+        *error = "Cannot connect to " + url.host + ":" + url.port + ": " + strerror(errno);
+    }
+    return fd;
+}
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_response_head(int fd, HttpResponse* response, std::string* error) {
+    std::string head;
+    char buffer[4096];
+    size_t end = std::string::npos;
+    while (end == std::string::npos) {
+        if (head.size() > kMaxHeaderBytes) {
+            *error = "Response headers too large";
+            return false;
+        }
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            *error = n == 0 ? "Connection closed before response" : std::string("Receive failed: ") + strerror(errno);
+            return false;
+        }
+        head.append(buffer, static_cast<size_t>(n));
+        end = head.find("\r\n\r\n");
+    }
+
+    response->body_prefix = head.substr(end + 4);
+    head.resize(end);
+
+    size_t line_end = head.find("\r\n");
+    std::string status_line = head.substr(0, line_end);
+    if (status_line.compare(0, 5, "HTTP/") != 0 || status_line.find(' ') == std::string::npos) {
+        *error = "Malformed status line: " + status_line;
+        return false;
+    }
+    response->status = std::atoi(status_line.c_str() + status_line.find(' ') + 1);
+
+    size_t pos = line_end == std::string::npos ? head.size() : line_end + 2;
+    while (pos < head.size()) {
+        size_t next = head.find("\r\n", pos);
+        if (next == std::string::npos) next = head.size();
+        std::string line = head.substr(pos, next - pos);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            size_t value_start = line.find_first_not_of(" \t", colon + 1);
+            response->headers[lower(line.substr(0, colon))] =
+                value_start == std::string::npos ? "" : line.substr(value_start);
+        }
+        pos = next + 2;
+    }
+    return true;
+}
+
+/**
+ * Send a ranged GET, following redirects. On success returns the socket
+ * positioned at the body (minus body_prefix) of a non-redirect response.
+ */
+int open_range(const std::string& url, uint64_t first, uint64_t last,
+               HttpResponse* response, std::string* error) {
+    std::string current = url;
+    for (int redirects = 0; redirects <= HttpRangeFetcher::kMaxRedirects; redirects++) {
+        HttpUrl parsed;
+        if (!parse_http_url(current, &parsed, error)) {
+            return -1;
+        }
+
+        int fd = connect_to(parsed, error);
+        if (fd < 0) {
+            return -1;
+        }
+
+        std::string host_header = parsed.host.find(':') != std::string::npos ? "[" + parsed.host + "]" : parsed.host;
+        if (parsed.port != "80") {
+            host_header += ":" + parsed.port;
+        }
+        std::string request =
+            "GET " + parsed.path + " HTTP/1.1\r\n"
+            "Host: " + host_header + "\r\n"
+            "Range: bytes=" + std::to_string(first) + "-" + std::to_string(last) + "\r\n"
+            "Accept-Encoding: identity\r\n"
+            "User-Agent: ScrollGuard\r\n"
+            "Connection: close\r\n\r\n";
+
+        *response = HttpResponse();
+        if (!send_all(fd, request)) {
+            *error = std::string("Send failed: ") + strerror(errno);
+            close(fd);
+            return -1;
+        }
+        if (!read_response_head(fd, response, error)) {
+            close(fd);
+            return -1;
+        }
+
+        int status = response->status;
+        if (status == 301 || status == 302 || status == 303 || status == 307 || status == 308) {
+            close(fd);
+            auto location = response->headers.find("location");
+            if (location == response->headers.end() || location->second.empty()) {
+                *error = "Redirect without Location";
+                return -1;
+            }
+            if (location->second.front() == '/') {
+                current = "http://" + host_header + location->second;
+            } else {
+                current = location->second;
+            }
+            continue;
+        }
+        return fd;
+    }
+
+    *error = "Too many redirects";
+    return -1;
+}
+
+bool parse_u64(const std::string& s, uint64_t* value) {
+    if (s.empty() || !std::isdigit(static_cast<unsigned char>(s[0]))) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long v = std::strtoull(s.c_str(), &end, 10);
+    if (errno != 0 || end == s.c_str()) {
+        return false;
+    }
+    *value = static_cast<uint64_t>(v);
+    return true;
+}
+
+// "bytes <first>-<last>/<total>"; total may be "*"
+bool parse_content_range(const std::string& header, uint64_t* first, uint64_t* total) {
+    size_t space = header.find(' ');
+    size_t dash = header.find('-');
+    size_t slash = header.find('/');
+    if (space == std::string::npos || dash == std::string::npos || slash == std::string::npos) {
+        return false;
+    }
+    if (!parse_u64(header.substr(space + 1, dash - space - 1), first)) {
+        return false;
+    }
+    *total = 0;
+    parse_u64(header.substr(slash + 1), total);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Chunk sidecar
+// ---------------------------------------------------------------------------
+
+constexpr char kSidecarMagic[4] = {'S', 'G', 'D', 'L'};
+constexpr uint32_t kSidecarVersion = 1;
+
+struct SidecarHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t total_size;
+    uint64_t chunk_size;
+    uint64_t source_id;         // Identifies URL + expected digest
+    uint32_t chunk_count;
+    uint32_t hashed_chunks;     // Contiguous prefix folded into hash_state
+    Sha256::State hash_state;
+};
+// Followed by a bitmap of completed chunks, (chunk_count + 7) / 8 bytes
+
+uint64_t source_id_for(const DownloadOptions& options) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](const std::string& s) {
+        for (unsigned char c : s) {
+            h = (h ^ c) * 0x100000001b3ull;
+        }
+        h = (h ^ 0xff) * 0x100000001b3ull;
+    };
+    mix(options.url);
+    mix(lower(options.expected_sha256));
+    return h;
+}
+
+bool pwrite_all(int fd, const uint8_t* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool pread_all(int fd, uint8_t* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+void fsync_parent_dir(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * State of one download attempt. Chunk completion is serialized: the data
+ * file is synced before the sidecar claims a chunk, so after a crash the
+ * sidecar never lists bytes that are not on disk.
+ */
+class DownloadSession {
+public:
+    DownloadSession(const DownloadOptions& options, uint64_t total_size)
+        : options_(options), source_id_(source_id_for(options)) {
+        header_.total_size = total_size;
+        header_.chunk_size = options.chunk_size;
+        header_.chunk_count = static_cast<uint32_t>((total_size + options.chunk_size - 1) / options.chunk_size);
+        bitmap_.assign((header_.chunk_count + 7) / 8, 0);
+    }
+
+    ~DownloadSession() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    /**
+     * Open the partial file, resuming from the sidecar when it matches this
+     * source and size, otherwise starting over with a preallocated file.
+     */
+    bool open(bool* resumed, std::string* error) {
+        *resumed = try_resume();
+        if (*resumed) {
+            return true;
+        }
+
+        ModelDownloader::discard_partial(options_.target_path);
+        std::string partial = ModelDownloader::partial_path(options_.target_path);
+        fd_ = ::open(partial.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            *error = "Cannot create " + partial + ": " + strerror(errno);
+            return false;
+        }
+
+        // Reserve the space up front: fails fast on a full disk and avoids fragmentation
+        int rc = posix_fallocate(fd_, 0, static_cast<off_t>(header_.total_size));
+        if (rc == EOPNOTSUPP || rc == EINVAL) {
+            rc = ftruncate(fd_, static_cast<off_t>(header_.total_size)) == 0 ? 0 : errno;
+        }
+        if (rc != 0) {
+            *error = rc == ENOSPC ? "Not enough storage for model" : std::string("Cannot allocate model file: ") + strerror(rc);
+            return false;
+        }
+
+        std::memcpy(header_.magic, kSidecarMagic, sizeof(kSidecarMagic));
+        header_.version = kSidecarVersion;
+        header_.source_id = source_id_;
+        header_.hashed_chunks = 0;
+        hasher_.reset();
+        header_.hash_state = hasher_.save_state();
+        if (!persist_sidecar()) {
+            *error = "Cannot write download sidecar: " + std::string(strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<uint32_t> missing_chunks() const {
+        std::vector<uint32_t> missing;
+        for (uint32_t i = 0; i < header_.chunk_count; i++) {
+            if (!is_complete(i)) missing.push_back(i);
+        }
+        return missing;
+    }
+
+    uint64_t completed_bytes() const {
+        uint64_t bytes = 0;
+        for (uint32_t i = 0; i < header_.chunk_count; i++) {
+            if (is_complete(i)) bytes += chunk_length(i);
+        }
+        return bytes;
+    }
+
+    uint64_t chunk_offset(uint32_t chunk) const { return static_cast<uint64_t>(chunk) * header_.chunk_size; }
+
+    uint64_t chunk_length(uint32_t chunk) const {
+        return std::min(header_.chunk_size, header_.total_size - chunk_offset(chunk));
+    }
+
+    bool write(const uint8_t* data, size_t len, uint64_t offset) { return pwrite_all(fd_, data, len, offset); }
+
+    /**
+     * Mark a chunk as fetched; folds any newly contiguous chunks into the
+     * running hash and persists the sidecar
+     */
+    bool complete_chunk(uint32_t chunk, std::string* error) {
+        if (fdatasync(fd_) != 0) {
+            *error = std::string("Cannot sync model file: ") + strerror(errno);
+            return false;
+        }
+        bitmap_[chunk / 8] |= static_cast<uint8_t>(1u << (chunk % 8));
+        if (!advance_hash(error)) {
+            return false;
+        }
+        if (!persist_sidecar()) {
+            *error = std::string("Cannot write download sidecar: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Valid once every chunk is complete
+    std::string digest() { return hasher_.finish_hex(); }
+
+    bool all_hashed() const { return header_.hashed_chunks == header_.chunk_count; }
+
+    bool finalize(std::string* error) {
+        std::string partial = ModelDownloader::partial_path(options_.target_path);
+        if (fsync(fd_) != 0) {
+            *error = std::string("Cannot sync model file: ") + strerror(errno);
+            return false;
+        }
+        close(fd_);
+        fd_ = -1;
+
+        if (rename(partial.c_str(), options_.target_path.c_str()) != 0) {
+            *error = "Cannot move model into place: " + std::string(strerror(errno));
+            return false;
+        }
+        unlink(ModelDownloader::sidecar_path(options_.target_path).c_str());
+        fsync_parent_dir(options_.target_path);
+        return true;
+    }
+
+private:
+    bool is_complete(uint32_t chunk) const { return bitmap_[chunk / 8] & (1u << (chunk % 8)); }
+
+    bool try_resume() {
+        std::string sidecar = ModelDownloader::sidecar_path(options_.target_path);
+        int sfd = ::open(sidecar.c_str(), O_RDONLY | O_CLOEXEC);
+        if (sfd < 0) {
+            return false;
+        }
+
+        SidecarHeader stored;
+        std::vector<uint8_t> bitmap(bitmap_.size());
+        bool read_ok = pread_all(sfd, reinterpret_cast<uint8_t*>(&stored), sizeof(stored), 0) &&
+                       (bitmap.empty() || pread_all(sfd, bitmap.data(), bitmap.size(), sizeof(stored)));
+        close(sfd);
+
+        if (!read_ok ||
+            std::memcmp(stored.magic, kSidecarMagic, sizeof(kSidecarMagic)) != 0 ||
+            stored.version != kSidecarVersion ||
+            stored.source_id != source_id_ ||
+            stored.total_size != header_.total_size ||
+            stored.chunk_size != header_.chunk_size ||
+            stored.chunk_count != header_.chunk_count ||
+            stored.hashed_chunks > stored.chunk_count ||
+            stored.hash_state.length != std::min(stored.total_size,
+                                                 static_cast<uint64_t>(stored.hashed_chunks) * stored.chunk_size)) {
+            LOGD("Download sidecar for %s does not match, starting over", options_.target_path.c_str());
+            return false;
+        }
+
+        std::string partial = ModelDownloader::partial_path(options_.target_path);
+        fd_ = ::open(partial.c_str(), O_RDWR | O_CLOEXEC);
+        struct stat st;
+        if (fd_ < 0 || fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) != header_.total_size) {
+            if (fd_ >= 0) {
+                close(fd_);
+                fd_ = -1;
+            }
+            return false;
+        }
+
+        header_ = stored;
+        bitmap_ = std::move(bitmap);
+        hasher_.restore_state(stored.hash_state);
+
+        // Chunks may have completed out of order past the hashed prefix
+        std::string error;
+        if (!advance_hash(&error)) {
+            LOGE("Cannot rehash resumed download: %s", error.c_str());
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+
+    bool advance_hash(std::string* error) {
+        while (header_.hashed_chunks < header_.chunk_count && is_complete(header_.hashed_chunks)) {
+            uint32_t chunk = header_.hashed_chunks;
+            size_t len = static_cast<size_t>(chunk_length(chunk));
+            hash_buffer_.resize(static_cast<size_t>(header_.chunk_size));
+            if (!pread_all(fd_, hash_buffer_.data(), len, chunk_offset(chunk))) {
+                *error = std::string("Cannot read back chunk for hashing: ") + strerror(errno);
+                return false;
+            }
+            hasher_.update(hash_buffer_.data(), len);
+            header_.hashed_chunks++;
+        }
+        header_.hash_state = hasher_.save_state();
+        return true;
+    }
+
+    // Write to a temporary file and rename, so the sidecar is never torn
+    bool persist_sidecar() {
+        std::string sidecar = ModelDownloader::sidecar_path(options_.target_path);
+        std::string temp = sidecar + ".tmp";
+        int sfd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (sfd < 0) {
+            return false;
+        }
+        bool ok = pwrite_all(sfd, reinterpret_cast<const uint8_t*>(&header_), sizeof(header_), 0) &&
+                  (bitmap_.empty() || pwrite_all(sfd, bitmap_.data(), bitmap_.size(), sizeof(header_))) &&
+                  fdatasync(sfd) == 0;
+        close(sfd);
+        return ok && rename(temp.c_str(), sidecar.c_str()) == 0;
+    }
+
+    const DownloadOptions& options_;
+    const uint64_t source_id_;
+    SidecarHeader header_{};
+    std::vector<uint8_t> bitmap_;
+    std::vector<uint8_t> hash_buffer_;
+    Sha256 hasher_;
+    int fd_ = -1;
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// HttpRangeFetcher
+// ---------------------------------------------------------------------------
+
+bool HttpRangeFetcher::content_length(const std::string& url, uint64_t* length, std::string* error) {
+    HttpResponse response;
+    int fd = open_range(url, 0, 0, &response, error);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+
+    if (response.status == 206) {
+        uint64_t first = 0;
+        auto range = response.headers.find("content-range");
+        if (range != response.headers.end() && parse_content_range(range->second, &first, length) && *length > 0) {
+            return true;
+        }
+        *error = "Server did not report the total size";
+        return false;
+    }
+    if (response.status == 200) {
+        auto content_length = response.headers.find("content-length");
+        if (content_length != response.headers.end() && parse_u64(content_length->second, length)) {
+            return true;
+        }
+        *error = "Server did not report the content length";
+        return false;
+    }
+
+    *error = "HTTP " + std::to_string(response.status);
+    return false;
+}
+
+bool HttpRangeFetcher::fetch_range(const std::string& url, uint64_t offset, uint64_t length,
+                                   const Sink& sink, std::string* error) {
+    if (length == 0) {
+        return true;
+    }
+
+    HttpResponse response;
+    int fd = open_range(url, offset, offset + length - 1, &response, error);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = true;
+    if (response.status == 206) {
+        uint64_t first = 0, total = 0;
+        auto range = response.headers.find("content-range");
+        if (range == response.headers.end() || !parse_content_range(range->second, &first, &total) || first != offset) {
+            *error = "Server returned the wrong range";
+            ok = false;
+        }
+    } else if (response.status != 200 || offset != 0) {
+        // A 200 is only usable for a range that starts at zero: read the prefix and hang up
+        *error = response.status == 200 ? "Server does not support range requests"
+                                        : "HTTP " + std::to_string(response.status);
+        ok = false;
+    }
+    auto encoding = response.headers.find("transfer-encoding");
+    if (ok && encoding != response.headers.end() && lower(encoding->second) != "identity") {
+        *error = "Unsupported transfer encoding: " + encoding->second;
+        ok = false;
+    }
+
+    uint64_t delivered = 0;
+    if (ok && !response.body_prefix.empty()) {
+        size_t take = static_cast<size_t>(std::min<uint64_t>(response.body_prefix.size(), length));
+        ok = sink(reinterpret_cast<const uint8_t*>(response.body_prefix.data()), take);
+        delivered += take;
+        if (!ok) *error = "Transfer aborted";
+    }
+
+    std::vector<uint8_t> buffer(kRecvBufferSize);
+    while (ok && delivered < length) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), length - delivered));
+        ssize_t n = recv(fd, buffer.data(), want, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            *error = n == 0 ? "Connection closed after " + std::to_string(delivered) + " of " +
+                              std::to_string(length) + " bytes"
+                            : std::string("Receive failed: ") + strerror(errno);
+            ok = false;
+            break;
+        }
+        if (!sink(buffer.data(), static_cast<size_t>(n))) {
+            *error = "Transfer aborted";
+            ok = false;
+            break;
+        }
+        delivered += static_cast<uint64_t>(n);
+    }
+
+    close(fd);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// ModelDownloader
+// ---------------------------------------------------------------------------
+
+ModelDownloader::ModelDownloader(std::shared_ptr<RangeFetcher> fetcher)
+    : fetcher_(std::move(fetcher)) {}
+
+void ModelDownloader::discard_partial(const std::string& target_path) {
+    unlink(partial_path(target_path).c_str());
+    unlink(sidecar_path(target_path).c_str());
+    unlink((sidecar_path(target_path) + ".tmp").c_str());
+}
+
+DownloadResult ModelDownloader::download(const DownloadOptions& options, const ProgressCallback& progress) {
+    DownloadResult result;
+    if (!fetcher_ || options.url.empty() || options.target_path.empty() || options.chunk_size == 0) {
+        result.error = "Invalid download request";
+        return result;
+    }
+
+    if (!fetcher_->content_length(options.url, &result.total_bytes, &result.error)) {
+        LOGE("Cannot size %s: %s", options.url.c_str(), result.error.c_str());
+        return result;
+    }
+    if (result.total_bytes == 0) {
+        result.error = "Remote file is empty";
+        return result;
+    }
+
+    DownloadSession session(options, result.total_bytes);
+    if (!session.open(&result.resumed, &result.error)) {
+        LOGE("Cannot start download of %s: %s", options.url.c_str(), result.error.c_str());
+        return result;
+    }
+
+    std::vector<uint32_t> missing = session.missing_chunks();
+    uint64_t done_bytes = session.completed_bytes();
+    LOGD("Downloading %s: %llu bytes, %zu chunks left%s", options.url.c_str(),
+         static_cast<unsigned long long>(result.total_bytes), missing.size(),
+         result.resumed ? " (resumed)" : "");
+
+    std::mutex state_mutex;
+    std::atomic<size_t> next_index(0);
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> fetched(0);
+    bool cancelled = false;
+    std::string first_error;
+
+    if (progress && !progress(done_bytes, result.total_bytes)) {
+        result.cancelled = true;
+        return result;
+    }
+
+    auto fail = [&](const std::string& message) {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (first_error.empty() && !cancelled) {
+            first_error = message;
+        }
+        stop = true;
+    };
+
+    auto worker = [&]() {
+        while (!stop) {
+            size_t index = next_index.fetch_add(1);
+            if (index >= missing.size()) {
+                break;
+            }
+            uint32_t chunk = missing[index];
+            uint64_t offset = session.chunk_offset(chunk);
+            uint64_t length = session.chunk_length(chunk);
+
+            bool fetched_ok = false;
+            std::string error;
+            for (int attempt = 0; attempt <= options.max_retries && !stop; attempt++) {
+                if (attempt > 0) {
+                    LOGD("Retrying chunk %u (attempt %d): %s", chunk, attempt + 1, error.c_str());
+                    std::this_thread::sleep_for(std::chrono::milliseconds(500 << (attempt - 1)));
+                }
+
+                uint64_t written = 0;
+                int write_errno = 0;
+                error.clear();
+                bool ok = fetcher_->fetch_range(options.url, offset, length,
+                    [&](const uint8_t* data, size_t len) {
+                        if (stop || written + len > length) {
+                            return false;
+                        }
+                        if (!session.write(data, len, offset + written)) {
+                            write_errno = errno;
+                            return false;
+                        }
+                        written += len;
+                        fetched += len;
+                        return true;
+                    }, &error);
+
+                if (write_errno != 0) {
+                    // Disk errors are not transient; retrying only burns bandwidth
+                    error = std::string("Cannot write model file: ") + strerror(write_errno);
+                    break;
+                }
+                if (ok && written == length) {
+                    fetched_ok = true;
+                    break;
+                }
+                if (ok) {
+                    error = "Short range: " + std::to_string(written) + " of " + std::to_string(length) + " bytes";
+                }
+            }
+
+            if (!fetched_ok) {
+                if (!stop) fail("Chunk " + std::to_string(chunk) + " failed: " + error);
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (!session.complete_chunk(chunk, &error)) {
+                if (first_error.empty()) first_error = error;
+                stop = true;
+                return;
+            }
+            done_bytes += length;
+            if (progress && !stop && !progress(done_bytes, result.total_bytes)) {
+                cancelled = true;
+                stop = true;
+            }
+        }
+    };
+
+    int connections = std::max(1, std::min<int>(options.connections, static_cast<int>(missing.size())));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < connections; i++) {
+        workers.emplace_back(worker);
+    }
+    if (!missing.empty()) {
+        worker();
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    result.fetched_bytes = fetched.load();
+    if (cancelled) {
+        LOGD("Download of %s cancelled at %llu bytes, partial file kept for resume",
+             options.url.c_str(), static_cast<unsigned long long>(done_bytes));
+        result.cancelled = true;
+        return result;
+    }
+    if (!first_error.empty()) {
+        LOGE("Download of %s failed: %s", options.url.c_str(), first_error.c_str());
+        result.error = first_error;
+        return result;
+    }
+    if (!session.all_hashed()) {
+        result.error = "Download incomplete";
+        return result;
+    }
+
+    result.sha256 = session.digest();
+    if (!options.expected_sha256.empty() && lower(options.expected_sha256) != result.sha256) {
+        // The bytes themselves are wrong; resuming would only reproduce them
+        LOGE("Checksum mismatch for %s: expected %s, got %s", options.url.c_str(),
+             options.expected_sha256.c_str(), result.sha256.c_str());
+        result.error = "Checksum mismatch";
+        ModelDownloader::discard_partial(options.target_path);
+        return result;
+    }
+
+    if (!session.finalize(&result.error)) {
+        LOGE("Cannot finalize %s: %s", options.target_path.c_str(), result.error.c_str());
+        return result;
+    }
+
+    result.success = true;
+    LOGD("Downloaded %s to %s (%llu bytes fetched, sha256 %s)", options.url.c_str(), options.target_path.c_str(),
+         static_cast<unsigned long long>(result.fetched_bytes), result.sha256.c_str());
+    return result;
+}
+
+} // namespace scrollguard
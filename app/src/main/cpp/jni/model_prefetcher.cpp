@@ -0,0 +1,289 @@
+#include "../include/model_prefetcher.h"
+#include "../include/gguf_parser.h"
+#include "../include/memory_estimator.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#define LOG_TAG "ScrollGuard-Prefetch"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+// linux/ioprio.h is not exported by the NDK
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+
+// Adjacent tensors closer than this are read as one region
+constexpr uint64_t kMergeGapBytes = 64 * 1024;
+// How long to let one request land before issuing the next
+constexpr auto kRequestSettleTime = std::chrono::milliseconds(200);
+
+struct Region {
+    int layer;
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Evaluation order: embeddings, then blocks by index, then output tensors
+int layer_of(std::string_view name) {
+    if (name.compare(0, 4, "blk.") == 0) {
+        return std::atoi(std::string(name.substr(4, 8)).c_str());
+    }
+    if (name.find("embd") != std::string_view::npos) {
+        return -1;
+    }
+    return INT_MAX;
+}
+
+void lower_thread_priority() {
+    setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), 19);
+#ifdef SYS_ioprio_set
+    syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+#endif
+}
+
+uint64_t page_size() {
+    static const uint64_t size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/**
+ * Resident bytes of [offset, offset + length) in a mapping of the whole file
+ */
+uint64_t count_resident(uint8_t* base, uint64_t file_size, uint64_t offset, uint64_t length) {
+    uint64_t page = page_size();
+    uint64_t start = offset & ~(page - 1);
+    uint64_t end = std::min(file_size, offset + length);
+    if (end <= start) {
+        return 0;
+    }
+
+    size_t pages = static_cast<size_t>((end - start + page - 1) / page);
+    std::vector<unsigned char> residency(pages);
+    if (mincore(base + start, static_cast<size_t>(end - start), residency.data()) != 0) {
+        return 0;
+    }
+
+    uint64_t resident = 0;
+    for (size_t i = 0; i < pages; i++) {
+        if (residency[i] & 1) {
+            uint64_t page_start = std::max(offset, start + i * page);
+            uint64_t page_end = std::min(end, start + (i + 1) * page);
+            resident += page_end - page_start;
+        }
+    }
+    return resident;
+}
+
+} // namespace
+
+ModelPrefetcher& ModelPrefetcher::instance() {
+    static ModelPrefetcher prefetcher;
+    return prefetcher;
+}
+
+ModelPrefetcher::~ModelPrefetcher() {
+    stop();
+}
+
+bool ModelPrefetcher::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    PrefetchState state = static_cast<PrefetchState>(state_.load());
+    if (path == path_ && (state == PrefetchState::RUNNING || state == PrefetchState::DONE)) {
+        return true;
+    }
+
+    cancel_ = true;
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+    path_ = path;
+    cancel_ = false;
+    total_bytes_ = 0;
+    requested_bytes_ = 0;
+    resident_bytes_ = 0;
+    state_ = static_cast<int>(PrefetchState::RUNNING);
+    worker_ = std::thread(&ModelPrefetcher::run, this, path);
+    return true;
+}
+
+void ModelPrefetcher::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancel_ = true;
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+PrefetchProgress ModelPrefetcher::progress() const {
+    PrefetchProgress progress;
+    progress.state = static_cast<PrefetchState>(state_.load());
+    progress.total_bytes = total_bytes_.load();
+    progress.requested_bytes = requested_bytes_.load();
+    progress.resident_bytes = resident_bytes_.load();
+    return progress;
+}
+
+uint64_t ModelPrefetcher::resident_bytes(const std::string& path, uint64_t offset, uint64_t length) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    uint64_t resident = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        uint64_t file_size = static_cast<uint64_t>(st.st_size);
+        void* base = mmap(nullptr, static_cast<size_t>(file_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (base != MAP_FAILED) {
+            resident = count_resident(static_cast<uint8_t*>(base), file_size, offset, length);
+            munmap(base, static_cast<size_t>(file_size));
+        }
+    }
+    close(fd);
+    return resident;
+}
+
+void ModelPrefetcher::run(std::string path) {
+    lower_thread_priority();
+    auto start_time = std::chrono::steady_clock::now();
+
+    std::vector<Region> regions;
+    {
+        GgufFile gguf;
+        if (!gguf.open(path)) {
+            LOGE("Not prefetching %s: %s", path.c_str(), gguf.error().c_str());
+            state_ = static_cast<int>(PrefetchState::FAILED);
+            return;
+        }
+        for (const auto& tensor : gguf.tensors()) {
+            regions.push_back({layer_of(tensor.name), gguf.info().data_offset + tensor.offset, tensor.size_bytes});
+        }
+    }
+
+    std::sort(regions.begin(), regions.end(), [](const Region& a, const Region& b) {
+        return a.layer != b.layer ? a.layer < b.layer : a.offset < b.offset;
+    });
+
+    // Coalesce tensors that are adjacent in both evaluation order and file layout
+    std::vector<Region> merged;
+    for (const auto& region : regions) {
+        if (!merged.empty()) {
+            Region& last = merged.back();
+            uint64_t last_end = last.offset + last.length;
+            if (region.offset >= last_end && region.offset - last_end <= kMergeGapBytes) {
+                last.length = region.offset + region.length - last.offset;
+                continue;
+            }
+        }
+        merged.push_back(region);
+    }
+
+    uint64_t total = 0;
+    for (const auto& region : merged) {
+        total += region.length;
+    }
+
+    // Pages read beyond what memory can hold would be evicted before first use
+    SystemMemory memory = memory_estimator::read_system_memory();
+    uint64_t budget = memory.headroom > memory_estimator::kSafetyMarginBytes
+        ? memory.headroom - memory_estimator::kSafetyMarginBytes : 0;
+    total_bytes_ = std::min(total, budget);
+    if (budget < total) {
+        LOGD("Prefetching only the first %llu of %llu MB of %s (memory headroom)",
+             static_cast<unsigned long long>(budget / (1024 * 1024)),
+             static_cast<unsigned long long>(total / (1024 * 1024)), path.c_str());
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        LOGE("Cannot open %s for prefetch: %s", path.c_str(), strerror(errno));
+        if (fd >= 0) close(fd);
+        state_ = static_cast<int>(PrefetchState::FAILED);
+        return;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+    void* mapping = mmap(nullptr, static_cast<size_t>(file_size), PROT_READ, MAP_SHARED, fd, 0);
+    uint8_t* base = mapping == MAP_FAILED ? nullptr : static_cast<uint8_t*>(mapping);
+
+    // One request in flight: issue the next, then account for the previous once it has landed
+    Region pending = {0, 0, 0};
+    uint64_t resident = 0;
+    auto settle = [&](const Region& request) {
+        if (!base || request.length == 0) {
+            return;
+        }
+        auto deadline = std::chrono::steady_clock::now() + kRequestSettleTime;
+        uint64_t landed = count_resident(base, file_size, request.offset, request.length);
+        while (landed < request.length && std::chrono::steady_clock::now() < deadline && !cancel_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            landed = count_resident(base, file_size, request.offset, request.length);
+        }
+        resident += landed;
+        resident_bytes_ = resident;
+    };
+
+    uint64_t requested = 0;
+    bool cancelled = false;
+    for (const auto& region : merged) {
+        for (uint64_t done = 0; done < region.length && requested < total_bytes_; ) {
+            if (cancel_) {
+                cancelled = true;
+                break;
+            }
+
+            uint64_t length = std::min({kRequestBytes, region.length - done, total_bytes_ - requested});
+            Region request = {region.layer, region.offset + done, length};
+            if (readahead(fd, static_cast<off64_t>(request.offset), static_cast<size_t>(length)) != 0) {
+                posix_fadvise(fd, static_cast<off_t>(request.offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+            }
+
+            settle(pending);
+            pending = request;
+            done += length;
+            requested += length;
+            requested_bytes_ = requested;
+        }
+        if (cancelled || requested >= total_bytes_) {
+            break;
+        }
+    }
+    if (!cancelled) {
+        settle(pending);
+    }
+
+    if (base) {
+        munmap(base, static_cast<size_t>(file_size));
+    }
+    close(fd);
+
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    state_ = static_cast<int>(cancelled ? PrefetchState::CANCELLED : PrefetchState::DONE);
+    LOGD("Prefetch of %s %s: %llu MB requested, %llu MB resident, %lld ms", path.c_str(),
+         cancelled ? "cancelled" : "finished",
+         static_cast<unsigned long long>(requested / (1024 * 1024)),
+         static_cast<unsigned long long>(resident_bytes_.load() / (1024 * 1024)),
+         static_cast<long long>(elapsed_ms));
+}
+
+} // namespace scrollguard
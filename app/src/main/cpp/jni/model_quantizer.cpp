@@ -0,0 +1,355 @@
+#include "../include/model_quantizer.h"
+#include "../include/gguf_parser.h"
+#include "../include/memory_estimator.h"
+#include "../include/model_benchmark.h"
+#include "../include/sha256.h"
+#include <android/log.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#define LOG_TAG "ScrollGuard-Quantizer"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+constexpr const char* kSelectionHeader = "scrollguard-format 1";
+
+// llama_ftype values (llama.h) and the ggml_type their weights end up in
+constexpr int kFtypeQ4_0 = 2;
+constexpr int kFtypeQ8_0 = 7;
+constexpr uint32_t kGgmlTypeQ4_0 = 2;
+constexpr uint32_t kGgmlTypeQ8_0 = 8;
+
+std::mutex job_mutex;
+
+const char* ftype_name(int ftype) {
+    switch (ftype) {
+        case 0: return "F32";
+        case 1: return "F16";
+        case kFtypeQ4_0: return "Q4_0";
+        case kFtypeQ8_0: return "Q8_0";
+        case 14: return "Q4_K_S";
+        case 15: return "Q4_K_M";
+        case 16: return "Q5_K_S";
+        case 17: return "Q5_K_M";
+        case 18: return "Q6_K";
+        default: return "unknown";
+    }
+}
+
+uint32_t weight_type_of(int ftype) {
+    return ftype == kFtypeQ8_0 ? kGgmlTypeQ8_0 : kGgmlTypeQ4_0;
+}
+
+/**
+ * Expected size of model requantized to ftype: matrices change type,
+ * norms and other 1-D tensors stay as they are
+ */
+uint64_t estimate_variant_size(const GgufFile& gguf, int ftype) {
+    uint64_t size = gguf.info().data_offset;
+    for (const auto& tensor : gguf.tensors()) {
+        uint64_t elements = tensor.dims[0] * tensor.dims[1] * tensor.dims[2] * tensor.dims[3];
+        uint64_t bytes = tensor.n_dims >= 2 ? gguf::tensor_bytes(weight_type_of(ftype), elements) : 0;
+        size += bytes ? bytes : tensor.size_bytes;
+    }
+    return size;
+}
+
+uint64_t free_disk_bytes(const std::string& path) {
+    std::string dir = path.substr(0, path.find_last_of('/') + 1);
+    struct statvfs vfs;
+    if (statvfs(dir.empty() ? "." : dir.c_str(), &vfs) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(vfs.f_bavail) * vfs.f_frsize;
+}
+
+uint64_t launch_cost(const LayoutTiming& timing) {
+    return timing.load_ms + static_cast<uint64_t>(device_profile::kCallsPerLaunch) * timing.eval_ms;
+}
+
+struct Selection {
+    std::string source_sha256;
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    std::string cpu_fingerprint;
+    std::string type;
+};
+
+bool read_selection(const std::string& model_path, Selection* selection) {
+    std::ifstream file(model_quantizer::selection_path(model_path));
+    std::string line;
+    if (!file.good() || !std::getline(file, line) || line != kSelectionHeader) {
+        return false;
+    }
+    std::map<std::string, std::string> values;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            values[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+    }
+    selection->source_sha256 = values["source_sha256"];
+    selection->source_size = std::strtoull(values["source_size"].c_str(), nullptr, 10);
+    selection->source_mtime = std::strtoll(values["source_mtime"].c_str(), nullptr, 10);
+    selection->cpu_fingerprint = values["cpu"];
+    selection->type = values["type"];
+    return true;
+}
+
+bool write_selection(const std::string& model_path, const Selection& selection,
+                     const std::vector<QuantVariant>& variants) {
+    std::string path = model_quantizer::selection_path(model_path);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        if (!file.good()) {
+            LOGE("Cannot write %s", temp.c_str());
+            return false;
+        }
+        file << kSelectionHeader << "\n"
+             << "source_sha256=" << selection.source_sha256 << "\n"
+             << "source_size=" << selection.source_size << "\n"
+             << "source_mtime=" << selection.source_mtime << "\n"
+             << "cpu=" << selection.cpu_fingerprint << "\n"
+             << "type=" << selection.type << "\n";
+        for (const auto& variant : variants) {
+            if (variant.measured) {
+                file << "timing." << variant.type << "=" << variant.timing.load_ms << ","
+                     << variant.timing.eval_ms << "\n";
+            }
+        }
+        if (!file.good()) {
+            return false;
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Benchmark path under config if its estimated footprint fits in memory now
+ */
+bool measure_variant(const ModelConfig& config, QuantVariant* variant) {
+    GgufFile gguf;
+    if (!gguf.open(variant->path)) {
+        LOGE("Variant %s is not loadable: %s", variant->type.c_str(), gguf.error().c_str());
+        return false;
+    }
+
+    ModelConfig trial = config;
+    trial.model_path = variant->path;
+    ModelConfig sized;
+    MemoryEstimate estimate;
+    if (!memory_estimator::select_config(gguf.info(), trial, memory_estimator::read_system_memory(),
+                                         &sized, &estimate)) {
+        LOGD("Skipping %s, not enough memory: %s", variant->type.c_str(),
+             memory_estimator::describe(estimate).c_str());
+        return false;
+    }
+    gguf.close();
+
+    // Repacking is what makes Q4_0/Q8_0 fast, so measure every format with it on
+    sized.use_extra_bufts = true;
+    variant->measured = model_benchmark::measure(sized, &variant->timing);
+    return variant->measured;
+}
+
+} // namespace
+
+namespace model_quantizer {
+
+std::string selection_path(const std::string& model_path) {
+    return model_path + ".format";
+}
+
+std::string variant_path(const std::string& model_path, const std::string& type) {
+    return model_path + "." + type + ".requant";
+}
+
+std::vector<int> candidate_ftypes(const CpuFeatures& cpu) {
+    std::vector<int> ftypes;
+    if (cpu.arch == "arm64") {
+        // Q4_0 repacks to 4x8 (i8mm) or 4x4 (dotprod) tiles; Q8_0 needs i8mm to pay for its size
+        if (cpu.i8mm || cpu.dotprod) {
+            ftypes.push_back(kFtypeQ4_0);
+        }
+        if (cpu.i8mm) {
+            ftypes.push_back(kFtypeQ8_0);
+        }
+    } else if (cpu.avx2) {
+        ftypes.push_back(kFtypeQ4_0);
+    }
+    return ftypes;
+}
+
+QuantizeResult optimize(const ModelConfig& config) {
+    QuantizeResult result;
+    std::unique_lock<std::mutex> lock(job_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        result.error = "Requantization already running";
+        return result;
+    }
+
+    const std::string& model_path = config.model_path;
+    struct stat st;
+    if (stat(model_path.c_str(), &st) != 0) {
+        result.error = "Model not found: " + model_path;
+        return result;
+    }
+
+    GgufFile gguf;
+    if (!gguf.open(model_path)) {
+        result.error = "Invalid model: " + gguf.error();
+        return result;
+    }
+    int source_ftype = static_cast<int>(gguf.info().file_type);
+
+    QuantVariant original;
+    original.type = ftype_name(source_ftype);
+    original.path = model_path;
+    original.size_bytes = static_cast<uint64_t>(st.st_size);
+    result.variants.push_back(original);
+
+    const CpuFeatures& cpu = cpu_features::detect();
+#ifdef LLAMA_CPP_AVAILABLE
+    llama_backend_init();
+    for (int ftype : candidate_ftypes(cpu)) {
+        if (ftype == source_ftype) {
+            continue;
+        }
+        QuantVariant variant;
+        variant.type = ftype_name(ftype);
+        variant.path = variant_path(model_path, variant.type);
+
+        uint64_t expected = estimate_variant_size(gguf, ftype);
+        if (free_disk_bytes(variant.path) < expected + kDiskMarginBytes) {
+            LOGD("Skipping %s, needs %llu MB of free storage", variant.type.c_str(),
+                 static_cast<unsigned long long>(expected / (1024 * 1024)));
+            continue;
+        }
+
+        // Quantize to a temporary name so a killed job never leaves a half-written variant
+        std::string temp = variant.path + ".tmp";
+        llama_model_quantize_params params = llama_model_quantize_default_params();
+        params.nthread = config.n_threads;
+        params.ftype = static_cast<llama_ftype>(ftype);
+        params.allow_requantize = true;
+        LOGD("Requantizing %s from %s to %s", model_path.c_str(), original.type.c_str(), variant.type.c_str());
+        if (llama_model_quantize(model_path.c_str(), temp.c_str(), &params) != 0 ||
+            rename(temp.c_str(), variant.path.c_str()) != 0) {
+            LOGE("Requantization to %s failed", variant.type.c_str());
+            unlink(temp.c_str());
+            continue;
+        }
+
+        struct stat vst;
+        variant.size_bytes = stat(variant.path.c_str(), &vst) == 0 ? static_cast<uint64_t>(vst.st_size) : 0;
+        result.variants.push_back(variant);
+    }
+#endif
+    gguf.close();
+
+    for (auto& variant : result.variants) {
+        measure_variant(config, &variant);
+    }
+
+    if (!result.variants[0].measured) {
+        result.error = "Could not benchmark the original model";
+        for (size_t i = 1; i < result.variants.size(); i++) {
+            unlink(result.variants[i].path.c_str());
+        }
+        return result;
+    }
+
+    // Keep a variant only if it clearly beats the original
+    const QuantVariant* best = &result.variants[0];
+    uint64_t best_cost = static_cast<uint64_t>(launch_cost(best->timing) * kRequiredSpeedup);
+    for (size_t i = 1; i < result.variants.size(); i++) {
+        const QuantVariant& variant = result.variants[i];
+        if (variant.measured && launch_cost(variant.timing) <= best_cost) {
+            best = &variant;
+            best_cost = launch_cost(variant.timing);
+        }
+    }
+    for (const auto& variant : result.variants) {
+        if (&variant != best && variant.path != model_path) {
+            unlink(variant.path.c_str());
+        }
+    }
+
+    Selection selection;
+    if (!sha256::hash_file(model_path, &selection.source_sha256)) {
+        result.error = "Could not hash " + model_path;
+        return result;
+    }
+    selection.source_size = static_cast<uint64_t>(st.st_size);
+    selection.source_mtime = static_cast<int64_t>(st.st_mtime);
+    selection.cpu_fingerprint = cpu.fingerprint();
+    selection.type = best->type;
+    if (!write_selection(model_path, selection, result.variants)) {
+        result.error = "Could not store format selection";
+        return result;
+    }
+
+    result.success = true;
+    result.selected_type = best->type;
+    result.selected_path = best->path;
+    LOGD("Format for %s on %s: %s", model_path.c_str(), selection.cpu_fingerprint.c_str(), best->type.c_str());
+    return result;
+}
+
+std::string resolve(const std::string& model_path) {
+    Selection selection;
+    if (!read_selection(model_path, &selection)) {
+        return model_path;
+    }
+
+    std::string path = variant_path(model_path, selection.type);
+    struct stat st;
+    struct stat vst;
+    if (stat(path.c_str(), &vst) != 0 || stat(model_path.c_str(), &st) != 0 ||
+        selection.cpu_fingerprint != cpu_features::detect().fingerprint() ||
+        selection.source_size != static_cast<uint64_t>(st.st_size)) {
+        return model_path;
+    }
+
+    if (selection.source_mtime != static_cast<int64_t>(st.st_mtime)) {
+        // Same size, new mtime: the variant is only valid for identical content
+        std::string digest;
+        if (!sha256::hash_file(model_path, &digest) || digest != selection.source_sha256) {
+            LOGD("Model changed since requantization, discarding %s", path.c_str());
+            discard(model_path);
+            return model_path;
+        }
+    }
+
+    LOGD("Using %s variant of %s", selection.type.c_str(), model_path.c_str());
+    return path;
+}
+
+void discard(const std::string& model_path) {
+    for (int ftype : {kFtypeQ4_0, kFtypeQ8_0}) {
+        std::string path = variant_path(model_path, ftype_name(ftype));
+        unlink(path.c_str());
+        unlink((path + ".tmp").c_str());
+        unlink(device_profile::profile_path(path).c_str());
+    }
+    unlink(selection_path(model_path).c_str());
+}
+
+} // namespace model_quantizer
+
+} // namespace scrollguard
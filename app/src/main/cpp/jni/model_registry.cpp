@@ -0,0 +1,491 @@
+#include "../include/model_registry.h"
+#include "../include/device_profile.h"
+#include "../include/gguf_parser.h"
+#include "../include/memory_estimator.h"
+#include "../include/sha256.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "ScrollGuard-Registry"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+constexpr const char* kManifestHeader = "scrollguard-models 1";
+constexpr const char* kSelectionHeader = "scrollguard-selection 1";
+
+// Used until the app supplies a manifest
+constexpr const char* kBuiltinManifest =
+    "scrollguard-models 1\n"
+    "[gemma-270m]\n"
+    "description=Gemma 3 270M - Optimized for mobile inference\n"
+    "parameters=270000000\n"
+    "variant=Q4_K_M 157286400 - gemma-3-270m-it-Q4_K_M.gguf "
+    "https://huggingface.co/unsloth/gemma-3-270m-it-GGUF/resolve/main/gemma-3-270m-it-Q4_K_M.gguf\n"
+    "[gemma-2b]\n"
+    "description=Gemma 3 2B - Higher quality but larger model\n"
+    "parameters=2000000000\n"
+    "role=escalation\n"
+    "variant=Q4_K_M 1258291200 - gemma-3-2b-it-Q4_K_M.gguf "
+    "https://huggingface.co/unsloth/gemma-3-2b-it-GGUF/resolve/main/gemma-3-2b-it-Q4_K_M.gguf\n";
+
+std::string trim(const std::string& value) {
+    size_t start = value.find_first_not_of(" \t\r");
+    size_t end = value.find_last_not_of(" \t\r");
+    return start == std::string::npos ? "" : value.substr(start, end - start + 1);
+}
+
+bool parse_manifest(const std::string& text, std::vector<RegistryModel>* models, std::string* error) {
+    std::istringstream input(text);
+    std::string line;
+    int line_number = 0;
+    bool header_seen = false;
+
+    auto fail = [&](const std::string& message) {
+        *error = "manifest line " + std::to_string(line_number) + ": " + message;
+        return false;
+    };
+
+    while (std::getline(input, line)) {
+        line_number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (!header_seen) {
+            if (line != kManifestHeader) {
+                return fail("expected \"" + std::string(kManifestHeader) + "\"");
+            }
+            header_seen = true;
+            continue;
+        }
+
+        if (line.front() == '[' && line.back() == ']') {
+            RegistryModel model;
+            model.name = trim(line.substr(1, line.size() - 2));
+            if (model.name.empty()) {
+                return fail("empty model name");
+            }
+            for (const auto& existing : *models) {
+                if (existing.name == model.name) {
+                    return fail("duplicate model " + model.name);
+                }
+            }
+            models->push_back(model);
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            return fail("expected key=value");
+        }
+        if (models->empty()) {
+            return fail("entry outside a [model] section");
+        }
+        RegistryModel& model = models->back();
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+
+        if (key == "description") {
+            model.description = value;
+        } else if (key == "parameters") {
+            model.parameters = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "role") {
+            if (value != "screening" && value != "escalation") {
+                return fail("role must be screening or escalation");
+            }
+            model.escalation = value == "escalation";
+        } else if (key == "variant") {
+            std::istringstream fields(value);
+            ModelVariant variant;
+            std::string size;
+            if (!(fields >> variant.type >> size >> variant.sha256 >> variant.filename >> variant.url)) {
+                return fail("variant needs: type size sha256 filename url");
+            }
+            if (variant.filename.find('/') != std::string::npos) {
+                return fail("variant filename must not contain a path");
+            }
+            if (variant.sha256 == "-") {
+                variant.sha256.clear();
+            } else if (variant.sha256.size() != 64) {
+                return fail("sha256 must be 64 hex characters or -");
+            }
+            variant.size_bytes = std::strtoull(size.c_str(), nullptr, 10);
+            model.variants.push_back(variant);
+        }
+        // Unknown keys are ignored so newer manifests stay loadable
+    }
+
+    if (!header_seen) {
+        *error = "manifest is empty";
+        return false;
+    }
+    for (const auto& model : *models) {
+        if (model.variants.empty()) {
+            *error = "model " + model.name + " has no variants";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string digest_of(const std::string& text) {
+    Sha256 hasher;
+    hasher.update(text.data(), text.size());
+    return hasher.finish_hex();
+}
+
+// MemTotal in MB; part of the hardware key next to the CPU fingerprint
+uint64_t total_memory_mb() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    uint64_t kb = 0;
+    while (meminfo >> key >> kb) {
+        if (key == "MemTotal:") {
+            return kb / 1024;
+        }
+        meminfo.ignore(256, '\n');
+    }
+    return 0;
+}
+
+std::string hardware_key() {
+    return cpu_features::detect().fingerprint() + "/" + std::to_string(total_memory_mb()) + "MB";
+}
+
+// The preferred downloaded variant of a screening model
+struct Candidate {
+    const RegistryModel* model;
+    const ModelVariant* variant;
+    std::string path;
+    uint64_t size_bytes;
+};
+
+std::vector<Candidate> downloaded_candidates(const std::vector<RegistryModel>& models,
+                                             const std::string& models_dir) {
+    std::vector<Candidate> candidates;
+    for (const auto& model : models) {
+        if (model.escalation) {
+            continue;
+        }
+        for (const auto& variant : model.variants) {
+            std::string path = models_dir + "/" + variant.filename;
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && st.st_size > 0) {
+                candidates.push_back({&model, &variant, path, static_cast<uint64_t>(st.st_size)});
+                break;
+            }
+        }
+    }
+    return candidates;
+}
+
+// Downloaded files and their sizes, part of the persisted selection key: a new
+// download or a replaced file reopens the choice
+std::string downloads_key(const std::vector<Candidate>& candidates) {
+    std::vector<std::string> files;
+    for (const auto& candidate : candidates) {
+        files.push_back(candidate.variant->filename + ":" + std::to_string(candidate.size_bytes));
+    }
+    std::sort(files.begin(), files.end());
+    std::string key;
+    for (const auto& file : files) {
+        key += (key.empty() ? "" : ",") + file;
+    }
+    return key;
+}
+
+} // namespace
+
+ModelRegistry& ModelRegistry::instance() {
+    static ModelRegistry registry;
+    return registry;
+}
+
+ModelRegistry::ModelRegistry() {
+    std::string error;
+    if (!parse_manifest(kBuiltinManifest, &models_, &error)) {
+        LOGE("Built-in manifest is invalid: %s", error.c_str());
+    }
+    digest_ = digest_of(kBuiltinManifest);
+}
+
+bool ModelRegistry::load_manifest(const std::string& text, std::string* error) {
+    std::vector<RegistryModel> models;
+    if (!parse_manifest(text, &models, error)) {
+        LOGE("Rejecting model manifest: %s", error->c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    models_ = std::move(models);
+    digest_ = digest_of(text);
+    has_selection_ = false;
+    LOGD("Model manifest loaded: %zu models", models_.size());
+    return true;
+}
+
+bool ModelRegistry::load_manifest_file(const std::string& path, std::string* error) {
+    std::ifstream file(path);
+    if (!file.good()) {
+        *error = "Cannot read " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return load_manifest(text.str(), error);
+}
+
+std::vector<RegistryModel> ModelRegistry::models() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return models_;
+}
+
+bool ModelRegistry::find(const std::string& name, RegistryModel* model) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& candidate : models_) {
+        if (candidate.name == name) {
+            *model = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ModelRegistry::manifest_digest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return digest_;
+}
+
+bool ModelRegistry::current_selection(ModelSelection* selection) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_selection_) {
+        return false;
+    }
+    *selection = selection_;
+    return true;
+}
+
+bool ModelRegistry::escalation_model(const std::string& models_dir, std::string* path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& model : models_) {
+        if (!model.escalation) {
+            continue;
+        }
+        for (const auto& variant : model.variants) {
+            std::string candidate = models_dir + "/" + variant.filename;
+            struct stat st;
+            if (stat(candidate.c_str(), &st) == 0 && st.st_size > 0) {
+                *path = candidate;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::string ModelRegistry::selection_path(const std::string& models_dir) {
+    return models_dir + "/model_selection";
+}
+
+bool ModelRegistry::select(const std::string& models_dir, const ModelConfig& base, const SelectionBudget& budget,
+                           bool benchmark, ModelSelection* selection, std::string* error) {
+    // Only benchmarks are serialized; reading the persisted choice never waits on one
+    std::unique_lock<std::mutex> select_lock(select_mutex_, std::defer_lock);
+    if (benchmark) {
+        select_lock.lock();
+    }
+
+    // Candidates: the preferred downloaded variant of each model, largest model first
+    std::vector<RegistryModel> models = this->models();
+    std::vector<Candidate> candidates = downloaded_candidates(models, models_dir);
+    std::string downloads = downloads_key(candidates);
+
+    if (load_persisted(models_dir, budget, downloads, selection)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        selection_ = *selection;
+        has_selection_ = true;
+        return true;
+    }
+    if (!benchmark) {
+        *error = "No valid model selection; a benchmark is needed";
+        return false;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.model->parameters != b.model->parameters) {
+            return a.model->parameters > b.model->parameters;
+        }
+        return a.variant->size_bytes > b.variant->size_bytes;
+    });
+    if (candidates.empty()) {
+        *error = "No model from the manifest is downloaded";
+        return false;
+    }
+
+    SystemMemory memory = memory_estimator::read_system_memory();
+    if (budget.memory_bytes > 0) {
+        uint64_t budgeted = budget.memory_bytes + memory_estimator::kSafetyMarginBytes;
+        memory.headroom = memory.headroom == 0 ? budgeted : std::min(memory.headroom, budgeted);
+    }
+
+    ModelSelection best;
+    bool have_fallback = false;
+    for (const auto& candidate : candidates) {
+        GgufFile gguf;
+        if (!gguf.open(candidate.path)) {
+            LOGE("Skipping %s: %s", candidate.path.c_str(), gguf.error().c_str());
+            continue;
+        }
+
+        ModelConfig requested = base;
+        requested.model_path = candidate.path;
+        ModelConfig sized;
+        MemoryEstimate estimate;
+        if (!memory_estimator::select_config(gguf.info(), requested, memory, &sized, &estimate)) {
+            LOGD("Skipping %s, over memory budget: %s", candidate.model->name.c_str(),
+                 memory_estimator::describe(estimate).c_str());
+            continue;
+        }
+        gguf.close();
+
+        ModelSelection measured;
+        measured.model = candidate.model->name;
+        measured.variant = candidate.variant->type;
+        measured.path = candidate.path;
+        measured.memory_bytes = estimate.total_bytes;
+        if (!model_benchmark::measure_latency(sized, kCalibrationRuns, &measured.latency)) {
+            LOGE("Calibration of %s failed", candidate.model->name.c_str());
+            continue;
+        }
+
+        if (measured.latency.p95_ms <= budget.p95_latency_ms) {
+            measured.meets_budget = true;
+            best = measured;
+            have_fallback = true;
+            break;
+        }
+        // Nothing met the budget so far: remember the fastest model that fits
+        if (!have_fallback || measured.latency.p95_ms < best.latency.p95_ms) {
+            best = measured;
+            have_fallback = true;
+        }
+    }
+
+    if (!have_fallback) {
+        *error = "No downloaded model fits in memory or could be benchmarked";
+        return false;
+    }
+
+    LOGD("Selected %s (%s): p95 %ums against a %ums budget%s", best.model.c_str(), best.variant.c_str(),
+         best.latency.p95_ms, budget.p95_latency_ms, best.meets_budget ? "" : " (budget not met)");
+    persist(models_dir, budget, downloads, best);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        selection_ = best;
+        has_selection_ = true;
+    }
+    *selection = best;
+    return true;
+}
+
+bool ModelRegistry::load_persisted(const std::string& models_dir, const SelectionBudget& budget,
+                                   const std::string& downloads, ModelSelection* selection) {
+    std::ifstream file(selection_path(models_dir));
+    std::string line;
+    if (!file.good() || !std::getline(file, line) || line != kSelectionHeader) {
+        return false;
+    }
+    std::map<std::string, std::string> values;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            values[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+    }
+
+    if (values["manifest"] != manifest_digest()) {
+        LOGD("Model manifest changed, reselecting");
+        return false;
+    }
+    if (values["hardware"] != hardware_key()) {
+        LOGD("Hardware changed (%s), reselecting", values["hardware"].c_str());
+        return false;
+    }
+    if (values["downloads"] != downloads) {
+        LOGD("Downloaded models changed, reselecting");
+        return false;
+    }
+    if (values["p95_budget_ms"] != std::to_string(budget.p95_latency_ms) ||
+        values["memory_budget"] != std::to_string(budget.memory_bytes)) {
+        return false;
+    }
+
+    RegistryModel model;
+    if (!find(values["model"], &model)) {
+        return false;
+    }
+    for (const auto& variant : model.variants) {
+        if (variant.type != values["variant"]) {
+            continue;
+        }
+        std::string path = models_dir + "/" + variant.filename;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            return false;
+        }
+        selection->model = model.name;
+        selection->variant = variant.type;
+        selection->path = path;
+        selection->meets_budget = values["meets_budget"] == "1";
+        selection->from_cache = true;
+        selection->latency.runs = std::atoi(values["runs"].c_str());
+        selection->latency.p50_ms = static_cast<uint32_t>(std::strtoul(values["p50_ms"].c_str(), nullptr, 10));
+        selection->latency.p95_ms = static_cast<uint32_t>(std::strtoul(values["p95_ms"].c_str(), nullptr, 10));
+        selection->latency.max_ms = static_cast<uint32_t>(std::strtoul(values["max_ms"].c_str(), nullptr, 10));
+        selection->memory_bytes = std::strtoull(values["memory_bytes"].c_str(), nullptr, 10);
+        return true;
+    }
+    return false;
+}
+
+void ModelRegistry::persist(const std::string& models_dir, const SelectionBudget& budget,
+                            const std::string& downloads, const ModelSelection& selection) {
+    std::string path = selection_path(models_dir);
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        file << kSelectionHeader << "\n"
+             << "manifest=" << manifest_digest() << "\n"
+             << "hardware=" << hardware_key() << "\n"
+             << "downloads=" << downloads << "\n"
+             << "p95_budget_ms=" << budget.p95_latency_ms << "\n"
+             << "memory_budget=" << budget.memory_bytes << "\n"
+             << "model=" << selection.model << "\n"
+             << "variant=" << selection.variant << "\n"
+             << "meets_budget=" << (selection.meets_budget ? 1 : 0) << "\n"
+             << "runs=" << selection.latency.runs << "\n"
+             << "p50_ms=" << selection.latency.p50_ms << "\n"
+             << "p95_ms=" << selection.latency.p95_ms << "\n"
+             << "max_ms=" << selection.latency.max_ms << "\n"
+             << "memory_bytes=" << selection.memory_bytes << "\n";
+        if (!file.good()) {
+            LOGE("Cannot write %s", temp.c_str());
+            return;
+        }
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+    }
+}
+
+} // namespace scrollguard
@@ -0,0 +1,360 @@
+#include "../include/model_source.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define LOG_TAG "ScrollGuard-ModelSource"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+
+constexpr uint32_t kEndOfCentralDirSig = 0x06054b50;
+constexpr uint32_t kZip64EndOfCentralDirSig = 0x06064b50;
+constexpr uint32_t kZip64LocatorSig = 0x07064b50;
+constexpr uint32_t kCentralDirEntrySig = 0x02014b50;
+constexpr uint32_t kLocalHeaderSig = 0x04034b50;
+constexpr uint16_t kZip64ExtraId = 0x0001;
+
+constexpr size_t kEndOfCentralDirSize = 22;
+constexpr size_t kZip64LocatorSize = 20;
+constexpr size_t kZip64EndOfCentralDirSize = 56;
+constexpr size_t kCentralDirEntrySize = 46;
+constexpr size_t kLocalHeaderSize = 30;
+constexpr size_t kMaxCommentSize = 0xffff;
+
+const char* const kEmbeddedCopyPrefix = "embedded-";
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le32(const uint8_t* p) { return le16(p) | (static_cast<uint32_t>(le16(p + 2)) << 16); }
+uint64_t le64(const uint8_t* p) { return le32(p) | (static_cast<uint64_t>(le32(p + 4)) << 32); }
+
+bool pread_exact(int fd, void* buffer, size_t len, uint64_t offset) {
+    uint8_t* p = static_cast<uint8_t*>(buffer);
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+struct CentralDirectory {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t entries = 0;
+};
+
+bool read_central_directory(int fd, uint64_t file_size, CentralDirectory* dir, std::string* error) {
+    if (file_size < kEndOfCentralDirSize) {
+        *error = "not a zip archive (too small)";
+        return false;
+    }
+
+    // The end record sits before a comment of up to 64 KB
+    uint64_t tail_size = std::min<uint64_t>(file_size, kEndOfCentralDirSize + kMaxCommentSize);
+    uint64_t tail_offset = file_size - tail_size;
+    std::vector<uint8_t> tail(static_cast<size_t>(tail_size));
+    if (!pread_exact(fd, tail.data(), tail.size(), tail_offset)) {
+        *error = std::string("cannot read zip trailer: ") + strerror(errno);
+        return false;
+    }
+
+    size_t eocd = std::string::npos;
+    for (size_t i = tail.size() - kEndOfCentralDirSize + 1; i-- > 0; ) {
+        if (le32(&tail[i]) == kEndOfCentralDirSig &&
+            i + kEndOfCentralDirSize + le16(&tail[i + 20]) == tail.size()) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd == std::string::npos) {
+        *error = "not a zip archive (no end of central directory)";
+        return false;
+    }
+
+    const uint8_t* record = &tail[eocd];
+    dir->entries = le16(record + 10);
+    dir->size = le32(record + 12);
+    dir->offset = le32(record + 16);
+
+    if (dir->entries == 0xffff || dir->size == 0xffffffff || dir->offset == 0xffffffff) {
+        uint64_t locator_offset = tail_offset + eocd;
+        uint8_t locator[kZip64LocatorSize];
+        uint8_t zip64[kZip64EndOfCentralDirSize];
+        if (locator_offset < kZip64LocatorSize ||
+            !pread_exact(fd, locator, sizeof(locator), locator_offset - kZip64LocatorSize) ||
+            le32(locator) != kZip64LocatorSig ||
+            !pread_exact(fd, zip64, sizeof(zip64), le64(locator + 8)) ||
+            le32(zip64) != kZip64EndOfCentralDirSig) {
+            *error = "malformed Zip64 end of central directory";
+            return false;
+        }
+        dir->entries = le64(zip64 + 32);
+        dir->size = le64(zip64 + 40);
+        dir->offset = le64(zip64 + 48);
+    }
+
+    if (dir->offset > file_size || dir->size > file_size - dir->offset) {
+        *error = "central directory outside the archive";
+        return false;
+    }
+    return true;
+}
+
+// Widen 32-bit sizes/offset from the Zip64 extra field where they are saturated
+void apply_zip64_extra(const uint8_t* extra, size_t extra_len,
+                       uint64_t* uncompressed, uint64_t* compressed, uint64_t* local_offset) {
+    size_t pos = 0;
+    while (pos + 4 <= extra_len) {
+        uint16_t id = le16(extra + pos);
+        uint16_t len = le16(extra + pos + 2);
+        if (pos + 4 + len > extra_len) {
+            return;
+        }
+        if (id == kZip64ExtraId) {
+            const uint8_t* field = extra + pos + 4;
+            size_t available = len;
+            for (uint64_t* value : {uncompressed, compressed, local_offset}) {
+                if (*value != 0xffffffff) continue;
+                if (available < 8) return;
+                *value = le64(field);
+                field += 8;
+                available -= 8;
+            }
+            return;
+        }
+        pos += 4 + len;
+    }
+}
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool copy_range(int in_fd, uint64_t offset, uint64_t length, int out_fd) {
+    off_t in_offset = static_cast<off_t>(offset);
+    uint64_t remaining = length;
+    while (remaining > 0) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, 1ull << 30));
+        ssize_t n = sendfile(out_fd, in_fd, &in_offset, chunk);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            break;
+        }
+        if (n <= 0) return false;
+        remaining -= static_cast<uint64_t>(n);
+    }
+
+    // sendfile unsupported between these files: plain buffered copy
+    std::vector<uint8_t> buffer(remaining > 0 ? 1 << 20 : 0);
+    while (remaining > 0) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+        if (!pread_exact(in_fd, buffer.data(), chunk, static_cast<uint64_t>(in_offset))) return false;
+        size_t written = 0;
+        while (written < chunk) {
+            ssize_t n = write(out_fd, buffer.data() + written, chunk - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+        }
+        in_offset += static_cast<off_t>(chunk);
+        remaining -= chunk;
+    }
+    return true;
+}
+
+// Remove copies made from earlier versions of the archive
+void remove_stale_copies(const std::string& cache_dir, const std::string& keep) {
+    DIR* dir = opendir(cache_dir.c_str());
+    if (!dir) {
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, strlen(kEmbeddedCopyPrefix), kEmbeddedCopyPrefix) == 0 && name != keep) {
+            unlink((cache_dir + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+} // namespace
+
+namespace zip {
+
+bool locate_entry(int fd, const std::string& name, ZipEntryLocation* location, std::string* error) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        *error = std::string("cannot stat archive: ") + strerror(errno);
+        return false;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    CentralDirectory dir;
+    if (!read_central_directory(fd, file_size, &dir, error)) {
+        return false;
+    }
+
+    std::vector<uint8_t> entries(static_cast<size_t>(dir.size));
+    if (!pread_exact(fd, entries.data(), entries.size(), dir.offset)) {
+        *error = std::string("cannot read central directory: ") + strerror(errno);
+        return false;
+    }
+
+    size_t pos = 0;
+    for (uint64_t i = 0; i < dir.entries; i++) {
+        if (pos + kCentralDirEntrySize > entries.size() || le32(&entries[pos]) != kCentralDirEntrySig) {
+            *error = "malformed central directory";
+            return false;
+        }
+        const uint8_t* header = &entries[pos];
+        uint16_t name_len = le16(header + 28);
+        uint16_t extra_len = le16(header + 30);
+        uint16_t comment_len = le16(header + 32);
+        size_t next = pos + kCentralDirEntrySize + name_len + extra_len + comment_len;
+        if (next > entries.size()) {
+            *error = "malformed central directory";
+            return false;
+        }
+
+        if (name_len == name.size() &&
+            std::memcmp(header + kCentralDirEntrySize, name.data(), name_len) == 0) {
+            if (le16(header + 8) & 0x1) {
+                *error = "entry " + name + " is encrypted";
+                return false;
+            }
+
+            uint64_t uncompressed = le32(header + 24);
+            uint64_t compressed = le32(header + 20);
+            uint64_t local_offset = le32(header + 42);
+            apply_zip64_extra(header + kCentralDirEntrySize + name_len, extra_len,
+                              &uncompressed, &compressed, &local_offset);
+
+            // The local header's name/extra lengths can differ from the central copy (alignment padding)
+            uint8_t local[kLocalHeaderSize];
+            if (!pread_exact(fd, local, sizeof(local), local_offset) || le32(local) != kLocalHeaderSig) {
+                *error = "bad local header for " + name;
+                return false;
+            }
+            uint64_t data_offset = local_offset + kLocalHeaderSize + le16(local + 26) + le16(local + 28);
+            if (data_offset > file_size || compressed > file_size - data_offset) {
+                *error = "entry " + name + " extends past the archive";
+                return false;
+            }
+
+            location->data_offset = data_offset;
+            location->compressed_size = compressed;
+            location->uncompressed_size = uncompressed;
+            location->method = le16(header + 10);
+            location->crc32 = le32(header + 16);
+            return true;
+        }
+        pos = next;
+    }
+
+    *error = "entry not found: " + name;
+    return false;
+}
+
+bool locate_stored_entry(int fd, const std::string& name, ModelSource* source, std::string* error) {
+    ZipEntryLocation location;
+    if (!locate_entry(fd, name, &location, error)) {
+        return false;
+    }
+    if (location.method != 0 || location.compressed_size != location.uncompressed_size) {
+        *error = "entry " + name + " is compressed (method " + std::to_string(location.method) +
+                 "); store it uncompressed to load it in place";
+        return false;
+    }
+
+    source->fd = fd;
+    source->offset = location.data_offset;
+    source->length = location.uncompressed_size;
+    return true;
+}
+
+} // namespace zip
+
+namespace model_source {
+
+bool resolve_loadable_path(const ModelSource& source, const std::string& cache_dir,
+                           std::string* path, std::string* error) {
+    struct stat st;
+    if (source.fd < 0 || fstat(source.fd, &st) != 0) {
+        *error = "invalid model source";
+        return false;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+    if (source.offset > file_size || source.length > file_size - source.offset) {
+        *error = "model range exceeds source size";
+        return false;
+    }
+
+    if (source.offset == 0 && source.length == file_size) {
+        *path = "/proc/self/fd/" + std::to_string(source.fd);
+        return true;
+    }
+
+    // Same archive version and range -> same copy
+    uint64_t key = 0xcbf29ce484222325ull;
+    uint64_t identity[] = {
+        static_cast<uint64_t>(st.st_ino), static_cast<uint64_t>(st.st_size),
+        static_cast<uint64_t>(st.st_mtime), source.offset, source.length
+    };
+    key = fnv1a(key, identity, sizeof(identity));
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s%016llx.gguf", kEmbeddedCopyPrefix, static_cast<unsigned long long>(key));
+    std::string copy_path = cache_dir + "/" + name;
+
+    struct stat copy_st;
+    if (stat(copy_path.c_str(), &copy_st) == 0 && static_cast<uint64_t>(copy_st.st_size) == source.length) {
+        *path = copy_path;
+        return true;
+    }
+
+    LOGD("Model is embedded at offset %llu; copying %llu bytes to %s",
+         static_cast<unsigned long long>(source.offset), static_cast<unsigned long long>(source.length),
+         copy_path.c_str());
+
+    std::string temp_path = copy_path + ".tmp";
+    int out_fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (out_fd < 0) {
+        *error = "cannot create " + temp_path + ": " + strerror(errno);
+        return false;
+    }
+    bool ok = copy_range(source.fd, source.offset, source.length, out_fd) && fsync(out_fd) == 0;
+    int copy_errno = errno;
+    close(out_fd);
+    if (!ok || rename(temp_path.c_str(), copy_path.c_str()) != 0) {
+        *error = std::string("cannot copy embedded model: ") + strerror(ok ? errno : copy_errno);
+        unlink(temp_path.c_str());
+        return false;
+    }
+
+    remove_stale_copies(cache_dir, name);
+    *path = copy_path;
+    return true;
+}
+
+} // namespace model_source
+
+} // namespace scrollguard
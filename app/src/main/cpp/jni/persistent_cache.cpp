@@ -0,0 +1,392 @@
+#include "../include/persistent_cache.h"
+#include "../include/content_hash.h"
+#include <android/log.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "ScrollGuard-PersistentCache"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace {
+constexpr char kMagic[4] = {'S', 'G', 'P', 'C'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr int kReadRetries = 4;
+}
+
+/**
+ * File header (64 bytes)
+ */
+struct PersistentCache::Header {
+    char magic[4];
+    uint32_t format_version;
+    uint32_t capacity;
+    uint32_t epoch;
+    uint32_t slot_size;
+    uint32_t reserved[11];
+};
+
+
+/**
+ * Table slot (32 bytes). seq == 0 means never written, an odd seq means a
+ * write is in progress (or was interrupted by a crash).
+ */
+struct PersistentCache::Slot {
+    uint32_t seq;
+    uint32_t epoch;
+    uint64_t key;
+    float confidence;
+    uint32_t flags;
+    int64_t timestamp_ms;
+};
+
+namespace {
+constexpr uint32_t kFlagProductive = 1u << 0;
+
+struct SlotSnapshot {
+    uint32_t seq;
+    uint32_t epoch;
+    uint64_t key;
+    float confidence;
+    uint32_t flags;
+    int64_t timestamp_ms;
+};
+
+template <typename T>
+T load_relaxed(const T* p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+template <typename T>
+void store_relaxed(T* p, T v) {
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+float load_float(const float* p) {
+    uint32_t bits = __atomic_load_n(reinterpret_cast<const uint32_t*>(p), __ATOMIC_RELAXED);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+void store_float(float* p, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    __atomic_store_n(reinterpret_cast<uint32_t*>(p), bits, __ATOMIC_RELAXED);
+}
+}
+
+PersistentCache::PersistentCache() = default;
+
+PersistentCache::~PersistentCache() {
+    close();
+}
+
+PersistentCache& PersistentCache::instance() {
+    static PersistentCache cache;
+    return cache;
+}
+
+uint32_t PersistentCache::compute_epoch(const std::string& model_version, const std::string& lexicon_version) {
+    std::string tag = model_version + '\n' + lexicon_version;
+    uint64_t h = content_hash::hash_string(tag);
+    uint32_t epoch = static_cast<uint32_t>(h ^ (h >> 32));
+    return epoch == 0 ? 1 : epoch;
+}
+
+bool PersistentCache::initialize_file(int fd, uint32_t capacity, uint32_t epoch) {
+    static_assert(sizeof(Header) == 64, "header must stay 64 bytes");
+    static_assert(sizeof(Slot) == 32, "slot must stay 32 bytes");
+
+    size_t file_size = sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Slot);
+
+    // Truncate to zero first so every slot starts out as never-written
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+        LOGE("Failed to size cache file: %s", strerror(errno));
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.format_version = kFormatVersion;
+    header.capacity = capacity;
+    header.epoch = epoch;
+    header.slot_size = sizeof(Slot);
+
+    if (pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        LOGE("Failed to write cache header: %s", strerror(errno));
+        return false;
+    }
+
+    fdatasync(fd);
+    return true;
+}
+
+bool PersistentCache::open(
+    const std::string& path,
+    const std::string& model_version,
+    const std::string& lexicon_version,
+    uint32_t capacity
+) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    if (mapping_) {
+        LOGD("Persistent cache already open");
+        return true;
+    }
+
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        LOGE("Cache capacity must be a power of two: %u", capacity);
+        return false;
+    }
+
+    uint32_t epoch = compute_epoch(model_version, lexicon_version);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOGE("Cannot open cache file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        LOGE("Cannot stat cache file: %s", strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    // Reuse an existing table if its header is intact and consistent with its size
+    bool reuse = false;
+    Header header;
+    if (static_cast<size_t>(st.st_size) >= sizeof(Header) &&
+        pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))) {
+        bool valid_capacity = header.capacity != 0 && (header.capacity & (header.capacity - 1)) == 0;
+        size_t expected = sizeof(Header) + static_cast<size_t>(header.capacity) * sizeof(Slot);
+        reuse = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                header.format_version == kFormatVersion &&
+                header.slot_size == sizeof(Slot) &&
+                valid_capacity &&
+                static_cast<size_t>(st.st_size) == expected;
+    }
+
+    if (reuse) {
+        capacity = header.capacity;
+    } else if (!initialize_file(fd, capacity, epoch)) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t file_size = sizeof(Header) + static_cast<size_t>(capacity) * sizeof(Slot);
+    void* mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        LOGE("Failed to map cache file: %s", strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    Header* mapped_header = static_cast<Header*>(mapping);
+    if (load_relaxed(&mapped_header->epoch) != epoch) {
+        LOGD("Model or lexicon changed, invalidating persistent cache");
+        __atomic_store_n(&mapped_header->epoch, epoch, __ATOMIC_RELEASE);
+    }
+
+    fd_ = fd;
+    mapping_ = mapping;
+    mapping_size_ = file_size;
+    slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header));
+    mask_ = capacity - 1;
+
+    // Publish last: lock-free readers test header_ before touching slots_
+    __atomic_store_n(&header_, mapped_header, __ATOMIC_RELEASE);
+
+    LOGD("Persistent cache open: %s (%u slots, %s)",
+         path.c_str(), capacity, reuse ? "reused" : "created");
+    return true;
+}
+
+void PersistentCache::close() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    if (mapping_) {
+        __atomic_store_n(&header_, static_cast<Header*>(nullptr), __ATOMIC_RELEASE);
+        msync(mapping_, mapping_size_, MS_SYNC);
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        slots_ = nullptr;
+        mapping_size_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool PersistentCache::is_open() const {
+    return __atomic_load_n(&header_, __ATOMIC_ACQUIRE) != nullptr;
+}
+
+namespace {
+// Seqlock read: returns false if the slot is mid-write or torn
+template <typename SlotT>
+bool read_slot(const SlotT* slot, SlotSnapshot* out) {
+    for (int attempt = 0; attempt < kReadRetries; attempt++) {
+        uint32_t seq_before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq_before & 1u) {
+            continue;
+        }
+
+        out->seq = seq_before;
+        out->epoch = load_relaxed(&slot->epoch);
+        out->key = load_relaxed(&slot->key);
+        out->confidence = load_float(&slot->confidence);
+        out->flags = load_relaxed(&slot->flags);
+        out->timestamp_ms = load_relaxed(&slot->timestamp_ms);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (load_relaxed(&slot->seq) == seq_before) {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+bool PersistentCache::lookup(uint64_t key, PersistentVerdict* out) const {
+    const Header* header = __atomic_load_n(&header_, __ATOMIC_ACQUIRE);
+    if (!header) {
+        return false;
+    }
+
+    uint32_t epoch = __atomic_load_n(&header->epoch, __ATOMIC_ACQUIRE);
+
+    for (uint32_t i = 0; i < kMaxProbes; i++) {
+        const Slot* slot = &slots_[(key + i) & mask_];
+
+        SlotSnapshot snapshot;
+        if (!read_slot(slot, &snapshot)) {
+            continue; // Torn or being written, keep probing
+        }
+        if (snapshot.seq == 0) {
+            return false; // Never written: end of probe chain
+        }
+        if (snapshot.key == key) {
+            if (snapshot.epoch != epoch) {
+                return false; // Produced by an older model or lexicon
+            }
+            if (out) {
+                out->is_productive = (snapshot.flags & kFlagProductive) != 0;
+                out->confidence = snapshot.confidence;
+                out->model_version = snapshot.epoch;
+                out->timestamp_ms = snapshot.timestamp_ms;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool PersistentCache::insert(uint64_t key, bool is_productive, float confidence, int64_t timestamp_ms) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    if (!header_) {
+        return false;
+    }
+
+    uint32_t epoch = load_relaxed(&header_->epoch);
+
+    // Prefer the key's own slot, then a free/stale/torn slot, then the oldest entry
+    Slot* target = nullptr;
+    Slot* reusable = nullptr;
+    Slot* oldest = nullptr;
+    int64_t oldest_timestamp = INT64_MAX;
+
+    for (uint32_t i = 0; i < kMaxProbes; i++) {
+        Slot* slot = &slots_[(key + i) & mask_];
+        uint32_t seq = load_relaxed(&slot->seq);
+
+        if (seq == 0) {
+            if (!reusable) reusable = slot;
+            break; // Key cannot live beyond the first never-written slot
+        }
+        if (seq & 1u) {
+            if (!reusable) reusable = slot; // Interrupted write from a crash
+            continue;
+        }
+        if (load_relaxed(&slot->key) == key) {
+            target = slot;
+            break;
+        }
+        if (load_relaxed(&slot->epoch) != epoch) {
+            if (!reusable) reusable = slot;
+            continue;
+        }
+        int64_t ts = load_relaxed(&slot->timestamp_ms);
+        if (ts < oldest_timestamp) {
+            oldest_timestamp = ts;
+            oldest = slot;
+        }
+    }
+
+    if (!target) target = reusable;
+    if (!target) target = oldest;
+    if (!target) {
+        return false;
+    }
+
+    uint32_t seq = load_relaxed(&target->seq);
+    uint32_t writing = (seq & 1u) ? seq : seq + 1;
+
+    __atomic_store_n(&target->seq, writing, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    store_relaxed(&target->epoch, epoch);
+    store_relaxed(&target->key, key);
+    store_float(&target->confidence, confidence);
+    store_relaxed(&target->flags, is_productive ? kFlagProductive : 0u);
+    store_relaxed(&target->timestamp_ms, timestamp_ms);
+
+    __atomic_store_n(&target->seq, writing + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool PersistentCache::invalidate(const std::string& model_version, const std::string& lexicon_version) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    if (!header_) {
+        return false;
+    }
+
+    uint32_t epoch = compute_epoch(model_version, lexicon_version);
+    if (load_relaxed(&header_->epoch) == epoch) {
+        return false;
+    }
+
+    LOGD("Invalidating persistent cache for new model/lexicon epoch");
+    __atomic_store_n(&header_->epoch, epoch, __ATOMIC_RELEASE);
+    msync(header_, sizeof(Header), MS_ASYNC);
+    return true;
+}
+
+void PersistentCache::flush(bool sync) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    if (mapping_) {
+        msync(mapping_, mapping_size_, sync ? MS_SYNC : MS_ASYNC);
+    }
+}
+
+uint32_t PersistentCache::get_epoch() const {
+    const Header* header = __atomic_load_n(&header_, __ATOMIC_ACQUIRE);
+    return header ? __atomic_load_n(&header->epoch, __ATOMIC_ACQUIRE) : 0;
+}
+
+} // namespace scrollguard
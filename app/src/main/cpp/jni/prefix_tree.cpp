@@ -0,0 +1,138 @@
+#include "../include/prefix_tree.h"
+#include <algorithm>
+
+namespace scrollguard {
+
+namespace {
+
+size_t match_length(const std::vector<TokenPrefixTree::Token>& edge, const TokenPrefixTree::Token* tokens, size_t n) {
+    size_t limit = std::min(edge.size(), n);
+    size_t i = 0;
+    while (i < limit && edge[i] == tokens[i]) {
+        i++;
+    }
+    return i;
+}
+
+} // namespace
+
+size_t TokenPrefixTree::longest_prefix(const Token* tokens, size_t n, int* slot) const {
+    const Node* node = &root_;
+    size_t matched = 0;
+    while (matched < n) {
+        auto it = node->children.find(tokens[matched]);
+        if (it == node->children.end() || it->second->slots.empty()) {
+            break;
+        }
+        const Node* child = it->second.get();
+        size_t m = match_length(child->edge, tokens + matched, n - matched);
+        matched += m;
+        *slot = child->slots.front();
+        if (m < child->edge.size()) {
+            break;
+        }
+        node = child;
+    }
+    return matched;
+}
+
+void TokenPrefixTree::insert(int slot, const Token* tokens, size_t n) {
+    erase(slot);
+    if (n == 0) {
+        return;
+    }
+    stored_[slot].assign(tokens, tokens + n);
+
+    Node* node = &root_;
+    size_t i = 0;
+    while (i < n) {
+        auto it = node->children.find(tokens[i]);
+        if (it == node->children.end()) {
+            auto leaf = std::make_unique<Node>();
+            leaf->edge.assign(tokens + i, tokens + n);
+            leaf->slots.push_back(slot);
+            node->children.emplace(tokens[i], std::move(leaf));
+            return;
+        }
+        Node* child = it->second.get();
+        size_t m = match_length(child->edge, tokens + i, n - i);
+        if (m < child->edge.size()) {
+            // The sequence ends or diverges inside the edge
+            split(child, m);
+        }
+        child->slots.push_back(slot);
+        i += m;
+        node = child;
+    }
+}
+
+void TokenPrefixTree::erase(int slot) {
+    auto stored = stored_.find(slot);
+    if (stored == stored_.end()) {
+        return;
+    }
+    const std::vector<Token>& tokens = stored->second;
+
+    // Every stored sequence ends on a node boundary, so its path is whole edges
+    std::vector<Node*> path;
+    Node* node = &root_;
+    size_t i = 0;
+    while (i < tokens.size()) {
+        auto it = node->children.find(tokens[i]);
+        if (it == node->children.end()) {
+            break;
+        }
+        Node* child = it->second.get();
+        child->slots.erase(std::remove(child->slots.begin(), child->slots.end(), slot), child->slots.end());
+        if (child->slots.empty()) {
+            // Nothing else runs through here or below
+            node->children.erase(it);
+            break;
+        }
+        path.push_back(child);
+        i += child->edge.size();
+        node = child;
+    }
+
+    // Join edges that no longer branch or end a sequence, deepest first so merged nodes are not revisited
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        Node* kept = *it;
+        while (kept->children.size() == 1) {
+            Node* only = kept->children.begin()->second.get();
+            if (only->slots.size() != kept->slots.size()) {
+                break;
+            }
+            std::unique_ptr<Node> merged = std::move(kept->children.begin()->second);
+            kept->children.clear();
+            kept->edge.insert(kept->edge.end(), merged->edge.begin(), merged->edge.end());
+            kept->children = std::move(merged->children);
+        }
+    }
+
+    stored_.erase(stored);
+}
+
+void TokenPrefixTree::clear() {
+    root_.children.clear();
+    stored_.clear();
+}
+
+const std::vector<TokenPrefixTree::Token>& TokenPrefixTree::tokens_of(int slot) const {
+    static const std::vector<Token> kEmpty;
+    auto it = stored_.find(slot);
+    return it != stored_.end() ? it->second : kEmpty;
+}
+
+void TokenPrefixTree::split(Node* node, size_t at) {
+    auto tail = std::make_unique<Node>();
+    tail->edge.assign(node->edge.begin() + static_cast<std::ptrdiff_t>(at), node->edge.end());
+    tail->slots = node->slots;
+    tail->children = std::move(node->children);
+
+    node->edge.resize(at);
+    node->children.clear();
+    Token key = tail->edge.front();
+    node->children.emplace(key, std::move(tail));
+}
+
+} // namespace scrollguard
@@ -0,0 +1,274 @@
+#include "../include/result_cache.h"
+#include <android/log.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#define LOG_TAG "ScrollGuard-Cache"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+/**
+ * One cache shard: slot array swept by a CLOCK hand plus a key -> slot index.
+ * All state is guarded by the shard mutex.
+ */
+class ResultCache::Shard {
+public:
+    bool lookup(uint64_t key, CachedVerdict* out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            misses_++;
+            return false;
+        }
+
+        Slot& slot = slots_[it->second];
+        slot.referenced = true;
+        if (out) {
+            *out = slot.verdict;
+        }
+        hits_++;
+        return true;
+    }
+
+    void insert(uint64_t key, const CachedVerdict& verdict) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        size_t cost = entry_cost(verdict);
+
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            Slot& slot = slots_[it->second];
+            bytes_ -= entry_cost(slot.verdict);
+            slot.verdict = verdict;
+            slot.referenced = true;
+            bytes_ += cost;
+            evict_to_budget(0);
+            return;
+        }
+
+        if (cost > byte_budget_) {
+            return;
+        }
+
+        evict_to_budget(cost);
+        insert_new(key, verdict, cost);
+    }
+
+    size_t preload(const std::vector<uint32_t>& indices, const uint64_t* keys, const uint8_t* is_productive,
+                   const float* confidences, const std::string& reason) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        CachedVerdict verdict;
+        verdict.reason = reason;
+        size_t cost = entry_cost(verdict);
+
+        size_t inserted = 0;
+        for (uint32_t i : indices) {
+            if (bytes_ + cost > byte_budget_) {
+                break;
+            }
+            if (index_.count(keys[i])) {
+                continue;
+            }
+
+            verdict.is_productive = is_productive[i] != 0;
+            verdict.confidence = confidences[i];
+            insert_new(keys[i], verdict, cost);
+            inserted++;
+        }
+        return inserted;
+    }
+
+    void erase(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            release_slot(it->second);
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        index_.clear();
+        slots_.clear();
+        free_slots_.clear();
+        clock_hand_ = 0;
+        bytes_ = 0;
+    }
+
+    void set_byte_budget(size_t byte_budget) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        byte_budget_ = byte_budget;
+        evict_to_budget(0);
+    }
+
+    void accumulate_stats(CacheStats* stats) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        stats->hits += hits_;
+        stats->misses += misses_;
+        stats->insertions += insertions_;
+        stats->evictions += evictions_;
+        stats->entries += index_.size();
+        stats->bytes += bytes_;
+        stats->byte_budget += byte_budget_;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        CachedVerdict verdict;
+        bool occupied = false;
+        bool referenced = false;
+    };
+
+    // Approximate footprint: slot, index node and reason string payload
+    static size_t entry_cost(const CachedVerdict& verdict) {
+        return sizeof(Slot) + 4 * sizeof(void*) + verdict.reason.size();
+    }
+
+    // Caller holds the lock, has checked the key is absent and made room
+    void insert_new(uint64_t key, const CachedVerdict& verdict, size_t cost) {
+        uint32_t slot_index;
+        if (!free_slots_.empty()) {
+            slot_index = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot_index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+
+        Slot& slot = slots_[slot_index];
+        slot.key = key;
+        slot.verdict = verdict;
+        slot.occupied = true;
+        slot.referenced = false; // Must be hit once before it survives a sweep
+
+        index_[key] = slot_index;
+        bytes_ += cost;
+        insertions_++;
+    }
+
+    void release_slot(uint32_t slot_index) {
+        Slot& slot = slots_[slot_index];
+        bytes_ -= entry_cost(slot.verdict);
+        index_.erase(slot.key);
+        slot.occupied = false;
+        slot.referenced = false;
+        slot.verdict = CachedVerdict();
+        free_slots_.push_back(slot_index);
+    }
+
+    void evict_to_budget(size_t incoming) {
+        // Each full sweep clears reference bits, so two sweeps always find a victim
+        while (!index_.empty() && bytes_ + incoming > byte_budget_) {
+            if (clock_hand_ >= slots_.size()) {
+                clock_hand_ = 0;
+            }
+
+            Slot& slot = slots_[clock_hand_];
+            if (slot.occupied) {
+                if (slot.referenced) {
+                    slot.referenced = false;
+                } else {
+                    release_slot(static_cast<uint32_t>(clock_hand_));
+                    evictions_++;
+                }
+            }
+            clock_hand_++;
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, uint32_t> index_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    size_t clock_hand_ = 0;
+    size_t bytes_ = 0;
+    size_t byte_budget_ = ResultCache::kDefaultByteBudget / ResultCache::kShardCount;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t insertions_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+ResultCache::ResultCache(size_t byte_budget)
+    : shards_(new Shard[kShardCount]) {
+    set_byte_budget(byte_budget);
+}
+
+ResultCache::~ResultCache() = default;
+
+ResultCache& ResultCache::instance() {
+    static ResultCache cache;
+    return cache;
+}
+
+ResultCache::Shard& ResultCache::shard_for(uint64_t key) const {
+    // High bits pick the shard; the per-shard map hashes on the full key
+    return shards_[key >> 60];
+}
+
+bool ResultCache::lookup(uint64_t key, CachedVerdict* out) {
+    return shard_for(key).lookup(key, out);
+}
+
+void ResultCache::insert(uint64_t key, const CachedVerdict& verdict) {
+    shard_for(key).insert(key, verdict);
+}
+
+size_t ResultCache::preload(const uint64_t* keys, const uint8_t* is_productive, const float* confidences,
+                            size_t count, const std::string& reason) {
+    // Bucket by shard so each shard lock is taken once
+    std::vector<uint32_t> by_shard[kShardCount];
+    for (size_t i = 0; i < count; i++) {
+        by_shard[keys[i] >> 60].push_back(static_cast<uint32_t>(i));
+    }
+
+    size_t inserted = 0;
+    for (size_t shard = 0; shard < kShardCount; shard++) {
+        if (!by_shard[shard].empty()) {
+            inserted += shards_[shard].preload(by_shard[shard], keys, is_productive, confidences, reason);
+        }
+    }
+
+    LOGD("Preloaded %zu of %zu stored verdicts", inserted, count);
+    return inserted;
+}
+
+void ResultCache::erase(uint64_t key) {
+    shard_for(key).erase(key);
+}
+
+void ResultCache::clear() {
+    LOGD("Clearing result cache");
+    for (size_t i = 0; i < kShardCount; i++) {
+        shards_[i].clear();
+    }
+}
+
+void ResultCache::set_byte_budget(size_t byte_budget) {
+    LOGD("Result cache byte budget: %zu", byte_budget);
+    size_t per_shard = byte_budget / kShardCount;
+    for (size_t i = 0; i < kShardCount; i++) {
+        shards_[i].set_byte_budget(per_shard);
+    }
+}
+
+CacheStats ResultCache::get_stats() const {
+    CacheStats stats;
+    for (size_t i = 0; i < kShardCount; i++) {
+        shards_[i].accumulate_stats(&stats);
+    }
+    return stats;
+}
+
+} // namespace scrollguard
@@ -0,0 +1,70 @@
+#include "../include/sequence_checkpoint.h"
+
+namespace scrollguard {
+
+void SequenceCheckpointStore::put(const std::string& key, SequenceCheckpoint checkpoint) {
+    erase(key);
+
+    Entry entry{key, std::move(checkpoint)};
+    size_t cost = entry_cost(entry);
+    if (cost > byte_budget_) {
+        return;
+    }
+
+    evict_to_budget(cost);
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+    bytes_ += cost;
+}
+
+bool SequenceCheckpointStore::take(const std::string& key, SequenceCheckpoint* out) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+
+    bytes_ -= entry_cost(*it->second);
+    *out = std::move(it->second->checkpoint);
+    entries_.erase(it->second);
+    index_.erase(it);
+    return true;
+}
+
+void SequenceCheckpointStore::erase(const std::string& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return;
+    }
+
+    bytes_ -= entry_cost(*it->second);
+    entries_.erase(it->second);
+    index_.erase(it);
+}
+
+void SequenceCheckpointStore::clear() {
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void SequenceCheckpointStore::set_byte_budget(size_t byte_budget) {
+    byte_budget_ = byte_budget;
+    evict_to_budget(0);
+}
+
+// Approximate footprint: state, tokens, key and list/index nodes
+size_t SequenceCheckpointStore::entry_cost(const Entry& entry) {
+    return entry.checkpoint.state.size() + entry.checkpoint.tokens.size() * sizeof(int32_t) +
+           2 * entry.key.size() + sizeof(Entry) + 4 * sizeof(void*);
+}
+
+void SequenceCheckpointStore::evict_to_budget(size_t incoming) {
+    while (!entries_.empty() && bytes_ + incoming > byte_budget_) {
+        const Entry& oldest = entries_.back();
+        bytes_ -= entry_cost(oldest);
+        index_.erase(oldest.key);
+        entries_.pop_back();
+    }
+}
+
+} // namespace scrollguard
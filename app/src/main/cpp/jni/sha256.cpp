@@ -0,0 +1,311 @@
+#include "../include/sha256.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2 (1 << 6)
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#define LOG_TAG "ScrollGuard-SHA256"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace sha256 {
+// Round constants, shared with the accelerated block functions
+extern const uint32_t kRoundConstants[64];
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Accelerated block functions, built with per-file ISA flags (see CMakeLists.txt)
+#if defined(__aarch64__)
+void compress_armv8(uint32_t state[8], const uint8_t* data, size_t blocks);
+#elif defined(__x86_64__) || defined(__i386__)
+void compress_shani(uint32_t state[8], const uint8_t* data, size_t blocks);
+#endif
+}
+
+namespace {
+
+constexpr uint32_t kInitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+constexpr size_t kChunkSize = 4 * 1024 * 1024;
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void compress_portable(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    while (blocks--) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be32(data + 4 * i);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                          sha256::kRoundConstants[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += Sha256::kBlockSize;
+    }
+}
+
+using CompressFn = void (*)(uint32_t*, const uint8_t*, size_t);
+
+struct Backend {
+    CompressFn compress;
+    const char* name;
+};
+
+Backend detect_backend() {
+#if defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_SHA2) {
+        return {sha256::compress_armv8, "armv8-sha2"};
+    }
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    bool sse41 = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1);
+    bool sha = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29));
+    if (sse41 && sha) {
+        return {sha256::compress_shani, "sha-ni"};
+    }
+#endif
+    return {compress_portable, "portable"};
+}
+
+const Backend& backend() {
+    static const Backend selected = detect_backend();
+    return selected;
+}
+
+} // namespace
+
+Sha256::Sha256() {
+    reset();
+}
+
+void Sha256::reset() {
+    std::memset(&state_, 0, sizeof(state_));
+    std::memcpy(state_.h, kInitialState, sizeof(kInitialState));
+}
+
+const char* Sha256::backend_name() {
+    return backend().name;
+}
+
+void Sha256::update(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    CompressFn compress = backend().compress;
+    state_.length += len;
+
+    if (state_.buffered > 0) {
+        size_t take = std::min(len, kBlockSize - state_.buffered);
+        std::memcpy(state_.buffer + state_.buffered, p, take);
+        state_.buffered += static_cast<uint32_t>(take);
+        p += take;
+        len -= take;
+        if (state_.buffered < kBlockSize) {
+            return;
+        }
+        compress(state_.h, state_.buffer, 1);
+        state_.buffered = 0;
+    }
+
+    // Whole blocks straight from the caller's buffer
+    size_t blocks = len / kBlockSize;
+    if (blocks > 0) {
+        compress(state_.h, p, blocks);
+        p += blocks * kBlockSize;
+        len -= blocks * kBlockSize;
+    }
+
+    if (len > 0) {
+        std::memcpy(state_.buffer, p, len);
+        state_.buffered = static_cast<uint32_t>(len);
+    }
+}
+
+void Sha256::finish(uint8_t digest[kDigestSize]) {
+    uint64_t bit_length = state_.length * 8;
+
+    uint8_t padding[kBlockSize * 2] = {0x80};
+    size_t pad_len = (state_.buffered < 56) ? 56 - state_.buffered : 120 - state_.buffered;
+    for (int i = 0; i < 8; i++) {
+        padding[pad_len + i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+    }
+
+    uint64_t length = state_.length;
+    update(padding, pad_len + 8);
+    state_.length = length;
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = static_cast<uint8_t>(state_.h[i] >> 24);
+        digest[4 * i + 1] = static_cast<uint8_t>(state_.h[i] >> 16);
+        digest[4 * i + 2] = static_cast<uint8_t>(state_.h[i] >> 8);
+        digest[4 * i + 3] = static_cast<uint8_t>(state_.h[i]);
+    }
+}
+
+std::string Sha256::finish_hex() {
+    static const char kHex[] = "0123456789abcdef";
+
+    uint8_t digest[kDigestSize];
+    finish(digest);
+
+    std::string hex(kDigestSize * 2, '0');
+    for (size_t i = 0; i < kDigestSize; i++) {
+        hex[2 * i] = kHex[digest[i] >> 4];
+        hex[2 * i + 1] = kHex[digest[i] & 0xf];
+    }
+    return hex;
+}
+
+namespace sha256 {
+
+bool hash_file(const std::string& path, std::string* hex_digest, const ProgressCallback& progress) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Cannot open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        LOGE("Cannot stat %s: %s", path.c_str(), strerror(errno));
+        close(fd);
+        return false;
+    }
+    uint64_t total = static_cast<uint64_t>(st.st_size);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Double buffer: the reader thread fills one chunk while the other is hashed
+    std::unique_ptr<uint8_t[]> buffers[2] = {
+        std::unique_ptr<uint8_t[]>(new uint8_t[kChunkSize]),
+        std::unique_ptr<uint8_t[]>(new uint8_t[kChunkSize])
+    };
+
+    auto read_chunk = [fd](uint8_t* buffer, uint64_t offset) -> ssize_t {
+        size_t filled = 0;
+        while (filled < kChunkSize) {
+            ssize_t n = pread(fd, buffer + filled, kChunkSize - filled, static_cast<off_t>(offset + filled));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return -1;
+            if (n == 0) break;
+            filled += static_cast<size_t>(n);
+        }
+        return static_cast<ssize_t>(filled);
+    };
+
+    Sha256 hasher;
+    uint64_t offset = 0;
+    int current = 0;
+    ssize_t current_len = read_chunk(buffers[current].get(), offset);
+    bool ok = current_len >= 0;
+
+    while (ok && current_len > 0) {
+        ssize_t next_len = 0;
+        uint64_t next_offset = offset + static_cast<uint64_t>(current_len);
+        std::thread reader;
+        if (static_cast<size_t>(current_len) == kChunkSize) {
+            reader = std::thread([&, next_offset]() {
+                next_len = read_chunk(buffers[current ^ 1].get(), next_offset);
+            });
+        }
+
+        hasher.update(buffers[current].get(), static_cast<size_t>(current_len));
+        offset = next_offset;
+
+        if (reader.joinable()) {
+            reader.join();
+        }
+        if (next_len < 0) {
+            LOGE("Read error in %s: %s", path.c_str(), strerror(errno));
+            ok = false;
+            break;
+        }
+
+        if (progress && !progress(offset, total)) {
+            LOGD("Hashing of %s cancelled at %llu bytes", path.c_str(), static_cast<unsigned long long>(offset));
+            ok = false;
+            break;
+        }
+
+        current ^= 1;
+        current_len = next_len;
+    }
+
+    close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    *hex_digest = hasher.finish_hex();
+    LOGD("SHA-256 of %s (%llu bytes, %s): %s", path.c_str(),
+         static_cast<unsigned long long>(offset), Sha256::backend_name(), hex_digest->c_str());
+    return true;
+}
+
+bool verify_file(const std::string& path, const std::string& expected_hex, const ProgressCallback& progress) {
+    std::string actual;
+    if (!hash_file(path, &actual, progress)) {
+        return false;
+    }
+
+    std::string expected = expected_hex;
+    std::transform(expected.begin(), expected.end(), expected.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    if (actual != expected) {
+        LOGE("Checksum mismatch for %s: expected %s, got %s", path.c_str(), expected.c_str(), actual.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace sha256
+
+} // namespace scrollguard
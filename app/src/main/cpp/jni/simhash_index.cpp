@@ -0,0 +1,231 @@
+#include "../include/simhash_index.h"
+#include "../include/content_hash.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
+#define LOG_TAG "ScrollGuard-SimHash"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+namespace simhash {
+
+bool compute(const std::string& text, uint64_t* fingerprint, size_t* word_count) {
+    // Word hashes; the text is expected to be canonicalized (lower-case, single spaces)
+    std::vector<uint64_t> words;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        size_t start = pos;
+        while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        if (pos > start) {
+            words.push_back(content_hash::hash64(text.data() + start, pos - start));
+        }
+    }
+
+    if (word_count) {
+        *word_count = words.size();
+    }
+    if (words.size() < kMinWords) {
+        return false;
+    }
+
+    int counters[64] = {0};
+    auto accumulate = [&counters](uint64_t feature) {
+        for (int bit = 0; bit < 64; bit++) {
+            counters[bit] += ((feature >> bit) & 1u) ? 1 : -1;
+        }
+    };
+
+    // Unigrams capture vocabulary, bigrams capture local word order
+    for (size_t i = 0; i < words.size(); i++) {
+        accumulate(words[i]);
+        if (i + 1 < words.size()) {
+            accumulate(content_hash::combine(words[i], words[i + 1]));
+        }
+    }
+
+    uint64_t result = 0;
+    for (int bit = 0; bit < 64; bit++) {
+        if (counters[bit] > 0) {
+            result |= 1ull << bit;
+        }
+    }
+
+    *fingerprint = result;
+    return true;
+}
+
+int max_distance_for(size_t word_count) {
+    size_t distance = std::max<size_t>(word_count / kWordsPerDistanceBit, 1);
+    return static_cast<int>(std::min<size_t>(distance, SimHashIndex::kMaxSupportedDistance));
+}
+
+} // namespace simhash
+
+SimHashIndex::SimHashIndex(size_t capacity, int max_distance)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      max_distance_(std::min(std::max(max_distance, 1), kMaxSupportedDistance)),
+      block_count_(max_distance_ + 1),
+      block_bits_(64 / block_count_),
+      entries_(capacity_),
+      tables_(block_count_) {
+}
+
+SimHashIndex& SimHashIndex::instance() {
+    static SimHashIndex index;
+    return index;
+}
+
+uint32_t SimHashIndex::block_of(uint64_t fingerprint, int table) const {
+    int start = table * block_bits_;
+    int width = (table == block_count_ - 1) ? 64 - start : block_bits_;
+    uint64_t mask = (1ull << width) - 1;
+    return static_cast<uint32_t>((fingerprint >> start) & mask);
+}
+
+bool SimHashIndex::find(uint64_t fingerprint, NearDuplicateMatch* out, int max_distance) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    // The tables only guarantee matches up to max_distance_, so it is never loosened
+    int limit = max_distance < 0 ? max_distance_ : std::min(max_distance, max_distance_);
+    int best_distance = limit + 1;
+    const Entry* best = nullptr;
+
+    for (int table = 0; table < block_count_ && best_distance > 0; table++) {
+        const auto& buckets = tables_[table];
+        auto it = buckets.find(block_of(fingerprint, table));
+        if (it == buckets.end()) {
+            continue;
+        }
+
+        for (uint32_t entry_index : it->second) {
+            const Entry& entry = entries_[entry_index];
+            int distance = simhash::hamming_distance(entry.fingerprint, fingerprint);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best = &entry;
+                if (distance == 0) break;
+            }
+        }
+    }
+
+    if (!best) {
+        return false;
+    }
+
+    if (out) {
+        out->is_productive = best->is_productive;
+        out->confidence = best->confidence;
+        out->distance = best_distance;
+    }
+    return true;
+}
+
+void SimHashIndex::unlink(uint32_t entry_index) {
+    const Entry& entry = entries_[entry_index];
+    for (int table = 0; table < block_count_; table++) {
+        auto it = tables_[table].find(block_of(entry.fingerprint, table));
+        if (it == tables_[table].end()) {
+            continue;
+        }
+
+        auto& bucket = it->second;
+        auto pos = std::find(bucket.begin(), bucket.end(), entry_index);
+        if (pos != bucket.end()) {
+            *pos = bucket.back();
+            bucket.pop_back();
+        }
+        if (bucket.empty()) {
+            tables_[table].erase(it);
+        }
+    }
+}
+
+void SimHashIndex::insert(uint64_t fingerprint, bool is_productive, float confidence) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    // Refresh an exact duplicate in place instead of storing it twice
+    auto existing = tables_[0].find(block_of(fingerprint, 0));
+    if (existing != tables_[0].end()) {
+        for (uint32_t entry_index : existing->second) {
+            Entry& entry = entries_[entry_index];
+            if (entry.fingerprint == fingerprint) {
+                entry.is_productive = is_productive;
+                entry.confidence = confidence;
+                return;
+            }
+        }
+    }
+
+    uint32_t slot = static_cast<uint32_t>(next_slot_);
+    next_slot_ = (next_slot_ + 1) % capacity_;
+
+    Entry& entry = entries_[slot];
+    if (entry.occupied) {
+        unlink(slot);
+    } else {
+        size_++;
+    }
+
+    entry.fingerprint = fingerprint;
+    entry.is_productive = is_productive;
+    entry.confidence = confidence;
+    entry.occupied = true;
+
+    for (int table = 0; table < block_count_; table++) {
+        tables_[table][block_of(fingerprint, table)].push_back(slot);
+    }
+}
+
+size_t SimHashIndex::erase_near(uint64_t fingerprint, int max_distance) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    int limit = max_distance < 0 ? max_distance_ : std::min(max_distance, max_distance_);
+
+    // Collect first: unlinking rewrites the buckets being scanned
+    std::vector<uint32_t> matches;
+    for (int table = 0; table < block_count_; table++) {
+        auto it = tables_[table].find(block_of(fingerprint, table));
+        if (it == tables_[table].end()) {
+            continue;
+        }
+        for (uint32_t entry_index : it->second) {
+            if (simhash::hamming_distance(entries_[entry_index].fingerprint, fingerprint) <= limit &&
+                std::find(matches.begin(), matches.end(), entry_index) == matches.end()) {
+                matches.push_back(entry_index);
+            }
+        }
+    }
+
+    for (uint32_t entry_index : matches) {
+        unlink(entry_index);
+        entries_[entry_index] = Entry();
+        size_--;
+    }
+    if (!matches.empty()) {
+        LOGD("Dropped %zu near-duplicate entries", matches.size());
+    }
+    return matches.size();
+}
+
+void SimHashIndex::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    for (auto& table : tables_) {
+        table.clear();
+    }
+    std::fill(entries_.begin(), entries_.end(), Entry());
+    next_slot_ = 0;
+    size_ = 0;
+}
+
+size_t SimHashIndex::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_;
+}
+
+} // namespace scrollguard
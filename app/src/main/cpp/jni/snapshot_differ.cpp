@@ -0,0 +1,69 @@
+#include "../include/snapshot_differ.h"
+#include <android/log.h>
+
+#define LOG_TAG "ScrollGuard-SnapshotDiffer"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace scrollguard {
+
+SnapshotDiffer& SnapshotDiffer::instance() {
+    static SnapshotDiffer differ;
+    return differ;
+}
+
+std::vector<int> SnapshotDiffer::diff(const std::string& window_key, const std::vector<uint64_t>& hashes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = windows_.find(window_key);
+    if (it == windows_.end()) {
+        if (windows_.size() >= kMaxWindows) {
+            evict_least_recent();
+        }
+        it = windows_.emplace(window_key, WindowState()).first;
+    }
+
+    WindowState& window = it->second;
+    window.last_used = ++tick_;
+
+    std::unordered_set<uint64_t> current;
+    current.reserve(hashes.size());
+
+    std::vector<int> changed;
+    for (size_t i = 0; i < hashes.size(); i++) {
+        bool first_occurrence = current.insert(hashes[i]).second;
+        if (first_occurrence && window.hashes.count(hashes[i]) == 0) {
+            changed.push_back(static_cast<int>(i));
+        }
+    }
+
+    window.hashes.swap(current);
+
+    LOGD("Snapshot diff for %s: %zu of %zu entries changed",
+         window_key.c_str(), changed.size(), hashes.size());
+    return changed;
+}
+
+void SnapshotDiffer::reset(const std::string& window_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (window_key.empty()) {
+        windows_.clear();
+    } else {
+        windows_.erase(window_key);
+    }
+}
+
+void SnapshotDiffer::evict_least_recent() {
+    auto oldest = windows_.begin();
+    for (auto it = windows_.begin(); it != windows_.end(); ++it) {
+        if (it->second.last_used < oldest->second.last_used) {
+            oldest = it;
+        }
+    }
+    if (oldest != windows_.end()) {
+        windows_.erase(oldest);
+    }
+}
+
+} // namespace scrollguard
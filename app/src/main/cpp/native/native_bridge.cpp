@@ -2,7 +2,24 @@
 #include <android/log.h>
 #include <string>
 #include <memory>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
 #include "../include/llama_wrapper.h"
+#include "../include/content_canonicalizer.h"
+#include "../include/result_cache.h"
+#include "../include/persistent_cache.h"
+#include "../include/simhash_index.h"
+#include "../include/snapshot_differ.h"
+#include "../include/bloom_filter.h"
+#include "../include/sha256.h"
+#include "../include/model_downloader.h"
+#include "../include/model_prefetcher.h"
+#include "../include/model_source.h"
+#include "../include/model_quantizer.h"
+#include "../include/model_registry.h"
+#include "../include/gguf_parser.h"
 
 #define LOG_TAG "ScrollGuard-Native"
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
@@ -13,6 +30,270 @@ using namespace scrollguard;
 // Global model instance
 static std::unique_ptr<LlamaWrapper> g_llama_wrapper = nullptr;
 
+/**
+ * Two-tier verdict lookup: in-memory result cache, then the persistent
+ * mmap'd cache (promoting hits into memory)
+ */
+static bool lookup_cached_verdict(uint64_t key, CachedVerdict* verdict) {
+    if (ResultCache::instance().lookup(key, verdict)) {
+        return true;
+    }
+
+    PersistentVerdict stored;
+    if (!PersistentCache::instance().lookup(key, &stored)) {
+        return false;
+    }
+
+    verdict->is_productive = stored.is_productive;
+    verdict->confidence = stored.confidence;
+    verdict->reason = "persistent_cache";
+    verdict->processing_time_ms = 0;
+    ResultCache::instance().insert(key, *verdict);
+    if (verdict->is_productive) {
+        RotatingBloomFilter::instance().insert(key);
+    }
+    return true;
+}
+
+// Escape generated text for embedding in a JSON string
+static std::string json_escape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped += c;
+                }
+        }
+    }
+    return escaped;
+}
+
+static int64_t current_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+/**
+ * JNIEnv for the current thread, attaching native worker threads to the VM
+ * for the lifetime of the scope
+ */
+class ScopedJniEnv {
+public:
+    explicit ScopedJniEnv(JavaVM* vm) : vm_(vm) {
+        if (vm_->GetEnv(reinterpret_cast<void**>(&env_), JNI_VERSION_1_6) == JNI_EDETACHED) {
+            attached_ = vm_->AttachCurrentThread(&env_, nullptr) == JNI_OK;
+            if (!attached_) env_ = nullptr;
+        }
+    }
+
+    ~ScopedJniEnv() {
+        if (attached_) vm_->DetachCurrentThread();
+    }
+
+    JNIEnv* get() const { return env_; }
+
+private:
+    JavaVM* vm_;
+    JNIEnv* env_ = nullptr;
+    bool attached_ = false;
+};
+
+/**
+ * JNIEnv for the current thread, attached once and kept until the thread
+ * exits. Used for per-token callbacks, where attaching and detaching around
+ * every call would cost more than the token.
+ */
+static JNIEnv* cached_jni_env(JavaVM* vm) {
+    struct ThreadEnv {
+        JavaVM* vm = nullptr;
+        JNIEnv* env = nullptr;
+        bool attached = false;
+        ~ThreadEnv() {
+            if (attached) vm->DetachCurrentThread();
+        }
+    };
+    thread_local ThreadEnv cached;
+
+    if (cached.env && cached.vm == vm) {
+        return cached.env;
+    }
+    cached.vm = vm;
+    if (vm->GetEnv(reinterpret_cast<void**>(&cached.env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        cached.attached = vm->AttachCurrentThread(&cached.env, nullptr) == JNI_OK;
+        if (!cached.attached) cached.env = nullptr;
+    }
+    return cached.env;
+}
+
+/**
+ * Generated text sink backed by a Kotlin LlamaInference.TokenListener.
+ * Safe to call from any thread; an exception in onToken stops generation
+ * and is left pending if it was thrown on the thread that created the listener.
+ */
+class JavaTokenListener {
+public:
+    JavaTokenListener(JNIEnv* env, jobject listener) : owner_env_(env) {
+        env->GetJavaVM(&vm_);
+        if (!listener) {
+            return;
+        }
+        jclass listener_class = env->GetObjectClass(listener);
+        on_token_ = env->GetMethodID(listener_class, "onToken", "(Ljava/lang/String;)Z");
+        env->DeleteLocalRef(listener_class);
+        if (!on_token_) {
+            env->ExceptionClear();
+            LOGE("Listener has no onToken(String): Boolean");
+            return;
+        }
+        listener_ = env->NewGlobalRef(listener);
+    }
+
+    ~JavaTokenListener() {
+        if (listener_) owner_env_->DeleteGlobalRef(listener_);
+    }
+
+    JavaTokenListener(const JavaTokenListener&) = delete;
+    JavaTokenListener& operator=(const JavaTokenListener&) = delete;
+
+    // Callback for the wrapper, or null when there is no usable listener
+    TokenCallback callback() {
+        if (!listener_) return nullptr;
+        return [this](const std::string& piece) { return on_token(piece); };
+    }
+
+private:
+    bool on_token(const std::string& piece) {
+        JNIEnv* env = cached_jni_env(vm_);
+        if (!env) return false;
+
+        jstring text = env->NewStringUTF(piece.c_str());
+        if (!text) {
+            env->ExceptionClear();
+            return true;
+        }
+        jboolean keep_going = env->CallBooleanMethod(listener_, on_token_, text);
+        env->DeleteLocalRef(text);
+        if (env->ExceptionCheck()) {
+            if (env != owner_env_) env->ExceptionClear();
+            return false;
+        }
+        return keep_going == JNI_TRUE;
+    }
+
+    JavaVM* vm_ = nullptr;
+    JNIEnv* owner_env_;
+    jobject listener_ = nullptr;
+    jmethodID on_token_ = nullptr;
+};
+
+/**
+ * Range fetcher backed by a Kotlin NativeModelDownloader.RangeSource, so
+ * HTTPS goes through the platform network stack. Called from the
+ * downloader's worker threads.
+ */
+class JavaRangeFetcher : public RangeFetcher {
+public:
+    JavaRangeFetcher(JNIEnv* env, jobject source) {
+        env->GetJavaVM(&vm_);
+        source_ = env->NewGlobalRef(source);
+        jclass source_class = env->GetObjectClass(source);
+        content_length_ = env->GetMethodID(source_class, "contentLength", "(Ljava/lang/String;)J");
+        fetch_range_ = env->GetMethodID(source_class, "fetchRange", "(Ljava/lang/String;JI)[B");
+        env->DeleteLocalRef(source_class);
+        // A missing method leaves NoSuchMethodError pending; is_valid() reports it instead
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+        }
+    }
+
+    ~JavaRangeFetcher() override {
+        ScopedJniEnv env(vm_);
+        if (env.get()) env.get()->DeleteGlobalRef(source_);
+    }
+
+    bool is_valid() const { return content_length_ && fetch_range_; }
+
+    bool content_length(const std::string& url, uint64_t* length, std::string* error) override {
+        ScopedJniEnv scoped(vm_);
+        JNIEnv* env = scoped.get();
+        if (!env) {
+            *error = "Cannot attach to JVM";
+            return false;
+        }
+
+        jstring jurl = env->NewStringUTF(url.c_str());
+        jlong result = env->CallLongMethod(source_, content_length_, jurl);
+        env->DeleteLocalRef(jurl);
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            result = -1;
+        }
+        if (result <= 0) {
+            *error = "Cannot determine download size";
+            return false;
+        }
+        *length = static_cast<uint64_t>(result);
+        return true;
+    }
+
+    bool fetch_range(const std::string& url, uint64_t offset, uint64_t length,
+                     const Sink& sink, std::string* error) override {
+        if (length > static_cast<uint64_t>(INT32_MAX)) {
+            *error = "Range too large";
+            return false;
+        }
+
+        ScopedJniEnv scoped(vm_);
+        JNIEnv* env = scoped.get();
+        if (!env) {
+            *error = "Cannot attach to JVM";
+            return false;
+        }
+
+        jstring jurl = env->NewStringUTF(url.c_str());
+        jbyteArray bytes = static_cast<jbyteArray>(env->CallObjectMethod(
+            source_, fetch_range_, jurl, static_cast<jlong>(offset), static_cast<jint>(length)));
+        env->DeleteLocalRef(jurl);
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            bytes = nullptr;
+        }
+        if (!bytes) {
+            *error = "Range request failed";
+            return false;
+        }
+
+        jsize size = env->GetArrayLength(bytes);
+        std::vector<uint8_t> buffer(static_cast<size_t>(size));
+        env->GetByteArrayRegion(bytes, 0, size, reinterpret_cast<jbyte*>(buffer.data()));
+        env->DeleteLocalRef(bytes);
+
+        if (static_cast<uint64_t>(size) != length) {
+            *error = "Short range: " + std::to_string(size) + " of " + std::to_string(length) + " bytes";
+            return false;
+        }
+        return sink(buffer.data(), buffer.size());
+    }
+
+private:
+    JavaVM* vm_ = nullptr;
+    jobject source_ = nullptr;
+    jmethodID content_length_ = nullptr;
+    jmethodID fetch_range_ = nullptr;
+};
+
 extern "C" {
 
 /**
@@ -77,6 +358,172 @@ Java_com_scrollguard_app_service_llm_LlamaInference_nativeLoadModel(
     return success ? JNI_TRUE : JNI_FALSE;
 }
 
+/**
+ * Load a model stored uncompressed inside another file (APK asset or zip
+ * bundle entry) without extracting it first where possible
+ * @param fd Open descriptor of the containing file; may be closed after this returns
+ * @param cache_dir Where an embedded model is copied once if it cannot be opened in place
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeLoadModelFromFd(
+    JNIEnv *env,
+    jobject thiz,
+    jint fd,
+    jlong offset,
+    jlong length,
+    jstring cache_dir,
+    jint n_ctx,
+    jint n_threads,
+    jfloat temperature
+) {
+    if (!g_llama_wrapper) {
+        LOGE("LLama wrapper not initialized");
+        return JNI_FALSE;
+    }
+    if (fd < 0 || offset < 0 || length <= 0) {
+        LOGE("Invalid model source: fd=%d offset=%lld length=%lld", fd,
+             static_cast<long long>(offset), static_cast<long long>(length));
+        return JNI_FALSE;
+    }
+
+    const char* cache_cstr = env->GetStringUTFChars(cache_dir, nullptr);
+    if (!cache_cstr) {
+        LOGE("Failed to get cache directory string");
+        return JNI_FALSE;
+    }
+    std::string cache_dir_str(cache_cstr);
+    env->ReleaseStringUTFChars(cache_dir, cache_cstr);
+
+    ModelSource source;
+    source.fd = fd;
+    source.offset = static_cast<uint64_t>(offset);
+    source.length = static_cast<uint64_t>(length);
+
+    // Validate in place before anything is copied
+    {
+        GgufFile gguf;
+        if (!gguf.open(source.fd, source.offset, source.length)) {
+            LOGE("Embedded model is not a valid GGUF: %s", gguf.error().c_str());
+            return JNI_FALSE;
+        }
+    }
+
+    std::string path;
+    std::string error;
+    if (!model_source::resolve_loadable_path(source, cache_dir_str, &path, &error)) {
+        LOGE("Cannot open embedded model: %s", error.c_str());
+        return JNI_FALSE;
+    }
+
+    ModelConfig config;
+    config.model_path = path;
+    config.n_ctx = n_ctx;
+    config.n_threads = n_threads;
+    config.temperature = temperature;
+
+    LOGD("Loading model from fd %d at offset %lld: %s", fd, static_cast<long long>(offset), path.c_str());
+
+    bool success = g_llama_wrapper->load_model(config);
+    if (success) {
+        LOGD("Model loaded successfully");
+    } else {
+        LOGE("Failed to load model");
+    }
+    return success ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Locate an uncompressed entry of a zip archive
+ * @return [offset, length] of the entry data, or null if missing or compressed
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeLocateStoredEntry(
+    JNIEnv *env,
+    jobject thiz,
+    jint fd,
+    jstring entry_name
+) {
+    const char* name_cstr = env->GetStringUTFChars(entry_name, nullptr);
+    if (!name_cstr) {
+        LOGE("Failed to get entry name string");
+        return nullptr;
+    }
+    std::string name(name_cstr);
+    env->ReleaseStringUTFChars(entry_name, name_cstr);
+
+    ModelSource source;
+    std::string error;
+    if (!zip::locate_stored_entry(fd, name, &source, &error)) {
+        LOGE("Cannot locate %s: %s", name.c_str(), error.c_str());
+        return nullptr;
+    }
+
+    jlong values[2] = {static_cast<jlong>(source.offset), static_cast<jlong>(source.length)};
+    jlongArray result = env->NewLongArray(2);
+    if (result) {
+        env->SetLongArrayRegion(result, 0, 2, values);
+    }
+    return result;
+}
+
+/**
+ * Classify content, then generate the reason and stream it to the listener's
+ * onToken(String): Boolean as it is produced; returning false stops the
+ * reason early. Returns the same JSON as nativeClassifyContent, with the
+ * generated text as reason.
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeClassifyContentStreaming(
+    JNIEnv *env,
+    jobject thiz,
+    jstring content,
+    jstring context,
+    jint max_reason_tokens,
+    jobject listener
+) {
+    if (!g_llama_wrapper || !g_llama_wrapper->is_model_loaded()) {
+        LOGE("Model not loaded");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Model not loaded\"}");
+    }
+
+    const char* content_cstr = env->GetStringUTFChars(content, nullptr);
+    if (!content_cstr) {
+        LOGE("Failed to get content string");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid content\"}");
+    }
+    std::string content_str(content_cstr);
+    env->ReleaseStringUTFChars(content, content_cstr);
+
+    std::string context_str;
+    if (context) {
+        const char* context_cstr = env->GetStringUTFChars(context, nullptr);
+        if (context_cstr) {
+            context_str = context_cstr;
+            env->ReleaseStringUTFChars(context, context_cstr);
+        }
+    }
+
+    JavaTokenListener java_listener(env, listener);
+    ClassificationResult result = g_llama_wrapper->classify_content_streaming(
+        content_str, context_str, java_listener.callback(), max_reason_tokens);
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+
+    std::string json_result = "{"
+        "\"success\":" + std::string(result.success ? "true" : "false") + ","
+        "\"is_productive\":" + std::string(result.is_productive ? "true" : "false") + ","
+        "\"confidence\":" + std::to_string(result.confidence) + ","
+        "\"reason\":\"" + json_escape(result.reason) + "\","
+        "\"processing_time_ms\":" + std::to_string(result.processing_time_ms);
+    if (!result.success) {
+        json_result += ",\"error\":\"" + json_escape(result.error_message) + "\"";
+    }
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
 /**
  * Check if model is loaded
  */
@@ -123,11 +570,11 @@ Java_com_scrollguard_app_service_llm_LlamaInference_nativeClassifyContent(
         "\"success\":" + std::string(result.success ? "true" : "false") + ","
         "\"is_productive\":" + std::string(result.is_productive ? "true" : "false") + ","
         "\"confidence\":" + std::to_string(result.confidence) + ","
-        "\"reason\":\"" + result.reason + "\","
+        "\"reason\":\"" + json_escape(result.reason) + "\","
         "\"processing_time_ms\":" + std::to_string(result.processing_time_ms);
     
     if (!result.success) {
-        json_result += ",\"error\":\"" + result.error_message + "\"";
+        json_result += ",\"error\":\"" + json_escape(result.error_message) + "\"";
     }
     
     json_result += "}";
@@ -170,10 +617,1213 @@ Java_com_scrollguard_app_service_llm_LlamaInference_nativeWarmUp(JNIEnv *env, jo
 JNIEXPORT void JNICALL
 Java_com_scrollguard_app_service_llm_LlamaInference_nativeCleanup(JNIEnv *env, jobject thiz) {
     LOGD("Cleaning up native resources");
+    ModelPrefetcher::instance().stop();
     if (g_llama_wrapper) {
         g_llama_wrapper->unload_model();
         g_llama_wrapper.reset();
     }
 }
 
-} // extern "C"
\ No newline at end of file
+/**
+ * Load the cascade's escalation model; low-margin verdicts of the main
+ * model are re-scored by it
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeLoadEscalationModel(
+    JNIEnv *env,
+    jobject thiz,
+    jstring model_path,
+    jint n_ctx,
+    jint n_threads,
+    jfloat escalation_margin,
+    jint idle_release_seconds
+) {
+    if (!g_llama_wrapper) {
+        LOGE("LLama wrapper not initialized");
+        return JNI_FALSE;
+    }
+
+    const char* path_cstr = env->GetStringUTFChars(model_path, nullptr);
+    if (!path_cstr) {
+        LOGE("Failed to get model path string");
+        return JNI_FALSE;
+    }
+
+    ModelConfig config;
+    config.model_path = std::string(path_cstr);
+    config.n_ctx = n_ctx;
+    config.n_threads = n_threads;
+    env->ReleaseStringUTFChars(model_path, path_cstr);
+
+    CascadeConfig cascade;
+    cascade.escalation_margin = escalation_margin;
+    cascade.idle_release_seconds = idle_release_seconds;
+
+    return g_llama_wrapper->load_escalation_model(config, cascade) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Stop escalating and free the escalation model
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeUnloadEscalationModel(JNIEnv *env, jobject thiz) {
+    if (g_llama_wrapper) {
+        g_llama_wrapper->unload_escalation_model();
+    }
+}
+
+/**
+ * Generate a short reason for a verdict. Text is streamed to the listener's
+ * onToken(String): Boolean on the calling thread as it is produced; returning
+ * false stops generation. The full text and decoding statistics are returned
+ * as JSON.
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeGenerateExplanation(
+    JNIEnv *env,
+    jobject thiz,
+    jstring content,
+    jboolean is_productive,
+    jint max_tokens,
+    jobject listener
+) {
+    if (!g_llama_wrapper) {
+        LOGE("LLama wrapper not initialized");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Wrapper not initialized\"}");
+    }
+
+    const char* content_cstr = env->GetStringUTFChars(content, nullptr);
+    if (!content_cstr) {
+        LOGE("Failed to get content string");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid content\"}");
+    }
+    std::string content_str(content_cstr);
+    env->ReleaseStringUTFChars(content, content_cstr);
+
+    ExplanationConfig config;
+    config.max_tokens = max_tokens;
+
+    JavaTokenListener java_listener(env, listener);
+
+    ExplanationResult result = g_llama_wrapper->generate_explanation(
+        content_str, is_productive == JNI_TRUE, config, java_listener.callback());
+    if (env->ExceptionCheck()) {
+        return nullptr;
+    }
+
+    std::string json_result = "{";
+    json_result += "\"success\":" + std::string(result.success ? "true" : "false");
+    json_result += ",\"text\":\"" + json_escape(result.text) + "\"";
+    json_result += ",\"tokens\":" + std::to_string(result.n_tokens);
+    json_result += ",\"drafted\":" + std::to_string(result.n_drafted);
+    json_result += ",\"accepted\":" + std::to_string(result.n_accepted);
+    json_result += ",\"target_passes\":" + std::to_string(result.target_passes);
+    json_result += ",\"time_ms\":" + std::to_string(result.processing_time_ms);
+    if (!result.error_message.empty()) {
+        json_result += ",\"error\":\"" + json_escape(result.error_message) + "\"";
+    }
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Open a caption session for a video whose caption grows over time
+ * @return Session id, or -1 if the wrapper is not initialized
+ */
+JNIEXPORT jint JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeOpenCaptionSession(
+    JNIEnv *env,
+    jobject thiz,
+    jstring context
+) {
+    if (!g_llama_wrapper) {
+        LOGE("LLama wrapper not initialized");
+        return -1;
+    }
+
+    std::string context_str;
+    if (context) {
+        const char* context_cstr = env->GetStringUTFChars(context, nullptr);
+        if (context_cstr) {
+            context_str = context_cstr;
+            env->ReleaseStringUTFChars(context, context_cstr);
+        }
+    }
+    return g_llama_wrapper->open_caption_session(context_str);
+}
+
+/**
+ * Classify the caption so far; only tokens added since the previous update
+ * are prefilled. Returns the nativeClassifyContent JSON plus stable and
+ * decoded_tokens.
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeUpdateCaptionSession(
+    JNIEnv *env,
+    jobject thiz,
+    jint session,
+    jstring caption
+) {
+    if (!g_llama_wrapper) {
+        LOGE("LLama wrapper not initialized");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Wrapper not initialized\"}");
+    }
+
+    const char* caption_cstr = env->GetStringUTFChars(caption, nullptr);
+    if (!caption_cstr) {
+        LOGE("Failed to get caption string");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid content\"}");
+    }
+    std::string caption_str(caption_cstr);
+    env->ReleaseStringUTFChars(caption, caption_cstr);
+
+    CaptionResult update = g_llama_wrapper->update_caption_session(session, caption_str);
+    const ClassificationResult& result = update.classification;
+
+    std::string json_result = "{"
+        "\"success\":" + std::string(result.success ? "true" : "false") + ","
+        "\"is_productive\":" + std::string(result.is_productive ? "true" : "false") + ","
+        "\"confidence\":" + std::to_string(result.confidence) + ","
+        "\"reason\":\"" + json_escape(result.reason) + "\","
+        "\"processing_time_ms\":" + std::to_string(result.processing_time_ms) + ","
+        "\"stable\":" + std::string(update.stable ? "true" : "false") + ","
+        "\"decoded_tokens\":" + std::to_string(update.n_decoded);
+    if (!result.success) {
+        json_result += ",\"error\":\"" + json_escape(result.error_message) + "\"";
+    }
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Close a caption session and free its KV sequence
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeCloseCaptionSession(
+    JNIEnv *env,
+    jobject thiz,
+    jint session
+) {
+    if (g_llama_wrapper) {
+        g_llama_wrapper->close_caption_session(session);
+    }
+}
+
+/**
+ * Replace the few-shot examples in the classification prompt (oldest first).
+ * Prompt heads are rebuilt in the background.
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeSetFewShotExamples(
+    JNIEnv *env,
+    jobject thiz,
+    jobjectArray contents,
+    jbooleanArray is_productive
+) {
+    if (!g_llama_wrapper || !contents || !is_productive) {
+        return;
+    }
+
+    jsize count = env->GetArrayLength(contents);
+    if (env->GetArrayLength(is_productive) != count) {
+        LOGE("Few-shot arrays differ in length");
+        return;
+    }
+
+    std::vector<uint8_t> productive(count);
+    env->GetBooleanArrayRegion(is_productive, 0, count, reinterpret_cast<jboolean*>(productive.data()));
+
+    std::vector<FewShotExample> examples;
+    examples.reserve(count);
+    for (jsize i = 0; i < count; i++) {
+        jstring element = static_cast<jstring>(env->GetObjectArrayElement(contents, i));
+        if (!element) continue;
+        const char* element_cstr = env->GetStringUTFChars(element, nullptr);
+        if (element_cstr) {
+            FewShotExample example;
+            example.content = element_cstr;
+            example.is_productive = productive[i] != 0;
+            examples.push_back(std::move(example));
+            env->ReleaseStringUTFChars(element, element_cstr);
+        }
+        env->DeleteLocalRef(element);
+    }
+
+    g_llama_wrapper->set_few_shot_examples(examples);
+}
+
+/**
+ * Start paging in the model's weights on an idle-priority thread, so the
+ * first classification after startup does not fault them in one by one.
+ * The path is resolved like a load, so a requantized variant is the file
+ * paged in.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativePrefetchModel(
+    JNIEnv *env,
+    jobject thiz,
+    jstring model_path
+) {
+    const char* path_cstr = env->GetStringUTFChars(model_path, nullptr);
+    if (!path_cstr) {
+        LOGE("Failed to get model path string");
+        return JNI_FALSE;
+    }
+
+    std::string resolved = model_quantizer::resolve(path_cstr);
+    env->ReleaseStringUTFChars(model_path, path_cstr);
+    bool started = ModelPrefetcher::instance().start(resolved);
+    return started ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Get weight prefetch progress as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeGetPrefetchProgress(JNIEnv *env, jobject thiz) {
+    static const char* kStateNames[] = {"idle", "running", "done", "cancelled", "failed"};
+    PrefetchProgress progress = ModelPrefetcher::instance().progress();
+
+    std::string json_result = "{";
+    json_result += "\"state\":\"" + std::string(kStateNames[static_cast<int>(progress.state)]) + "\"";
+    json_result += ",\"total_bytes\":" + std::to_string(progress.total_bytes);
+    json_result += ",\"requested_bytes\":" + std::to_string(progress.requested_bytes);
+    json_result += ",\"resident_bytes\":" + std::to_string(progress.resident_bytes);
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Requantize the model to the format that benchmarks fastest on this CPU
+ * and remember the choice for later loads. Blocks for the whole job;
+ * returns the measurements as JSON.
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeOptimizeModelFormat(
+    JNIEnv *env,
+    jobject thiz,
+    jstring model_path,
+    jint n_ctx,
+    jint n_threads
+) {
+    const char* path_cstr = env->GetStringUTFChars(model_path, nullptr);
+    if (!path_cstr) {
+        LOGE("Failed to get model path string");
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid model path\"}");
+    }
+
+    ModelConfig config;
+    config.model_path = std::string(path_cstr);
+    config.n_ctx = n_ctx;
+    config.n_threads = n_threads;
+    env->ReleaseStringUTFChars(model_path, path_cstr);
+
+    QuantizeResult result = model_quantizer::optimize(config);
+
+    std::string json_result = "{";
+    json_result += "\"success\":" + std::string(result.success ? "true" : "false");
+    json_result += ",\"selected\":\"" + result.selected_type + "\"";
+    json_result += ",\"variants\":[";
+    for (size_t i = 0; i < result.variants.size(); i++) {
+        const QuantVariant& variant = result.variants[i];
+        if (i > 0) json_result += ",";
+        json_result += "{\"type\":\"" + variant.type + "\"";
+        json_result += ",\"size_bytes\":" + std::to_string(variant.size_bytes);
+        json_result += ",\"measured\":" + std::string(variant.measured ? "true" : "false");
+        json_result += ",\"load_ms\":" + std::to_string(variant.timing.load_ms);
+        json_result += ",\"eval_ms\":" + std::to_string(variant.timing.eval_ms) + "}";
+    }
+    json_result += "]";
+    if (!result.error.empty()) {
+        json_result += ",\"error\":\"" + json_escape(result.error) + "\"";
+    }
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Path a load of model_path actually opens: the requantized variant selected
+ * for this CPU, or model_path itself
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeResolveModelPath(
+    JNIEnv *env,
+    jobject thiz,
+    jstring model_path
+) {
+    const char* path_cstr = env->GetStringUTFChars(model_path, nullptr);
+    if (!path_cstr) {
+        LOGE("Failed to get model path string");
+        return model_path;
+    }
+
+    std::string resolved = model_quantizer::resolve(path_cstr);
+    env->ReleaseStringUTFChars(model_path, path_cstr);
+    return env->NewStringUTF(resolved.c_str());
+}
+
+/**
+ * Delete requantized variants of a model and the format selection
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeDiscardModelVariants(
+    JNIEnv *env,
+    jobject thiz,
+    jstring model_path
+) {
+    const char* path_cstr = env->GetStringUTFChars(model_path, nullptr);
+    if (!path_cstr) {
+        return;
+    }
+    model_quantizer::discard(path_cstr);
+    env->ReleaseStringUTFChars(model_path, path_cstr);
+}
+
+/**
+ * Replace the native model registry with the given manifest text
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeLoadModelManifest(
+    JNIEnv *env,
+    jobject thiz,
+    jstring manifest
+) {
+    const char* manifest_cstr = env->GetStringUTFChars(manifest, nullptr);
+    if (!manifest_cstr) {
+        return JNI_FALSE;
+    }
+
+    std::string error;
+    bool loaded = ModelRegistry::instance().load_manifest(manifest_cstr, &error);
+    env->ReleaseStringUTFChars(manifest, manifest_cstr);
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Pick the largest downloaded model that meets the latency and memory
+ * budget. With benchmark the candidates are measured when no persisted
+ * choice is valid; without it only a persisted choice is returned.
+ * Returns the choice as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeSelectModel(
+    JNIEnv *env,
+    jobject thiz,
+    jstring models_dir,
+    jint p95_latency_ms,
+    jlong memory_budget_bytes,
+    jint n_ctx,
+    jint n_threads,
+    jboolean benchmark
+) {
+    const char* dir_cstr = env->GetStringUTFChars(models_dir, nullptr);
+    if (!dir_cstr) {
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid models directory\"}");
+    }
+    std::string dir(dir_cstr);
+    env->ReleaseStringUTFChars(models_dir, dir_cstr);
+
+    ModelConfig config;
+    config.n_ctx = n_ctx;
+    config.n_threads = n_threads;
+
+    SelectionBudget budget;
+    budget.p95_latency_ms = static_cast<uint32_t>(p95_latency_ms);
+    budget.memory_bytes = static_cast<uint64_t>(memory_budget_bytes);
+
+    ModelSelection selection;
+    std::string error;
+    if (!ModelRegistry::instance().select(dir, config, budget, benchmark == JNI_TRUE, &selection, &error)) {
+        return env->NewStringUTF(("{\"success\":false,\"error\":\"" + json_escape(error) + "\"}").c_str());
+    }
+
+    std::string json_result = "{";
+    json_result += "\"success\":true";
+    json_result += ",\"model\":\"" + json_escape(selection.model) + "\"";
+    json_result += ",\"variant\":\"" + json_escape(selection.variant) + "\"";
+    json_result += ",\"path\":\"" + json_escape(selection.path) + "\"";
+    json_result += ",\"meets_budget\":" + std::string(selection.meets_budget ? "true" : "false");
+    json_result += ",\"cached\":" + std::string(selection.from_cache ? "true" : "false");
+    json_result += ",\"p50_ms\":" + std::to_string(selection.latency.p50_ms);
+    json_result += ",\"p95_ms\":" + std::to_string(selection.latency.p95_ms);
+    json_result += ",\"memory_bytes\":" + std::to_string(selection.memory_bytes);
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Path of the downloaded escalation model listed in the manifest, or null
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_LlamaInference_nativeFindEscalationModel(
+    JNIEnv *env,
+    jobject thiz,
+    jstring models_dir
+) {
+    const char* dir_cstr = env->GetStringUTFChars(models_dir, nullptr);
+    if (!dir_cstr) {
+        return nullptr;
+    }
+    std::string dir(dir_cstr);
+    env->ReleaseStringUTFChars(models_dir, dir_cstr);
+
+    std::string path;
+    if (!ModelRegistry::instance().escalation_model(dir, &path)) {
+        return nullptr;
+    }
+    return env->NewStringUTF(path.c_str());
+}
+
+/**
+ * Hash canonicalized content (volatile counters/timestamps stripped per app)
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeHashContent(
+    JNIEnv *env,
+    jobject thiz,
+    jstring content,
+    jstring package_name
+) {
+    const char* content_cstr = env->GetStringUTFChars(content, nullptr);
+    if (!content_cstr) {
+        return 0;
+    }
+    const char* package_cstr = package_name ? env->GetStringUTFChars(package_name, nullptr) : nullptr;
+
+    uint64_t hash = ContentCanonicalizer::instance().canonical_hash(
+        content_cstr,
+        package_cstr ? package_cstr : ""
+    );
+
+    env->ReleaseStringUTFChars(content, content_cstr);
+    if (package_cstr) {
+        env->ReleaseStringUTFChars(package_name, package_cstr);
+    }
+    return static_cast<jlong>(hash);
+}
+
+/**
+ * Look up a cached verdict, returned as classification JSON (null on miss)
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeLookup(
+    JNIEnv *env,
+    jobject thiz,
+    jlong content_hash
+) {
+    CachedVerdict verdict;
+    if (!lookup_cached_verdict(static_cast<uint64_t>(content_hash), &verdict)) {
+        return nullptr;
+    }
+
+    std::string json_result = "{"
+        "\"success\":true,"
+        "\"is_productive\":" + std::string(verdict.is_productive ? "true" : "false") + ","
+        "\"confidence\":" + std::to_string(verdict.confidence) + ","
+        "\"reason\":\"" + json_escape(verdict.reason) + "\","
+        "\"processing_time_ms\":" + std::to_string(verdict.processing_time_ms) + ","
+        "\"cached\":true"
+        "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Store a verdict in the shared result cache
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeInsert(
+    JNIEnv *env,
+    jobject thiz,
+    jlong content_hash,
+    jboolean is_productive,
+    jfloat confidence,
+    jstring reason,
+    jint processing_time_ms
+) {
+    CachedVerdict verdict;
+    verdict.is_productive = is_productive == JNI_TRUE;
+    verdict.confidence = confidence;
+    verdict.processing_time_ms = processing_time_ms;
+
+    if (reason) {
+        const char* reason_cstr = env->GetStringUTFChars(reason, nullptr);
+        if (reason_cstr) {
+            verdict.reason = reason_cstr;
+            env->ReleaseStringUTFChars(reason, reason_cstr);
+        }
+    }
+
+    uint64_t key = static_cast<uint64_t>(content_hash);
+    ResultCache::instance().insert(key, verdict);
+    if (verdict.is_productive) {
+        RotatingBloomFilter::instance().insert(key);
+    } else if (RotatingBloomFilter::instance().might_contain(key)) {
+        // A Bloom filter cannot drop one key; forget them all rather than skip flipped content
+        LOGD("Verdict flipped to unproductive, clearing the known-productive filter");
+        RotatingBloomFilter::instance().clear();
+    }
+    PersistentCache::instance().insert(
+        key,
+        verdict.is_productive,
+        verdict.confidence,
+        current_time_ms()
+    );
+}
+
+/**
+ * Warm the result cache with stored verdicts in one call.
+ * Arrays are parallel; pass the newest verdicts first.
+ * @return Number of verdicts inserted
+ */
+JNIEXPORT jint JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativePreload(
+    JNIEnv *env,
+    jobject thiz,
+    jlongArray content_hashes,
+    jbooleanArray is_productive,
+    jfloatArray confidences
+) {
+    if (!content_hashes || !is_productive || !confidences) {
+        return 0;
+    }
+
+    jsize count = env->GetArrayLength(content_hashes);
+    if (env->GetArrayLength(is_productive) != count || env->GetArrayLength(confidences) != count) {
+        LOGE("Preload arrays differ in length");
+        return 0;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    std::vector<uint64_t> keys(count);
+    std::vector<uint8_t> productive(count);
+    std::vector<float> confidence_values(count);
+    env->GetLongArrayRegion(content_hashes, 0, count, reinterpret_cast<jlong*>(keys.data()));
+    env->GetBooleanArrayRegion(is_productive, 0, count, reinterpret_cast<jboolean*>(productive.data()));
+    env->GetFloatArrayRegion(confidences, 0, count, confidence_values.data());
+
+    size_t inserted = ResultCache::instance().preload(
+        keys.data(), productive.data(), confidence_values.data(), keys.size(), "stored_analysis");
+
+    for (jsize i = 0; i < count; i++) {
+        if (productive[i]) {
+            RotatingBloomFilter::instance().insert(keys[i]);
+        }
+    }
+
+    return static_cast<jint>(inserted);
+}
+
+/**
+ * Set the cache byte budget (evicts immediately if over budget)
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeSetByteBudget(
+    JNIEnv *env,
+    jobject thiz,
+    jlong byte_budget
+) {
+    if (byte_budget < 0) {
+        LOGE("Invalid cache byte budget: %lld", static_cast<long long>(byte_budget));
+        return;
+    }
+    ResultCache::instance().set_byte_budget(static_cast<size_t>(byte_budget));
+}
+
+/**
+ * Get cache statistics as JSON string
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeGetStats(JNIEnv *env, jobject thiz) {
+    CacheStats stats = ResultCache::instance().get_stats();
+
+    std::string json_result = "{"
+        "\"hits\":" + std::to_string(stats.hits) + ","
+        "\"misses\":" + std::to_string(stats.misses) + ","
+        "\"insertions\":" + std::to_string(stats.insertions) + ","
+        "\"evictions\":" + std::to_string(stats.evictions) + ","
+        "\"entries\":" + std::to_string(stats.entries) + ","
+        "\"bytes\":" + std::to_string(stats.bytes) + ","
+        "\"byte_budget\":" + std::to_string(stats.byte_budget) + ","
+        "\"persistent_open\":" + std::string(PersistentCache::instance().is_open() ? "true" : "false") + ","
+        "\"near_duplicate_entries\":" + std::to_string(SimHashIndex::instance().size()) + ","
+        "\"known_productive_filter_bytes\":" + std::to_string(RotatingBloomFilter::instance().memory_bytes()) +
+        "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Drop every cached verdict
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeClear(JNIEnv *env, jobject thiz) {
+    ResultCache::instance().clear();
+    SimHashIndex::instance().clear();
+    RotatingBloomFilter::instance().clear();
+}
+
+/**
+ * Check the known-productive filter; false means "not known", never "unproductive".
+ * Kept current without a cache lookup: nativeInsert clears it when a verdict
+ * flips to unproductive, and a model change clears it with the other tiers.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeIsKnownProductive(
+    JNIEnv *env,
+    jobject thiz,
+    jlong content_hash
+) {
+    return RotatingBloomFilter::instance().might_contain(static_cast<uint64_t>(content_hash)) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Open (or create) the persistent verdict cache file
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeOpenPersistent(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jstring model_version,
+    jstring lexicon_version
+) {
+    const char* path_cstr = env->GetStringUTFChars(path, nullptr);
+    const char* model_cstr = env->GetStringUTFChars(model_version, nullptr);
+    const char* lexicon_cstr = env->GetStringUTFChars(lexicon_version, nullptr);
+
+    bool success = false;
+    if (path_cstr && model_cstr && lexicon_cstr) {
+        success = PersistentCache::instance().open(path_cstr, model_cstr, lexicon_cstr);
+    } else {
+        LOGE("Failed to get persistent cache arguments");
+    }
+
+    if (path_cstr) env->ReleaseStringUTFChars(path, path_cstr);
+    if (model_cstr) env->ReleaseStringUTFChars(model_version, model_cstr);
+    if (lexicon_cstr) env->ReleaseStringUTFChars(lexicon_version, lexicon_cstr);
+
+    return success ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Invalidate persisted verdicts and drop the in-memory ones when the model or
+ * lexicon changes
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeInvalidatePersistent(
+    JNIEnv *env,
+    jobject thiz,
+    jstring model_version,
+    jstring lexicon_version
+) {
+    const char* model_cstr = env->GetStringUTFChars(model_version, nullptr);
+    const char* lexicon_cstr = env->GetStringUTFChars(lexicon_version, nullptr);
+
+    if (model_cstr && lexicon_cstr) {
+        PersistentCache::instance().invalidate(model_cstr, lexicon_cstr);
+    }
+
+    // Verdicts in memory came from the previous model as well, whether or not the persistent cache is open
+    ResultCache::instance().clear();
+    SimHashIndex::instance().clear();
+    RotatingBloomFilter::instance().clear();
+
+    if (model_cstr) env->ReleaseStringUTFChars(model_version, model_cstr);
+    if (lexicon_cstr) env->ReleaseStringUTFChars(lexicon_version, lexicon_cstr);
+}
+
+/**
+ * Write dirty persistent cache pages back to storage
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeFlushPersistent(JNIEnv *env, jobject thiz) {
+    PersistentCache::instance().flush(true);
+}
+
+/**
+ * Override the canonicalizer's volatile-token rules for one app package
+ * (empty package name replaces the default rules)
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeSetCanonicalizerRules(
+    JNIEnv *env,
+    jobject thiz,
+    jstring package_name,
+    jobjectArray count_nouns,
+    jobjectArray trailing_phrases,
+    jboolean strip_relative_times,
+    jboolean strip_bare_counts
+) {
+    auto to_vector = [env](jobjectArray array) {
+        std::vector<std::string> values;
+        jsize length = array ? env->GetArrayLength(array) : 0;
+        for (jsize i = 0; i < length; i++) {
+            jstring element = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+            if (!element) continue;
+            const char* element_cstr = env->GetStringUTFChars(element, nullptr);
+            if (element_cstr) {
+                values.emplace_back(element_cstr);
+                env->ReleaseStringUTFChars(element, element_cstr);
+            }
+            env->DeleteLocalRef(element);
+        }
+        return values;
+    };
+
+    const char* package_cstr = env->GetStringUTFChars(package_name, nullptr);
+    if (!package_cstr) {
+        LOGE("Failed to get package name string");
+        return;
+    }
+
+    CanonicalizerRules rules;
+    rules.count_nouns = to_vector(count_nouns);
+    rules.trailing_phrases = to_vector(trailing_phrases);
+    rules.strip_relative_times = strip_relative_times == JNI_TRUE;
+    rules.strip_bare_counts = strip_bare_counts == JNI_TRUE;
+
+    ContentCanonicalizer::instance().set_rules(package_cstr, rules);
+
+    env->ReleaseStringUTFChars(package_name, package_cstr);
+}
+
+/**
+ * SimHash fingerprint of canonicalized content (0 if too short to fingerprint)
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeSimHash(
+    JNIEnv *env,
+    jobject thiz,
+    jstring content,
+    jstring package_name
+) {
+    const char* content_cstr = env->GetStringUTFChars(content, nullptr);
+    if (!content_cstr) {
+        return 0;
+    }
+    const char* package_cstr = package_name ? env->GetStringUTFChars(package_name, nullptr) : nullptr;
+
+    std::string canonical = ContentCanonicalizer::instance().canonicalize(
+        content_cstr,
+        package_cstr ? package_cstr : ""
+    );
+
+    env->ReleaseStringUTFChars(content, content_cstr);
+    if (package_cstr) {
+        env->ReleaseStringUTFChars(package_name, package_cstr);
+    }
+
+    uint64_t fingerprint = 0;
+    if (!simhash::compute(canonical, &fingerprint)) {
+        return 0;
+    }
+    return static_cast<jlong>(fingerprint);
+}
+
+/**
+ * Find the verdict of a near-duplicate of canonicalized content. The allowed
+ * Hamming distance shrinks with the text's length, so short posts only match
+ * very close copies.
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeFindNearDuplicate(
+    JNIEnv *env,
+    jobject thiz,
+    jstring content,
+    jstring package_name
+) {
+    const char* content_cstr = env->GetStringUTFChars(content, nullptr);
+    if (!content_cstr) {
+        return nullptr;
+    }
+    const char* package_cstr = package_name ? env->GetStringUTFChars(package_name, nullptr) : nullptr;
+
+    std::string canonical = ContentCanonicalizer::instance().canonicalize(
+        content_cstr,
+        package_cstr ? package_cstr : ""
+    );
+
+    env->ReleaseStringUTFChars(content, content_cstr);
+    if (package_cstr) {
+        env->ReleaseStringUTFChars(package_name, package_cstr);
+    }
+
+    uint64_t fingerprint = 0;
+    size_t word_count = 0;
+    NearDuplicateMatch match;
+    if (!simhash::compute(canonical, &fingerprint, &word_count) ||
+        !SimHashIndex::instance().find(fingerprint, &match, simhash::max_distance_for(word_count))) {
+        return nullptr;
+    }
+
+    std::string json_result = "{"
+        "\"success\":true,"
+        "\"is_productive\":" + std::string(match.is_productive ? "true" : "false") + ","
+        "\"confidence\":" + std::to_string(match.confidence) + ","
+        "\"reason\":\"near_duplicate\","
+        "\"processing_time_ms\":0,"
+        "\"distance\":" + std::to_string(match.distance) +
+        "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Index a verdict by SimHash fingerprint for near-duplicate reuse
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeInsertNearDuplicate(
+    JNIEnv *env,
+    jobject thiz,
+    jlong fingerprint,
+    jboolean is_productive,
+    jfloat confidence
+) {
+    SimHashIndex::instance().insert(
+        static_cast<uint64_t>(fingerprint),
+        is_productive == JNI_TRUE,
+        confidence
+    );
+}
+
+/**
+ * Replace the near-duplicate verdicts a user correction contradicts: entries
+ * close enough to content to be served for it are dropped and the corrected
+ * verdict is indexed under its fingerprint
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeResultCache_nativeCorrectNearDuplicate(
+    JNIEnv *env,
+    jobject thiz,
+    jstring content,
+    jstring package_name,
+    jboolean is_productive,
+    jfloat confidence
+) {
+    const char* content_cstr = env->GetStringUTFChars(content, nullptr);
+    if (!content_cstr) {
+        return;
+    }
+    const char* package_cstr = package_name ? env->GetStringUTFChars(package_name, nullptr) : nullptr;
+
+    std::string canonical = ContentCanonicalizer::instance().canonicalize(
+        content_cstr,
+        package_cstr ? package_cstr : ""
+    );
+
+    env->ReleaseStringUTFChars(content, content_cstr);
+    if (package_cstr) {
+        env->ReleaseStringUTFChars(package_name, package_cstr);
+    }
+
+    uint64_t fingerprint = 0;
+    size_t word_count = 0;
+    if (!simhash::compute(canonical, &fingerprint, &word_count)) {
+        return;
+    }
+    SimHashIndex& index = SimHashIndex::instance();
+    index.erase_near(fingerprint, simhash::max_distance_for(word_count));
+    index.insert(fingerprint, is_productive == JNI_TRUE, confidence);
+}
+
+/**
+ * Diff one window snapshot against the previous one and return the indices
+ * of texts that are new or changed
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_scrollguard_app_service_SnapshotDiffer_nativeDiffSnapshot(
+    JNIEnv *env,
+    jobject thiz,
+    jstring window_key,
+    jobjectArray texts,
+    jstring package_name
+) {
+    const char* window_cstr = env->GetStringUTFChars(window_key, nullptr);
+    const char* package_cstr = env->GetStringUTFChars(package_name, nullptr);
+    if (!window_cstr || !package_cstr) {
+        LOGE("Failed to get snapshot arguments");
+        if (window_cstr) env->ReleaseStringUTFChars(window_key, window_cstr);
+        if (package_cstr) env->ReleaseStringUTFChars(package_name, package_cstr);
+        return env->NewIntArray(0);
+    }
+
+    std::string package_str(package_cstr);
+    jsize count = texts ? env->GetArrayLength(texts) : 0;
+
+    // Canonical hashes, so re-renders ("2m ago" -> "3m ago") do not count as changes
+    std::vector<uint64_t> hashes;
+    hashes.reserve(count);
+    for (jsize i = 0; i < count; i++) {
+        jstring text = static_cast<jstring>(env->GetObjectArrayElement(texts, i));
+        uint64_t hash = 0;
+        if (text) {
+            const char* text_cstr = env->GetStringUTFChars(text, nullptr);
+            if (text_cstr) {
+                hash = ContentCanonicalizer::instance().canonical_hash(text_cstr, package_str);
+                env->ReleaseStringUTFChars(text, text_cstr);
+            }
+            env->DeleteLocalRef(text);
+        }
+        hashes.push_back(hash);
+    }
+
+    std::vector<int> changed = SnapshotDiffer::instance().diff(window_cstr, hashes);
+
+    env->ReleaseStringUTFChars(window_key, window_cstr);
+    env->ReleaseStringUTFChars(package_name, package_cstr);
+
+    jintArray result = env->NewIntArray(static_cast<jsize>(changed.size()));
+    if (result && !changed.empty()) {
+        env->SetIntArrayRegion(result, 0, static_cast<jsize>(changed.size()), changed.data());
+    }
+    return result;
+}
+
+/**
+ * Forget a window's previous snapshot ("" forgets all windows)
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_SnapshotDiffer_nativeReset(
+    JNIEnv *env,
+    jobject thiz,
+    jstring window_key
+) {
+    const char* window_cstr = env->GetStringUTFChars(window_key, nullptr);
+    if (!window_cstr) {
+        return;
+    }
+
+    SnapshotDiffer::instance().reset(window_cstr);
+
+    env->ReleaseStringUTFChars(window_key, window_cstr);
+}
+
+/**
+ * Create an incremental SHA-256 hasher
+ * @return Opaque handle, released with nativeDestroy
+ */
+JNIEXPORT jlong JNICALL
+Java_com_scrollguard_app_service_llm_ModelVerifier_nativeCreate(JNIEnv *env, jobject thiz) {
+    return reinterpret_cast<jlong>(new Sha256());
+}
+
+/**
+ * Feed bytes to a hasher (e.g. each buffer as a download is written)
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_ModelVerifier_nativeUpdate(
+    JNIEnv *env,
+    jobject thiz,
+    jlong handle,
+    jbyteArray buffer,
+    jint offset,
+    jint length
+) {
+    Sha256* hasher = reinterpret_cast<Sha256*>(handle);
+    if (!hasher || !buffer || offset < 0 || length <= 0 || offset + length > env->GetArrayLength(buffer)) {
+        return;
+    }
+
+    void* bytes = env->GetPrimitiveArrayCritical(buffer, nullptr);
+    if (!bytes) {
+        LOGE("Failed to access hash buffer");
+        return;
+    }
+    hasher->update(static_cast<const uint8_t*>(bytes) + offset, static_cast<size_t>(length));
+    env->ReleasePrimitiveArrayCritical(buffer, bytes, JNI_ABORT);
+}
+
+/**
+ * Finish a hasher and return the hex digest; the handle must still be destroyed
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_ModelVerifier_nativeFinish(JNIEnv *env, jobject thiz, jlong handle) {
+    Sha256* hasher = reinterpret_cast<Sha256*>(handle);
+    if (!hasher) {
+        return nullptr;
+    }
+    return env->NewStringUTF(hasher->finish_hex().c_str());
+}
+
+/**
+ * Release a hasher
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_ModelVerifier_nativeDestroy(JNIEnv *env, jobject thiz, jlong handle) {
+    delete reinterpret_cast<Sha256*>(handle);
+}
+
+/**
+ * Hash a whole file with progress reporting
+ * @return Hex digest, or null on I/O error or when the listener cancels
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_ModelVerifier_nativeHashFile(
+    JNIEnv *env,
+    jobject thiz,
+    jstring path,
+    jobject listener
+) {
+    const char* path_cstr = env->GetStringUTFChars(path, nullptr);
+    if (!path_cstr) {
+        LOGE("Failed to get file path string");
+        return nullptr;
+    }
+    std::string path_str(path_cstr);
+    env->ReleaseStringUTFChars(path, path_cstr);
+
+    sha256::ProgressCallback progress = nullptr;
+    if (listener) {
+        // Progress is reported on the calling thread, so env stays valid
+        jmethodID on_progress = env->GetMethodID(env->GetObjectClass(listener), "onProgress", "(JJ)Z");
+        if (!on_progress) {
+            LOGE("Progress listener has no onProgress(long, long) method");
+            return nullptr;
+        }
+        progress = [env, listener, on_progress](uint64_t done, uint64_t total) {
+            return env->CallBooleanMethod(listener, on_progress,
+                static_cast<jlong>(done), static_cast<jlong>(total)) == JNI_TRUE;
+        };
+    }
+
+    std::string digest;
+    if (!sha256::hash_file(path_str, &digest, progress)) {
+        return nullptr;
+    }
+    return env->NewStringUTF(digest.c_str());
+}
+
+/**
+ * Name of the SHA-256 implementation selected for this CPU
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_ModelVerifier_nativeBackend(JNIEnv *env, jobject thiz) {
+    return env->NewStringUTF(Sha256::backend_name());
+}
+
+/**
+ * Download a model with concurrent range requests, resuming any partial
+ * download of the same URL, verifying the digest and renaming into place
+ * @return JSON result
+ */
+JNIEXPORT jstring JNICALL
+Java_com_scrollguard_app_service_llm_NativeModelDownloader_nativeDownload(
+    JNIEnv *env,
+    jobject thiz,
+    jstring url,
+    jstring target_path,
+    jstring expected_sha256,
+    jint connections,
+    jobject source,
+    jobject listener
+) {
+    const char* url_cstr = env->GetStringUTFChars(url, nullptr);
+    const char* target_cstr = env->GetStringUTFChars(target_path, nullptr);
+    const char* sha_cstr = expected_sha256 ? env->GetStringUTFChars(expected_sha256, nullptr) : nullptr;
+    if (!url_cstr || !target_cstr) {
+        LOGE("Failed to get download strings");
+        env->ExceptionClear();
+        if (url_cstr) env->ReleaseStringUTFChars(url, url_cstr);
+        if (target_cstr) env->ReleaseStringUTFChars(target_path, target_cstr);
+        if (sha_cstr) env->ReleaseStringUTFChars(expected_sha256, sha_cstr);
+        return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid arguments\"}");
+    }
+
+    DownloadOptions options;
+    options.url = url_cstr;
+    options.target_path = target_cstr;
+    options.expected_sha256 = sha_cstr ? sha_cstr : "";
+    options.connections = connections > 0 ? connections : options.connections;
+
+    env->ReleaseStringUTFChars(url, url_cstr);
+    env->ReleaseStringUTFChars(target_path, target_cstr);
+    if (sha_cstr) env->ReleaseStringUTFChars(expected_sha256, sha_cstr);
+
+    std::shared_ptr<RangeFetcher> fetcher;
+    if (source) {
+        auto java_fetcher = std::make_shared<JavaRangeFetcher>(env, source);
+        if (!java_fetcher->is_valid()) {
+            LOGE("Range source is missing contentLength/fetchRange");
+            return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid range source\"}");
+        }
+        fetcher = java_fetcher;
+    } else {
+        fetcher = std::make_shared<HttpRangeFetcher>();
+    }
+
+    ModelDownloader::ProgressCallback progress = nullptr;
+    JavaVM* vm = nullptr;
+    jobject listener_ref = nullptr;
+    jmethodID on_progress = nullptr;
+    if (listener) {
+        jclass listener_class = env->GetObjectClass(listener);
+        on_progress = env->GetMethodID(listener_class, "onProgress", "(JJ)Z");
+        env->DeleteLocalRef(listener_class);
+        if (!on_progress) {
+            env->ExceptionClear();
+            LOGE("Progress listener has no onProgress(long, long) method");
+            return env->NewStringUTF("{\"success\":false,\"error\":\"Invalid progress listener\"}");
+        }
+        // Progress arrives on whichever worker completed a chunk
+        env->GetJavaVM(&vm);
+        listener_ref = env->NewGlobalRef(listener);
+        progress = [vm, listener_ref, on_progress](uint64_t done, uint64_t total) {
+            ScopedJniEnv scoped(vm);
+            JNIEnv* worker_env = scoped.get();
+            if (!worker_env) return true;
+            jboolean keep_going = worker_env->CallBooleanMethod(listener_ref, on_progress,
+                static_cast<jlong>(done), static_cast<jlong>(total));
+            if (worker_env->ExceptionCheck()) {
+                worker_env->ExceptionClear();
+                return false;
+            }
+            return keep_going == JNI_TRUE;
+        };
+    }
+
+    DownloadResult result = ModelDownloader(fetcher).download(options, progress);
+    if (listener_ref) {
+        env->DeleteGlobalRef(listener_ref);
+    }
+
+    std::string json_result = "{";
+    json_result += "\"success\":" + std::string(result.success ? "true" : "false");
+    json_result += ",\"cancelled\":" + std::string(result.cancelled ? "true" : "false");
+    json_result += ",\"resumed\":" + std::string(result.resumed ? "true" : "false");
+    json_result += ",\"total_bytes\":" + std::to_string(result.total_bytes);
+    json_result += ",\"fetched_bytes\":" + std::to_string(result.fetched_bytes);
+    json_result += ",\"sha256\":\"" + result.sha256 + "\"";
+    if (!result.error.empty()) {
+        json_result += ",\"error\":\"" + json_escape(result.error) + "\"";
+    }
+    json_result += "}";
+
+    return env->NewStringUTF(json_result.c_str());
+}
+
+/**
+ * Delete the partial file and chunk sidecar of an unfinished download
+ */
+JNIEXPORT void JNICALL
+Java_com_scrollguard_app_service_llm_NativeModelDownloader_nativeDiscardPartial(
+    JNIEnv *env,
+    jobject thiz,
+    jstring target_path
+) {
+    const char* target_cstr = env->GetStringUTFChars(target_path, nullptr);
+    if (!target_cstr) {
+        return;
+    }
+    ModelDownloader::discard_partial(target_cstr);
+    env->ReleaseStringUTFChars(target_path, target_cstr);
+}
+
+} // extern "C"
@@ -90,6 +90,35 @@ interface ContentDao {
     @Query("SELECT * FROM content_analysis WHERE timestamp > :since ORDER BY timestamp DESC")
     fun getRecentContentAnalyses(since: Long = System.currentTimeMillis() - 24 * 60 * 60 * 1000): Flow<List<ContentAnalysis>>
 
+    /**
+     * Get recent verdicts of one model for warming the classification cache (newest first).
+     * Overridden rows are skipped so the user's correction is not replaced by the stored verdict,
+     * heuristic rows so keyword guesses are not served as model verdicts, and verdicts
+     * borrowed from a near-duplicate so they are never cached as exact matches.
+     */
+    @Query("""
+        SELECT contentHash, isProductive, confidence
+        FROM content_analysis
+        WHERE timestamp > :since AND userOverride = 0 AND isHeuristic = 0
+            AND reason != 'near_duplicate'
+            AND modelVersion = :modelVersion AND contentHash != ''
+        ORDER BY timestamp DESC
+        LIMIT :limit
+    """)
+    suspend fun getRecentVerdicts(since: Long, modelVersion: String, limit: Int): List<StoredVerdict>
+
+    /**
+     * Get the most recent posts whose verdict the user corrected (newest first)
+     */
+    @Query("""
+        SELECT content, isProductive, userFeedback
+        FROM content_analysis
+        WHERE (userFeedback LIKE 'INCORRECT_FILTER|%' OR userFeedback LIKE 'SHOULD_FILTER|%') AND content != ''
+        ORDER BY timestamp DESC
+        LIMIT :limit
+    """)
+    fun getRecentCorrections(limit: Int): Flow<List<FeedbackCorrection>>
+
     /**
      * Count total content analyses
      */
@@ -192,6 +221,13 @@ interface ContentDao {
     @Query("UPDATE content_analysis SET userFeedback = :feedback WHERE id = :id")
     suspend fun updateUserFeedback(id: Long, feedback: String?)
 
+    /**
+     * Record a correction of the verdict: the feedback, the post text it was given
+     * on, and an override so the stored verdict is not served again
+     */
+    @Query("UPDATE content_analysis SET userFeedback = :feedback, content = :content, userOverride = 1 WHERE id = :id")
+    suspend fun recordCorrection(id: Long, feedback: String, content: String)
+
     /**
      * Update user override status
      */
@@ -226,6 +262,31 @@ data class DailyContentStats(
     val avgConfidence: Float
 )
 
+/**
+ * Data class for a stored verdict used to warm the classification cache
+ */
+data class StoredVerdict(
+    val contentHash: String,
+    val isProductive: Boolean,
+    val confidence: Float
+)
+
+/**
+ * Data class for a post the user corrected, used as a few-shot example
+ */
+data class FeedbackCorrection(
+    val content: String,
+    val isProductive: Boolean,
+    val userFeedback: String
+) {
+    /**
+     * Verdict the user says is right: a wrong filter flips the stored one,
+     * a missed post should have been filtered
+     */
+    val correctedIsProductive: Boolean
+        get() = if (userFeedback.startsWith("SHOULD_FILTER|")) false else !isProductive
+}
+
 /**
  * Data class for content type distribution
  */
@@ -28,7 +28,7 @@ import com.scrollguard.app.data.model.UserPreferences
         FilterSession::class,
         DailySummary::class
     ],
-    version = 1,
+    version = 2,
     exportSchema = true
 )
 @TypeConverters(
@@ -64,12 +64,11 @@ abstract class ScrollGuardDatabase : RoomDatabase() {
         }
 
         /**
-         * Migration from version 1 to 2 (example for future use)
+         * Migration from version 1 to 2: flag verdicts from the keyword fallback
          */
         private val MIGRATION_1_2 = object : Migration(1, 2) {
             override fun migrate(database: SupportSQLiteDatabase) {
-                // Example migration - add new column
-                // database.execSQL("ALTER TABLE content_analysis ADD COLUMN new_field TEXT")
+                database.execSQL("ALTER TABLE content_analysis ADD COLUMN isHeuristic INTEGER NOT NULL DEFAULT 0")
             }
         }
 
@@ -18,7 +18,7 @@ data class ContentAnalysis(
     val id: Long = 0,
     
     val contentHash: String = "",
-    val content: String = "", // Encrypted or hashed for privacy
+    val content: String = "", // Post text, only stored with a correction (used as a few-shot example)
     val contentType: ContentType,
     val packageName: String = "",
     
@@ -30,7 +30,8 @@ data class ContentAnalysis(
     
     // Metadata
     val timestamp: Long,
-    val modelVersion: String = "1.0",
+    val modelVersion: String = "1.0", // Model that produced the verdict (its verdict cache epoch)
+    val isHeuristic: Boolean = false, // Keyword fallback, not the model
     
     // User feedback
     val userFeedback: UserFeedback? = null,
@@ -1,7 +1,9 @@
 package com.scrollguard.app.data.repository
 
 import com.scrollguard.app.data.dao.ContentDao
+import com.scrollguard.app.data.dao.FeedbackCorrection
 import com.scrollguard.app.data.dao.SessionDao
+import com.scrollguard.app.data.dao.StoredVerdict
 import com.scrollguard.app.data.model.ContentAnalysis
 import com.scrollguard.app.data.model.ContentType
 import com.scrollguard.app.data.model.FilterSession
@@ -45,6 +47,18 @@ class ContentRepository(
         }
     }
 
+    /**
+     * Get recent stored verdicts of a model, newest first, for warming the classification cache
+     */
+    suspend fun getRecentVerdicts(since: Long, modelVersion: String, limit: Int): List<StoredVerdict> = withContext(Dispatchers.IO) {
+        try {
+            contentDao.getRecentVerdicts(since, modelVersion, limit)
+        } catch (e: Exception) {
+            Timber.e(e, "Error getting recent verdicts")
+            emptyList()
+        }
+    }
+
     /**
      * Get content analyses for a specific app
      */
@@ -66,6 +80,13 @@ class ContentRepository(
         return contentDao.getContentAnalysesWithFeedback()
     }
 
+    /**
+     * Get the most recent posts the user corrected, newest first
+     */
+    fun getRecentCorrections(limit: Int): Flow<List<FeedbackCorrection>> {
+        return contentDao.getRecentCorrections(limit)
+    }
+
     /**
      * Update user feedback for content analysis
      */
@@ -78,6 +99,19 @@ class ContentRepository(
         }
     }
 
+    /**
+     * Record that the user corrected a verdict, keeping the post text so it can be
+     * shown to the model as a few-shot example
+     */
+    suspend fun recordCorrection(analysisId: Long, feedback: UserFeedback, content: String) = withContext(Dispatchers.IO) {
+        try {
+            val feedbackString = "${feedback.feedbackType.name}|${feedback.timestamp}|${feedback.comment ?: ""}"
+            contentDao.recordCorrection(analysisId, feedbackString, content)
+        } catch (e: Exception) {
+            Timber.e(e, "Error recording correction")
+        }
+    }
+
     /**
      * Mark content as overridden by user
      */
@@ -11,6 +11,7 @@ import android.view.View
 import android.view.WindowManager
 import android.view.accessibility.AccessibilityEvent
 import android.view.accessibility.AccessibilityNodeInfo
+import android.widget.Button
 import android.widget.Toast
 import androidx.core.content.ContextCompat
 import androidx.lifecycle.lifecycleScope
@@ -18,11 +19,19 @@ import com.scrollguard.app.R
 import com.scrollguard.app.ScrollGuardApplication
 import com.scrollguard.app.data.model.ContentAnalysis
 import com.scrollguard.app.data.model.ContentType
+import com.scrollguard.app.data.model.FeedbackType
+import com.scrollguard.app.data.model.UserFeedback
 import com.scrollguard.app.service.analytics.AnalyticsManager
 import com.scrollguard.app.service.llm.LlamaInferenceManager
+import com.scrollguard.app.service.llm.NativeResultCache
 import com.scrollguard.app.util.AccessibilityNodeHelper
 import com.scrollguard.app.util.SocialMediaDetector
 import kotlinx.coroutines.*
+import kotlinx.coroutines.flow.catch
+import kotlinx.coroutines.flow.distinctUntilChanged
+import kotlinx.coroutines.flow.map
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
 import timber.log.Timber
 import java.util.concurrent.ConcurrentHashMap
 
@@ -36,6 +45,10 @@ class ContentFilterService : AccessibilityService() {
         private const val CONTENT_PROCESSING_DELAY_MS = 100L
         private const val MAX_CONCURRENT_ANALYSES = 3
         private const val OVERLAY_FADE_DURATION_MS = 300L
+        private const val CACHE_PRELOAD_WINDOW_MS = 7L * 24 * 60 * 60 * 1000 // 7 days
+        private const val CACHE_PRELOAD_LIMIT = 5000
+        private const val FEW_SHOT_EXAMPLES = 4
+        private const val OVERLAY_TIMEOUT_MS = 30_000L
         
         // Supported social media packages
         private val SUPPORTED_PACKAGES = setOf(
@@ -58,15 +71,31 @@ class ContentFilterService : AccessibilityService() {
     private val processingScope = CoroutineScope(SupervisorJob() + Dispatchers.Default)
     
     private val handler = Handler(Looper.getMainLooper())
-    private val contentCache = ConcurrentHashMap<String, ContentAnalysis>()
     private val activeOverlays = ConcurrentHashMap<AccessibilityNodeInfo, OverlayInfo>()
     
     private data class OverlayInfo(
         val overlay: View,
         val layoutParams: WindowManager.LayoutParams,
-        val contentBounds: android.graphics.Rect
+        val contentBounds: android.graphics.Rect,
+        val windowKey: String
     )
     
+    /**
+     * Caption text of a video post as last seen, and the caption session its
+     * growth is classified in (see [routeCaptionUpdate])
+     */
+    private class CaptionTrack(var text: String) {
+        @Volatile var session: Int? = null
+        val updateMutex = Mutex()
+    }
+    
+    // Main thread only; cleared when the active window changes
+    private val captionTracks = HashMap<AccessibilityNodeInfo, CaptionTrack>()
+    private var captionWindowKey: String? = null
+    
+    private var pendingContentChange: Runnable? = null
+    private var snapshotModelLoaded = false
+    
     private var isServiceEnabled = false
     private var processingQueue = mutableListOf<ContentProcessingTask>()
     private var activeAnalyses = 0
@@ -80,6 +109,9 @@ class ContentFilterService : AccessibilityService() {
         llamaInferenceManager = app.llamaInferenceManager
         windowManager = getSystemService(WINDOW_SERVICE) as WindowManager
         
+        // Page the model in while the service starts up, ahead of the first classification
+        llamaInferenceManager.prefetchModelWeights()
+        
         // Start foreground service for background processing
         startForegroundService()
         
@@ -94,9 +126,12 @@ class ContentFilterService : AccessibilityService() {
         
         isServiceEnabled = true
         
-        // Initialize LLM inference
+        // Initialize LLM inference, then warm the result cache from stored analyses
+        // and keep the user's corrections in the prompt as few-shot examples
         serviceScope.launch {
             initializeLLM()
+            preloadResultCache()
+            syncFeedbackExamples()
         }
         
         // Show connection confirmation
@@ -158,16 +193,20 @@ class ContentFilterService : AccessibilityService() {
             updateOverlayPositions()
         }
         
-        // Debounce rapid content changes
-        handler.removeCallbacksAndMessages(null)
-        handler.postDelayed({
-            processContentChange(event)
-        }, CONTENT_PROCESSING_DELAY_MS)
+        // Debounce rapid content changes; only the pending change is cancelled so
+        // overlay timeouts posted on the same handler still fire
+        pendingContentChange?.let { handler.removeCallbacks(it) }
+        val runnable = Runnable { processContentChange(event) }
+        pendingContentChange = runnable
+        handler.postDelayed(runnable, CONTENT_PROCESSING_DELAY_MS)
     }
 
     private fun handleWindowStateChanged(event: AccessibilityEvent) {
         Timber.d("Window state changed: ${event.packageName}")
         
+        // Videos of the previous window are gone along with their captions
+        closeCaptionSessions()
+        
         // Clear overlays when switching apps
         if (event.packageName?.toString() !in SUPPORTED_PACKAGES) {
             clearAllOverlays()
@@ -205,13 +244,35 @@ class ContentFilterService : AccessibilityService() {
                 }
             }
             
-            Timber.d("ScrollGuard: Found ${contentNodes.size} content nodes to analyze")
+            // Verdicts for content already on screen came from the other classifier
+            // (heuristic vs model), so everything visible is classified again
+            val modelLoaded = llamaInferenceManager.isModelLoaded()
+            if (modelLoaded != snapshotModelLoaded) {
+                snapshotModelLoaded = modelLoaded
+                SnapshotDiffer.resetAll()
+            }
             
-            // Process each content node
-            contentNodes.forEach { node ->
-                queueContentForAnalysis(node, packageName)
+            val windowKey = windowKey(packageName, rootNode.windowId)
+            if (windowKey != captionWindowKey) {
+                closeCaptionSessions()
+                captionWindowKey = windowKey
             }
             
+            // Only queue texts that were not already on screen in this window's last snapshot
+            val texts = contentNodes.map { it.text?.toString() ?: "" }
+            val changedIndices = SnapshotDiffer.diff(windowKey, texts, packageName)
+            
+            Timber.d("ScrollGuard: Found ${contentNodes.size} content nodes, ${changedIndices.size} new or changed")
+            
+            // Process each new or changed content node; a growing video caption
+            // extends its session instead of being classified from scratch
+            changedIndices.forEach { index ->
+                if (!routeCaptionUpdate(contentNodes[index], packageName)) {
+                    queueContentForAnalysis(contentNodes[index], packageName)
+                }
+            }
+            pruneCaptionTracks(contentNodes.toSet())
+            
         } catch (e: Exception) {
             Timber.e(e, "Error processing content change")
             analyticsManager.logEvent("content_processing_error") {
@@ -299,14 +360,93 @@ class ContentFilterService : AccessibilityService() {
         return contentNodes
     }
 
+    /**
+     * Track caption text on video platforms and send a caption that grew since it
+     * was last seen to the video's caption session, so only the added words are
+     * prefilled. Text seen for the first time, or replaced rather than extended,
+     * returns false and is classified as new content.
+     */
+    private fun routeCaptionUpdate(node: AccessibilityNodeInfo, packageName: String): Boolean {
+        if (!SocialMediaDetector.isVideoPlatform(packageName)) return false
+        val text = node.text?.toString() ?: return false
+        
+        val track = captionTracks[node]
+        if (track == null) {
+            captionTracks[node] = CaptionTrack(text)
+            return false
+        }
+        val grew = text.length > track.text.length && text.startsWith(track.text)
+        track.text = text
+        if (!grew) {
+            track.session?.let { llamaInferenceManager.closeCaptionSession(it) }
+            track.session = null
+            return false
+        }
+        
+        val session = track.session
+            ?: llamaInferenceManager.openCaptionSession(packageName)?.also { track.session = it }
+            ?: return false
+        
+        processingScope.launch {
+            try {
+                // Updates of one video run in order; a session closed meanwhile is skipped
+                val update = track.updateMutex.withLock {
+                    if (track.session != session) return@launch
+                    llamaInferenceManager.updateCaptionSession(session, text)
+                }
+                Timber.d("Caption update: ${update.decodedTokens} tokens decoded, stable=${update.isStable}")
+                
+                val result = update.classification
+                if (!result.isProductive) {
+                    withContext(Dispatchers.Main) {
+                        if (!activeOverlays.containsKey(node)) {
+                            val contentHash = llamaInferenceManager.contentHash(text, packageName)
+                            applyContentFilter(node, createAnalysis(text, packageName, contentHash, result), contentHash)
+                        }
+                    }
+                }
+            } catch (e: Exception) {
+                Timber.e(e, "Error updating caption session")
+            }
+        }
+        return true
+    }
+    
+    // Close the sessions of videos no longer on screen
+    private fun pruneCaptionTracks(onScreen: Set<AccessibilityNodeInfo>) {
+        val iterator = captionTracks.entries.iterator()
+        while (iterator.hasNext()) {
+            val (node, track) = iterator.next()
+            if (node !in onScreen) {
+                track.session?.let { llamaInferenceManager.closeCaptionSession(it) }
+                track.session = null
+                iterator.remove()
+            }
+        }
+    }
+    
+    private fun closeCaptionSessions() {
+        captionTracks.values.forEach { track ->
+            track.session?.let { llamaInferenceManager.closeCaptionSession(it) }
+            track.session = null
+        }
+        captionTracks.clear()
+        captionWindowKey = null
+    }
+
     private fun queueContentForAnalysis(node: AccessibilityNodeInfo, packageName: String) {
         val text = node.text?.toString() ?: return
-        val contentHash = text.hashCode().toString()
+        val contentHash = llamaInferenceManager.contentHash(text, packageName)
         
-        // Check cache first
-        contentCache[contentHash]?.let { cachedAnalysis ->
-            if (!cachedAnalysis.isProductive) {
-                applyContentFilter(node, cachedAnalysis)
+        // Known-productive content is never filtered, skip it before any other work
+        if (llamaInferenceManager.isKnownProductive(contentHash)) {
+            return
+        }
+        
+        // Check the shared native result cache
+        llamaInferenceManager.getCachedResult(contentHash)?.let { cachedResult ->
+            if (!cachedResult.isProductive) {
+                applyContentFilter(node, createAnalysis(text, packageName, contentHash, cachedResult), contentHash)
             }
             return
         }
@@ -325,21 +465,23 @@ class ContentFilterService : AccessibilityService() {
         node: AccessibilityNodeInfo, 
         text: String, 
         packageName: String, 
-        contentHash: String
+        contentHash: Long
     ) {
         activeAnalyses++
         
         processingScope.launch {
             try {
-                val analysis = analyzeContent(text, packageName)
-                
-                // Cache result
-                contentCache[contentHash] = analysis
+                // Result is cached by LlamaInferenceManager; the verdict is stored (without the
+                // text) so later runs can warm the cache
+                val analysis = analyzeContent(text, packageName, contentHash).let { analysis ->
+                    val id = app.contentRepository.saveContentAnalysis(analysis.copy(content = ""))
+                    if (id > 0) analysis.copy(id = id) else analysis
+                }
                 
                 // Apply filter if content is unproductive
                 if (!analysis.isProductive) {
                     withContext(Dispatchers.Main) {
-                        applyContentFilter(node, analysis)
+                        applyContentFilter(node, analysis, contentHash)
                     }
                 }
                 
@@ -365,20 +507,12 @@ class ContentFilterService : AccessibilityService() {
         }
     }
 
-    private suspend fun analyzeContent(text: String, packageName: String): ContentAnalysis {
+    private suspend fun analyzeContent(text: String, packageName: String, contentHash: Long): ContentAnalysis {
         return withContext(Dispatchers.Default) {
             try {
-                val result = llamaInferenceManager.classifyContent(text)
+                val result = llamaInferenceManager.classifyContent(text, packageName)
                 
-                ContentAnalysis(
-                    content = text,
-                    contentType = ContentType.fromPackageName(packageName),
-                    isProductive = result.isProductive,
-                    confidence = result.confidence,
-                    reason = result.reason,
-                    processingTimeMs = result.processingTimeMs,
-                    timestamp = System.currentTimeMillis()
-                )
+                createAnalysis(text, packageName, contentHash, result)
                 
             } catch (e: Exception) {
                 Timber.e(e, "Error in LLM analysis")
@@ -387,23 +521,58 @@ class ContentFilterService : AccessibilityService() {
                 val isProductive = !text.contains(Regex("(?i)(trending|viral|shocking|clickbait)"))
                 
                 ContentAnalysis(
+                    contentHash = NativeResultCache.toHashKey(contentHash),
                     content = text,
                     contentType = ContentType.fromPackageName(packageName),
+                    packageName = packageName,
                     isProductive = isProductive,
                     confidence = 0.5f,
                     reason = "fallback_heuristic",
                     processingTimeMs = 10,
-                    timestamp = System.currentTimeMillis()
+                    timestamp = System.currentTimeMillis(),
+                    modelVersion = llamaInferenceManager.modelVersion(),
+                    isHeuristic = true
                 )
             }
         }
     }
 
-    private fun applyContentFilter(node: AccessibilityNodeInfo, analysis: ContentAnalysis) {
+    private fun createAnalysis(
+        text: String,
+        packageName: String,
+        contentHash: Long,
+        result: LlamaInferenceManager.ClassificationResult
+    ): ContentAnalysis {
+        return ContentAnalysis(
+            contentHash = NativeResultCache.toHashKey(contentHash),
+            content = text,
+            contentType = ContentType.fromPackageName(packageName),
+            packageName = packageName,
+            isProductive = result.isProductive,
+            confidence = result.confidence,
+            reason = result.reason,
+            processingTimeMs = result.processingTimeMs,
+            timestamp = System.currentTimeMillis(),
+            modelVersion = llamaInferenceManager.modelVersion(),
+            isHeuristic = result.isHeuristic
+        )
+    }
+
+    private fun applyContentFilter(node: AccessibilityNodeInfo, analysis: ContentAnalysis, contentHash: Long) {
         try {
             // Create overlay to blur/hide content
             val overlay = createContentOverlay(analysis)
             
+            // Tap reveals the post; long-press also reports it as wrongly filtered
+            overlay.findViewById<Button>(R.id.show_content_button)?.apply {
+                setOnClickListener { removeOverlay(node) }
+                setOnLongClickListener {
+                    removeOverlay(node)
+                    reportIncorrectFilter(analysis, contentHash)
+                    true
+                }
+            }
+            
             // Position overlay over the content
             val bounds = android.graphics.Rect()
             node.getBoundsInScreen(bounds)
@@ -423,12 +592,16 @@ class ContentFilterService : AccessibilityService() {
             
             // Add overlay to window
             windowManager.addView(overlay, layoutParams)
-            activeOverlays[node] = OverlayInfo(overlay, layoutParams, android.graphics.Rect(bounds))
+            val windowKey = windowKey(analysis.packageName, node.windowId)
+            activeOverlays[node] = OverlayInfo(overlay, layoutParams, android.graphics.Rect(bounds), windowKey)
             
-            // Auto-remove overlay after some time
+            // Auto-remove overlay after some time. The post is still on screen unfiltered,
+            // so the window's snapshot is dropped and the next diff filters it again.
             handler.postDelayed({
-                removeOverlay(node)
-            }, 30000) // 30 seconds
+                if (removeOverlay(node) != null) {
+                    SnapshotDiffer.reset(windowKey)
+                }
+            }, OVERLAY_TIMEOUT_MS)
             
             Timber.d("Applied content filter: ${analysis.reason}")
             
@@ -437,6 +610,37 @@ class ContentFilterService : AccessibilityService() {
         }
     }
 
+    /**
+     * Record that a filtered post should not have been filtered. The corrected verdict
+     * replaces the cached one and the near-duplicate verdicts that would be served for
+     * reposts of it, and the post text is stored with the feedback so the model sees it
+     * as a few-shot example (see [syncFeedbackExamples]).
+     */
+    private fun reportIncorrectFilter(analysis: ContentAnalysis, contentHash: Long) {
+        NativeResultCache.insert(contentHash, true, 1.0f, "user_feedback", 0)
+        NativeResultCache.correctNearDuplicate(analysis.content, analysis.packageName, true, 1.0f)
+        
+        serviceScope.launch {
+            // Verdicts served from the cache carry no id; find or store their row
+            val analysisId = analysis.id.takeIf { it > 0 }
+                ?: app.contentRepository.getContentAnalysisByHash(analysis.contentHash)?.id
+                ?: app.contentRepository.saveContentAnalysis(analysis.copy(content = ""))
+            if (analysisId > 0) {
+                app.contentRepository.recordCorrection(
+                    analysisId,
+                    UserFeedback(FeedbackType.INCORRECT_FILTER, System.currentTimeMillis()),
+                    analysis.content
+                )
+            }
+        }
+        
+        Toast.makeText(this, "Thanks, ScrollGuard will learn from this", Toast.LENGTH_SHORT).show()
+        analyticsManager.logEvent("content_feedback") {
+            param("feedback_type", FeedbackType.INCORRECT_FILTER.name)
+            param("package_name", analysis.packageName)
+        }
+    }
+
     private fun createContentOverlay(analysis: ContentAnalysis): View {
         val overlay = LayoutInflater.from(this).inflate(R.layout.content_filter_overlay, null)
         
@@ -454,8 +658,8 @@ class ContentFilterService : AccessibilityService() {
         return overlay
     }
 
-    private fun removeOverlay(node: AccessibilityNodeInfo) {
-        activeOverlays.remove(node)?.let { overlayInfo ->
+    private fun removeOverlay(node: AccessibilityNodeInfo): OverlayInfo? {
+        return activeOverlays.remove(node)?.also { overlayInfo ->
             try {
                 windowManager.removeView(overlayInfo.overlay)
             } catch (e: Exception) {
@@ -463,6 +667,8 @@ class ContentFilterService : AccessibilityService() {
             }
         }
     }
+    
+    private fun windowKey(packageName: String, windowId: Int): String = "$packageName:$windowId"
 
     private fun updateOverlayPositions() {
         try {
@@ -511,6 +717,9 @@ class ContentFilterService : AccessibilityService() {
             }
         }
         activeOverlays.clear()
+        
+        // Overlays are gone, so content already on screen must be filtered again
+        SnapshotDiffer.resetAll()
     }
 
     private suspend fun initializeLLM() {
@@ -534,6 +743,33 @@ class ContentFilterService : AccessibilityService() {
         }
     }
 
+    private suspend fun preloadResultCache() {
+        try {
+            app.contentRepository.cleanupOldAnalyses()
+            
+            val since = System.currentTimeMillis() - CACHE_PRELOAD_WINDOW_MS
+            val modelVersion = llamaInferenceManager.modelVersion()
+            val verdicts = app.contentRepository.getRecentVerdicts(since, modelVersion, CACHE_PRELOAD_LIMIT)
+            val loaded = withContext(Dispatchers.Default) {
+                llamaInferenceManager.preloadCachedResults(verdicts)
+            }
+            Timber.d("Preloaded $loaded of ${verdicts.size} stored verdicts into the result cache")
+        } catch (e: Exception) {
+            Timber.e(e, "Failed to preload result cache")
+        }
+    }
+
+    private suspend fun syncFeedbackExamples() {
+        app.contentRepository.getRecentCorrections(FEW_SHOT_EXAMPLES)
+            .map { corrections -> corrections.reversed().map { it.content to it.correctedIsProductive } }
+            .distinctUntilChanged()
+            .catch { e -> Timber.e(e, "Failed to read feedback examples") }
+            .collect { examples ->
+                llamaInferenceManager.setFeedbackExamples(examples)
+                Timber.d("Using ${examples.size} feedback examples in the classification prompt")
+            }
+    }
+
     private fun startForegroundService() {
         val serviceIntent = Intent(this, LLMInferenceService::class.java)
         startForegroundService(serviceIntent)
@@ -541,7 +777,7 @@ class ContentFilterService : AccessibilityService() {
 
     private fun cleanup() {
         clearAllOverlays()
-        contentCache.clear()
+        closeCaptionSessions()
         processingQueue.clear()
         
         serviceScope.cancel()
@@ -554,6 +790,6 @@ class ContentFilterService : AccessibilityService() {
         val node: AccessibilityNodeInfo,
         val text: String,
         val packageName: String,
-        val contentHash: String
+        val contentHash: Long
     )
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+package com.scrollguard.app.service
+
+import timber.log.Timber
+
+/**
+ * JNI interface for native screen-snapshot diffing.
+ * Remembers the canonical content hashes of each window's previous snapshot
+ * so a content change only re-queues the texts that are new or changed.
+ */
+object SnapshotDiffer {
+
+    private val isAvailable: Boolean = try {
+        System.loadLibrary("scrollguard-native")
+        true
+    } catch (e: UnsatisfiedLinkError) {
+        Timber.e(e, "Native snapshot differ unavailable")
+        false
+    }
+
+    /**
+     * Diff a window snapshot against the previous snapshot of the same window
+     * @param windowKey Identifies the window (package and window id)
+     * @param texts Text of every content node in the snapshot
+     * @param packageName App package selecting the canonicalization rules
+     * @return Indices into [texts] that are new or changed, first occurrence only
+     */
+    external fun nativeDiffSnapshot(windowKey: String, texts: Array<String>, packageName: String): IntArray
+
+    /**
+     * Forget a window's previous snapshot
+     * @param windowKey Window to forget, or "" for every window
+     */
+    external fun nativeReset(windowKey: String)
+
+    /**
+     * Diff a snapshot, treating every text as new if the native library is missing
+     */
+    fun diff(windowKey: String, texts: List<String>, packageName: String): IntArray {
+        return if (isAvailable) {
+            nativeDiffSnapshot(windowKey, texts.toTypedArray(), packageName)
+        } else {
+            texts.indices.toList().toIntArray()
+        }
+    }
+
+    /**
+     * Forget one window's snapshot, so the next diff reports everything in it
+     */
+    fun reset(windowKey: String) {
+        if (isAvailable) nativeReset(windowKey)
+    }
+
+    /**
+     * Forget every window's snapshot, so the next diff reports everything on screen
+     */
+    fun resetAll() {
+        if (isAvailable) nativeReset("")
+    }
+}
@@ -39,6 +39,31 @@ object LlamaInference {
         temperature: Float
     ): Boolean
 
+    /**
+     * Load a model stored uncompressed inside another file (APK asset or zip entry)
+     * @param fd Descriptor of the containing file; may be closed once this returns
+     * @param offset Start of the GGUF data within the file
+     * @param length Size of the GGUF data
+     * @param cacheDir Directory for the one-time copy of an embedded range; a range covering
+     *                 the whole file is opened in place
+     * @return true if model was loaded successfully
+     */
+    external fun nativeLoadModelFromFd(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        cacheDir: String,
+        nCtx: Int,
+        nThreads: Int,
+        temperature: Float
+    ): Boolean
+
+    /**
+     * Locate an uncompressed entry of a zip archive
+     * @return [offset, length] of the entry data, or null if missing or compressed
+     */
+    external fun nativeLocateStoredEntry(fd: Int, entryName: String): LongArray?
+
     /**
      * Check if model is currently loaded
      * @return true if model is loaded and ready for inference
@@ -72,6 +97,171 @@ object LlamaInference {
      */
     external fun nativeCleanup()
 
+    /**
+     * Load the escalation model of the two-model cascade. Posts the main model
+     * scores with a margin below escalationMargin are re-scored by it.
+     * @param modelPath Path to the larger GGUF model
+     * @param nCtx Context length for the model
+     * @param nThreads Number of threads (the cascade shares one threadpool)
+     * @param escalationMargin Re-score when |P(productive) - P(unproductive)| is below this
+     * @param idleReleaseSeconds Page out the model's weights after this long without escalations, 0 = never
+     * @return true if the model was loaded
+     */
+    external fun nativeLoadEscalationModel(
+        modelPath: String,
+        nCtx: Int,
+        nThreads: Int,
+        escalationMargin: Float,
+        idleReleaseSeconds: Int
+    ): Boolean
+
+    /**
+     * Stop escalating and free the escalation model
+     */
+    external fun nativeUnloadEscalationModel()
+
+    /**
+     * Receives explanation text as it is generated
+     */
+    fun interface TokenListener {
+        /**
+         * @param piece Newly generated text
+         * @return false to stop generation
+         */
+        fun onToken(piece: String): Boolean
+    }
+
+    /**
+     * Classify content, then generate the reason and stream it to listener.
+     * Blocks until done; listener is called on the calling thread.
+     * @param content The text content to classify
+     * @param context App package name the content was shown in (optional)
+     * @param maxReasonTokens Hard cap on generated reason tokens
+     * @param listener Receives reason text as it is generated; return false to stop early
+     * @return JSON string containing classification result, with the generated text as reason
+     */
+    external fun nativeClassifyContentStreaming(
+        content: String,
+        context: String?,
+        maxReasonTokens: Int,
+        listener: TokenListener?
+    ): String
+
+    /**
+     * Generate a one-sentence reason for a verdict. With the cascade enabled the
+     * escalation model writes it and the main model drafts tokens for it.
+     * Blocks until done; listener is called on the calling thread.
+     * @param content Content that was classified
+     * @param isProductive Verdict to explain
+     * @param maxTokens Hard cap on generated tokens
+     * @param listener Receives text as it is generated, or null
+     * @return JSON with success, text, tokens, drafted, accepted, target_passes and time_ms
+     */
+    external fun nativeGenerateExplanation(
+        content: String,
+        isProductive: Boolean,
+        maxTokens: Int,
+        listener: TokenListener?
+    ): String
+
+    /**
+     * Open a caption session for a video whose caption grows over time (Live Caption)
+     * @param context App package name the video is shown in (optional)
+     * @return Session id, or -1 if the native wrapper is not initialized
+     */
+    external fun nativeOpenCaptionSession(context: String?): Int
+
+    /**
+     * Classify the caption so far. Only tokens added since the previous update are
+     * prefilled; once the verdict is stable, updates return it without inference.
+     * @param session Id from nativeOpenCaptionSession
+     * @param caption Whole caption text so far
+     * @return JSON as nativeClassifyContent, plus stable and decoded_tokens
+     */
+    external fun nativeUpdateCaptionSession(session: Int, caption: String): String
+
+    /**
+     * Close a caption session and free its cached state
+     */
+    external fun nativeCloseCaptionSession(session: Int)
+
+    /**
+     * Replace the few-shot examples in the classification prompt
+     * @param contents Corrected posts, oldest first; the most recent few are used
+     * @param isProductive Verdict the user says is right, per post
+     */
+    external fun nativeSetFewShotExamples(contents: Array<String>, isProductive: BooleanArray)
+
+    /**
+     * Start paging the model's weights into memory on an idle-priority thread
+     * @param modelPath Path to the GGUF model file; resolved to the variant a load would open
+     * @return true if the prefetch was started or has already run for this file
+     */
+    external fun nativePrefetchModel(modelPath: String): Boolean
+
+    /**
+     * Get weight prefetch progress as JSON string
+     * @return JSON with state, total_bytes, requested_bytes and resident_bytes
+     */
+    external fun nativeGetPrefetchProgress(): String
+
+    /**
+     * Requantize the model to the format that benchmarks fastest on this CPU.
+     * Blocks for the whole job; the choice applies to later loads of modelPath.
+     * @param modelPath Path to the downloaded GGUF model file
+     * @param nCtx Context length to benchmark with
+     * @param nThreads Number of threads for quantization and benchmarking
+     * @return JSON with success, selected and per-format variants timings
+     */
+    external fun nativeOptimizeModelFormat(modelPath: String, nCtx: Int, nThreads: Int): String
+
+    /**
+     * Path a load of modelPath actually opens: the requantized variant selected for
+     * this CPU by [nativeOptimizeModelFormat], or modelPath itself
+     */
+    external fun nativeResolveModelPath(modelPath: String): String
+
+    /**
+     * Delete requantized variants of a model and the recorded format choice
+     * @param modelPath Path to the original GGUF model file
+     */
+    external fun nativeDiscardModelVariants(modelPath: String)
+
+    /**
+     * Replace the native model registry with a manifest
+     * @param manifest Manifest text (see model_registry.h for the format)
+     * @return true if the manifest was valid and loaded
+     */
+    external fun nativeLoadModelManifest(manifest: String): Boolean
+
+    /**
+     * Select the largest downloaded model that meets the budget. A persisted choice
+     * is reused while the manifest, hardware and downloaded files are unchanged.
+     * @param modelsDir Directory holding downloaded models
+     * @param p95LatencyMs Maximum p95 classification prefill latency
+     * @param memoryBudgetBytes Maximum model footprint, 0 for available memory
+     * @param nCtx Context length to benchmark with
+     * @param nThreads Number of threads to benchmark with
+     * @param benchmark Benchmark the candidates when no persisted choice is valid;
+     *                  false only reads the persisted choice
+     * @return JSON with success, model, variant, path, meets_budget, cached and latencies
+     */
+    external fun nativeSelectModel(
+        modelsDir: String,
+        p95LatencyMs: Int,
+        memoryBudgetBytes: Long,
+        nCtx: Int,
+        nThreads: Int,
+        benchmark: Boolean
+    ): String
+
+    /**
+     * Path of the manifest's escalation model (role=escalation) if it is downloaded
+     * @param modelsDir Directory holding downloaded models
+     * @return Path to load with [nativeLoadEscalationModel], or null
+     */
+    external fun nativeFindEscalationModel(modelsDir: String): String?
+
     /**
      * Get model information as JSON string
      * @return JSON string containing model metadata
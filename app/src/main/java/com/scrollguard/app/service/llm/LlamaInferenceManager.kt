@@ -1,13 +1,20 @@
 package com.scrollguard.app.service.llm
 
 import android.content.Context
+import android.os.ParcelFileDescriptor
+import com.scrollguard.app.data.dao.StoredVerdict
+import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.cancel
+import kotlinx.coroutines.launch
 import kotlinx.coroutines.sync.Mutex
 import kotlinx.coroutines.sync.withLock
 import kotlinx.coroutines.withContext
 import timber.log.Timber
 import java.io.File
-import java.util.concurrent.ConcurrentHashMap
+import java.io.IOException
 
 /**
  * Manager class for LLama inference operations.
@@ -17,46 +24,41 @@ class LlamaInferenceManager(private val context: Context) {
 
     companion object {
         private const val MODEL_FILENAME = "qwen2-0_5b-instruct-q4_k_m.gguf"
+        private const val BUNDLED_MODEL_ASSET = "models/$MODEL_FILENAME"
+        private const val MODEL_MANIFEST_ASSET = "models/manifest.txt"
+        private const val P95_LATENCY_BUDGET_MS = 400
+        private const val MODEL_MEMORY_BUDGET_BYTES = 0L // 0 = whatever headroom the device has
+        private const val ESCALATION_MARGIN = 0.3f
+        private const val ESCALATION_IDLE_RELEASE_SECONDS = 120
+        private const val EXPLANATION_MAX_TOKENS = 48
         private const val DEFAULT_N_CTX = 2048
         private const val DEFAULT_N_THREADS = 4
         private const val DEFAULT_TEMPERATURE = 0.1f
+        private const val RESULT_CACHE_BYTE_BUDGET = 2L * 1024 * 1024 // 2MB
+        private const val PERSISTENT_CACHE_FILENAME = "classification_cache.bin"
+        private const val PERSISTENT_CACHE_MODEL_FILENAME = "classification_cache.model"
         
-        // Classification prompts
-        private val CLASSIFICATION_PROMPT = """
-You are a content classifier for a productivity app. Analyze the following social media content and determine if it's productive or unproductive.
-
-Productive content includes:
-- Educational material, tutorials, how-to guides
-- News and current events (factual)
-- Professional networking and career advice
-- Health and wellness information
-- Scientific research and insights
-- Creative and artistic content with substance
-- Meaningful discussions and debates
-
-Unproductive content includes:
-- Clickbait headlines and sensationalized content
-- Gossip, drama, and celebrity news
-- Addictive short-form entertainment
-- Inflammatory or divisive content
-- Repetitive memes and viral content
-- Time-wasting challenges and trends
-- Excessive advertising and promotional content
-
-Content to analyze: "{content}"
-
-Respond with only: PRODUCTIVE or UNPRODUCTIVE
-        """.trimIndent()
+        // Bump when the prompt or heuristic keyword lists change so persisted verdicts are dropped
+        private const val LEXICON_VERSION = "2"
     }
 
     private val inferenceMutex = Mutex()
-    private val resultCache = ConcurrentHashMap<String, ClassificationResult>()
     private val modelDownloadManager = ModelDownloadManager(context)
     
     private var isInitialized = false
     private var isModelLoaded = false
     private var modelPath: String? = null
     private var currentModel: ModelDownloadManager.ModelInfo? = null
+    private var selectedModelFile: File? = null
+    
+    // Benchmarks downloaded models off the load path; see [scheduleModelSelection]
+    private val selectionScope = CoroutineScope(SupervisorJob() + Dispatchers.Default)
+    private var selectionJob: Job? = null
+    private var cascadeJob: Job? = null
+    @Volatile private var cascadeEnabled = false
+    
+    // Model file identity the cached verdicts belong to; the persistent cache epoch is derived from it alone
+    @Volatile private var modelEpoch: String = ""
 
     data class ClassificationResult(
         val isProductive: Boolean,
@@ -64,6 +66,20 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
         val reason: String,
         val processingTimeMs: Int,
         val success: Boolean = true,
+        val errorMessage: String? = null,
+        val isHeuristic: Boolean = false
+    )
+
+    data class CaptionResult(
+        val classification: ClassificationResult,
+        val isStable: Boolean,
+        val decodedTokens: Int
+    )
+
+    data class ExplanationResult(
+        val text: String,
+        val processingTimeMs: Int,
+        val success: Boolean = true,
         val errorMessage: String? = null
     )
 
@@ -83,6 +99,10 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
                 return@withContext false
             }
             
+            loadModelManifest()
+            NativeResultCache.nativeSetByteBudget(RESULT_CACHE_BYTE_BUDGET)
+            openPersistentCache()
+            
             isInitialized = true
             Timber.d("LLama inference manager initialized successfully")
             true
@@ -101,11 +121,24 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
             if (isModelLoaded) return@withLock true
             
             try {
-                val modelFile = customModelPath?.let { File(it) } ?: getDefaultModelFile()
+                val modelFile = customModelPath?.let { File(it) }
+                    ?: selectModelFile(benchmark = false)
+                    ?: getDefaultModelFile()
+                
+                // The benchmark behind a first selection loads every candidate; it runs in
+                // the background while the stored choice or the default model serves
+                if (customModelPath == null) {
+                    scheduleModelSelection()
+                }
                 
                 if (!modelFile.exists()) {
                     Timber.w("Model file not found: ${modelFile.absolutePath}")
                     
+                    // A model shipped in the APK is loaded from its asset range
+                    if (customModelPath == null && hasBundledModel()) {
+                        return@withLock loadBundledModel()
+                    }
+                    
                     // For development, create a placeholder
                     if (!modelFile.exists()) {
                         Timber.d("Creating placeholder model file for development")
@@ -117,7 +150,7 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
 
                 modelPath = modelFile.absolutePath
                 
-                Timber.d("Loading model from: $modelPath")
+                Timber.d("Loading model from: $modelPath (prefetch ${LlamaInference.nativeGetPrefetchProgress()})")
                 
                 val loadResult = LlamaInference.nativeLoadModel(
                     modelPath = modelPath!!,
@@ -128,9 +161,11 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
 
                 if (loadResult) {
                     isModelLoaded = true
+                    onModelLoaded(modelEpochFor(modelFile))
                     
                     // Warm up the model
                     warmUpModel()
+                    scheduleCascade()
                     
                     Timber.d("Model loaded successfully")
                     true
@@ -146,8 +181,170 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
         }
     }
 
+    /**
+     * Load a model stored uncompressed in a zip bundle. The entry is validated in
+     * place, then copied once to app storage because llama.cpp cannot load at an offset
+     * @param bundle Zip archive containing the model
+     * @param entryName Path of the GGUF entry inside the archive
+     */
+    suspend fun loadModelFromBundle(bundle: File, entryName: String): Boolean = withContext(Dispatchers.IO) {
+        inferenceMutex.withLock {
+            if (isModelLoaded) return@withLock true
+            
+            try {
+                ParcelFileDescriptor.open(bundle, ParcelFileDescriptor.MODE_READ_ONLY).use { pfd ->
+                    val range = LlamaInference.nativeLocateStoredEntry(pfd.fd, entryName)
+                    if (range == null) {
+                        Timber.e("No uncompressed $entryName in ${bundle.name}")
+                        return@withLock false
+                    }
+                    loadFromFd(pfd.fd, range[0], range[1], entryName.substringAfterLast('/'), bundle.absolutePath, bundle)
+                }
+            } catch (e: Exception) {
+                Timber.e(e, "Error loading model from bundle ${bundle.name}")
+                false
+            }
+        }
+    }
+
+    /**
+     * Switch to another model without a gap in classification: the current model
+     * keeps serving while the new one loads and warms up natively, then requests
+     * move over between calls. Loads the model normally if none is loaded.
+     * @param newModelPath Path to the GGUF model to switch to
+     */
+    suspend fun switchModel(newModelPath: String): Boolean = withContext(Dispatchers.IO) {
+        inferenceMutex.withLock {
+            val modelFile = File(newModelPath)
+            if (!modelFile.exists()) {
+                Timber.w("Model file not found: $newModelPath")
+                return@withLock false
+            }
+            if (isModelLoaded && newModelPath == modelPath) return@withLock true
+            
+            try {
+                Timber.d("Switching model to: $newModelPath")
+                val loadResult = LlamaInference.nativeLoadModel(
+                    modelPath = newModelPath,
+                    nCtx = DEFAULT_N_CTX,
+                    nThreads = DEFAULT_N_THREADS,
+                    temperature = DEFAULT_TEMPERATURE
+                )
+                
+                if (loadResult) {
+                    onModelLoaded(modelEpochFor(modelFile))
+                    modelPath = newModelPath
+                    isModelLoaded = true
+                    Timber.d("Switched model to ${modelFile.name}")
+                } else {
+                    // A failed swap leaves the previous model serving, unless it had to be
+                    // unloaded to make room
+                    isModelLoaded = LlamaInference.nativeIsModelLoaded()
+                    Timber.e("Failed to switch model to ${modelFile.name}")
+                }
+                loadResult
+            } catch (e: Exception) {
+                Timber.e(e, "Error switching model")
+                false
+            }
+        }
+    }
+
+    /**
+     * Enable the two-model cascade: the loaded model keeps screening every post,
+     * and low-margin verdicts are re-scored by the larger model at escalationModelPath.
+     * The larger model's weights are paged out when idle and fault back in on the
+     * next hard case. Loads enable it by themselves (see [scheduleCascade]).
+     */
+    suspend fun enableCascade(escalationModelPath: String): Boolean = withContext(Dispatchers.IO) {
+        if (!File(escalationModelPath).exists()) {
+            Timber.w("Escalation model not found: $escalationModelPath")
+            return@withContext false
+        }
+        
+        try {
+            val loaded = LlamaInference.nativeLoadEscalationModel(
+                modelPath = escalationModelPath,
+                nCtx = DEFAULT_N_CTX,
+                nThreads = DEFAULT_N_THREADS,
+                escalationMargin = ESCALATION_MARGIN,
+                idleReleaseSeconds = ESCALATION_IDLE_RELEASE_SECONDS
+            )
+            Timber.d("Cascade escalation model ${if (loaded) "loaded" else "failed to load"}: $escalationModelPath")
+            cascadeEnabled = loaded
+            loaded
+        } catch (e: Exception) {
+            Timber.e(e, "Error enabling cascade")
+            false
+        }
+    }
+
+    /**
+     * Disable the cascade and free the escalation model
+     */
+    fun disableCascade() {
+        try {
+            cascadeEnabled = false
+            LlamaInference.nativeUnloadEscalationModel()
+        } catch (e: Exception) {
+            Timber.e(e, "Error disabling cascade")
+        }
+    }
+
+    /**
+     * Explain a verdict in one short sentence, streaming text to onToken as it is
+     * generated. Return false from onToken to stop early.
+     */
+    suspend fun generateExplanation(
+        content: String,
+        isProductive: Boolean,
+        onToken: (String) -> Boolean = { true }
+    ): ExplanationResult = withContext(Dispatchers.Default) {
+        if (!isModelLoaded) {
+            return@withContext ExplanationResult(
+                text = "",
+                processingTimeMs = 0,
+                success = false,
+                errorMessage = "Model not loaded"
+            )
+        }
+        
+        try {
+            // Collect the streamed text; the JSON result only carries it escaped
+            val text = StringBuilder()
+            val json = LlamaInference.nativeGenerateExplanation(
+                content = content,
+                isProductive = isProductive,
+                maxTokens = EXPLANATION_MAX_TOKENS
+            ) { piece ->
+                text.append(piece)
+                onToken(piece)
+            }
+            
+            val success = json.contains("\"success\":true")
+            Timber.d("Explanation: ${extractJsonValue(json, "tokens")} tokens, " +
+                "${extractJsonValue(json, "accepted")}/${extractJsonValue(json, "drafted")} drafted accepted, " +
+                "${extractJsonValue(json, "target_passes")} target passes")
+            ExplanationResult(
+                text = text.toString().trim(),
+                processingTimeMs = extractJsonValue(json, "time_ms")?.toIntOrNull() ?: 0,
+                success = success,
+                errorMessage = if (success) null else extractJsonValue(json, "error")
+            )
+        } catch (e: Exception) {
+            Timber.e(e, "Error generating explanation")
+            ExplanationResult(
+                text = "",
+                processingTimeMs = 0,
+                success = false,
+                errorMessage = e.message
+            )
+        }
+    }
+
     /**
      * Classify content for productivity
+     * @param context App package name the content was shown in (selects cache key canonicalization)
      */
     suspend fun classifyContent(content: String, context: String = ""): ClassificationResult = withContext(Dispatchers.Default) {
         if (content.isBlank()) {
@@ -162,8 +359,18 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
         }
 
         // Check cache first
-        val contentHash = content.hashCode().toString()
-        resultCache[contentHash]?.let { return@withContext it }
+        val contentHash = contentHash(content, context)
+        getCachedResult(contentHash)?.let { return@withContext it }
+
+        // Reposts and lightly edited captions reuse a near-duplicate's verdict. The borrowed
+        // verdict is not cached under this content's exact hash: the exact and persistent
+        // tiers only hold verdicts computed for the content itself.
+        NativeResultCache.findNearDuplicate(content, context)?.let { json ->
+            val result = parseClassificationResult(json, 0)
+            if (result.success) {
+                return@withContext result
+            }
+        }
 
         if (!isInitialized || !isModelLoaded) {
             Timber.w("Model not loaded, using fallback classification")
@@ -173,23 +380,27 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
         try {
             val startTime = System.currentTimeMillis()
             
-            // Prepare prompt
-            val prompt = CLASSIFICATION_PROMPT.replace("{content}", content.take(500))
-            
-            // Call native inference
-            val resultJson = LlamaInference.nativeClassifyContent(prompt, context)
+            // Call native inference; the prompt template lives on the native side
+            val resultJson = LlamaInference.nativeClassifyContent(content.take(500), context)
             val processingTime = (System.currentTimeMillis() - startTime).toInt()
             
             // Parse result
             val result = parseClassificationResult(resultJson, processingTime)
             
-            // Cache result
-            resultCache[contentHash] = result
-            
-            // Clean cache if it gets too large
-            if (resultCache.size > 1000) {
-                val oldestKeys = resultCache.keys.take(200)
-                oldestKeys.forEach { resultCache.remove(it) }
+            // Cache successful results (native cache evicts within its byte budget)
+            if (result.success) {
+                NativeResultCache.insert(
+                    contentHash,
+                    result.isProductive,
+                    result.confidence,
+                    result.reason,
+                    result.processingTimeMs
+                )
+                NativeResultCache.insertNearDuplicate(
+                    NativeResultCache.simHash(content, context),
+                    result.isProductive,
+                    result.confidence
+                )
             }
             
             result
@@ -200,16 +411,236 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
         }
     }
 
+    /**
+     * Classify content and generate the reason with the model's configured sampler,
+     * streaming reason text to onReason as it is produced so the overlay can show it
+     * progressively. Return false from onReason to stop the reason early; the verdict
+     * is unaffected. The verdict is cached like [classifyContent]'s.
+     */
+    suspend fun classifyContentStreaming(
+        content: String,
+        context: String = "",
+        onReason: (String) -> Boolean
+    ): ClassificationResult = withContext(Dispatchers.Default) {
+        if (content.isBlank() || !isInitialized || !isModelLoaded) {
+            return@withContext classifyContent(content, context)
+        }
+
+        try {
+            val startTime = System.currentTimeMillis()
+            val reason = StringBuilder()
+            val resultJson = LlamaInference.nativeClassifyContentStreaming(
+                content = content.take(500),
+                context = context,
+                maxReasonTokens = EXPLANATION_MAX_TOKENS
+            ) { piece ->
+                reason.append(piece)
+                onReason(piece)
+            }
+            val processingTime = (System.currentTimeMillis() - startTime).toInt()
+
+            // The reason is free text, so take it from the stream rather than the JSON
+            val parsed = parseClassificationResult(resultJson, processingTime)
+            val result = if (parsed.success && reason.isNotBlank()) {
+                parsed.copy(reason = reason.toString().trim())
+            } else {
+                parsed
+            }
+            if (result.success) {
+                val simHash = NativeResultCache.simHash(content, context)
+                NativeResultCache.insert(
+                    contentHash(content, context),
+                    result.isProductive,
+                    result.confidence,
+                    result.reason,
+                    result.processingTimeMs
+                )
+                NativeResultCache.insertNearDuplicate(simHash, result.isProductive, result.confidence)
+            }
+            result
+        } catch (e: Exception) {
+            Timber.e(e, "Error during streaming classification")
+            fallbackClassification(content)
+        }
+    }
+
+    /**
+     * Open a caption session for a video whose Live Caption text grows a few words
+     * at a time. Pass the whole caption so far to [updateCaptionSession] on every
+     * change and close the session when the video leaves the screen.
+     * @return Session id, or null if the model is not ready
+     */
+    fun openCaptionSession(context: String = ""): Int? {
+        if (!isInitialized || !isModelLoaded) return null
+        return LlamaInference.nativeOpenCaptionSession(context).takeIf { it >= 0 }
+    }
+
+    /**
+     * Classify the caption so far at the cost of the text added since the last
+     * update. Once [CaptionResult.isStable] is set the verdict is final and later
+     * updates return it without running the model.
+     */
+    suspend fun updateCaptionSession(session: Int, caption: String): CaptionResult = withContext(Dispatchers.Default) {
+        try {
+            val json = LlamaInference.nativeUpdateCaptionSession(session, caption.take(500))
+            val result = parseClassificationResult(json, extractJsonValue(json, "processing_time_ms")?.toIntOrNull() ?: 0)
+            CaptionResult(
+                classification = if (result.success) result else fallbackClassification(caption),
+                isStable = result.success && json.contains("\"stable\":true"),
+                decodedTokens = extractJsonValue(json, "decoded_tokens")?.toIntOrNull() ?: 0
+            )
+        } catch (e: Exception) {
+            Timber.e(e, "Error updating caption session")
+            CaptionResult(fallbackClassification(caption), isStable = false, decodedTokens = 0)
+        }
+    }
+
+    /**
+     * Close a caption session and free its cached model state
+     */
+    fun closeCaptionSession(session: Int) {
+        if (isInitialized) {
+            LlamaInference.nativeCloseCaptionSession(session)
+        }
+    }
+
+    /**
+     * Show the model posts the user corrected as few-shot examples. The prompt
+     * prefix holding them is rebuilt in the background, so classification costs
+     * the same as without examples.
+     * @param examples Corrected content and its right verdict, oldest first
+     */
+    fun setFeedbackExamples(examples: List<Pair<String, Boolean>>) {
+        if (!isInitialized) return
+        LlamaInference.nativeSetFewShotExamples(
+            examples.map { it.first }.toTypedArray(),
+            examples.map { it.second }.toBooleanArray()
+        )
+    }
+
+    /**
+     * Compute the cache key for content shown in an app
+     */
+    fun contentHash(content: String, packageName: String = ""): Long =
+        NativeResultCache.hash(content, packageName)
+
+    /**
+     * Warm the result cache with verdicts stored in Room.
+     * Rows whose contentHash is not a native hash key (see [NativeResultCache.toHashKey]) are skipped.
+     * @param verdicts Stored verdicts, newest first
+     * @return Number of verdicts loaded into the cache
+     */
+    fun preloadCachedResults(verdicts: List<StoredVerdict>): Int {
+        val hashes = LongArray(verdicts.size)
+        val productive = BooleanArray(verdicts.size)
+        val confidences = FloatArray(verdicts.size)
+        
+        var count = 0
+        verdicts.forEach { verdict ->
+            val hash = try {
+                java.lang.Long.parseUnsignedLong(verdict.contentHash, 16)
+            } catch (e: NumberFormatException) {
+                return@forEach // Legacy key format
+            }
+            hashes[count] = hash
+            productive[count] = verdict.isProductive
+            confidences[count] = verdict.confidence
+            count++
+        }
+        
+        if (count == 0) return 0
+        return NativeResultCache.preload(
+            hashes.copyOf(count),
+            productive.copyOf(count),
+            confidences.copyOf(count)
+        )
+    }
+
+    /**
+     * Fast pre-check: true if the content was recently classified productive
+     * and needs no filtering. Cheaper than [getCachedResult], may rarely be wrong.
+     */
+    fun isKnownProductive(contentHash: Long): Boolean =
+        NativeResultCache.isKnownProductive(contentHash)
+
+    /**
+     * Look up a previously classified result without running inference
+     */
+    fun getCachedResult(contentHash: Long): ClassificationResult? {
+        val json = NativeResultCache.lookup(contentHash) ?: return null
+        val processingTimeMs = extractJsonValue(json, "processing_time_ms")?.toIntOrNull() ?: 0
+        return parseClassificationResult(json, processingTimeMs)
+    }
+
     /**
      * Check if manager is initialized
      */
     fun isInitialized(): Boolean = isInitialized
 
+    /**
+     * Start paging the model weights into memory in the background, so the first
+     * classification after startup does not stall on page faults. The file is the
+     * one [loadModel] will open: the stored selection, else the default model.
+     */
+    fun prefetchModelWeights() {
+        selectionScope.launch(Dispatchers.IO) {
+            val modelFile = selectedModelFile ?: selectModelFile(benchmark = false) ?: getDefaultModelFile()
+            if (!modelFile.exists() || modelFile.length() == 0L) return@launch
+            
+            try {
+                if (LlamaInference.nativePrefetchModel(modelFile.absolutePath)) {
+                    Timber.d("Prefetching model weights: ${modelFile.name}")
+                }
+            } catch (e: Exception) {
+                Timber.e(e, "Error starting model prefetch")
+            } catch (e: UnsatisfiedLinkError) {
+                Timber.e(e, "Native model prefetch unavailable")
+            }
+        }
+    }
+
+    /**
+     * Requantize the downloaded model to the format that runs fastest on this
+     * device (e.g. Q4_0 on CPUs with dotprod/i8mm). Optional and slow, best run
+     * while the device is idle and charging. The next [loadModel] picks up the
+     * selected format automatically.
+     * @return Selected format, or null if the job could not run
+     */
+    suspend fun optimizeModelFormat(): String? = withContext(Dispatchers.IO) {
+        val modelFile = getDefaultModelFile()
+        if (!modelFile.exists() || modelFile.length() == 0L) return@withContext null
+        
+        try {
+            val json = LlamaInference.nativeOptimizeModelFormat(
+                modelPath = modelFile.absolutePath,
+                nCtx = DEFAULT_N_CTX,
+                nThreads = DEFAULT_N_THREADS
+            )
+            if (!json.contains("\"success\":true")) {
+                Timber.w("Model format optimization failed: ${extractJsonValue(json, "error")}")
+                return@withContext null
+            }
+            
+            val selected = extractJsonValue(json, "selected")
+            Timber.d("Model format for this device: $selected ($json)")
+            selected
+        } catch (e: Exception) {
+            Timber.e(e, "Error optimizing model format")
+            null
+        }
+    }
+
     /**
      * Check if model is loaded
      */
     fun isModelLoaded(): Boolean = isModelLoaded
 
+    /**
+     * Model the cached verdicts belong to: the last model loaded, also before this
+     * run's load completes. Stored verdicts are only reused under the same version.
+     */
+    fun modelVersion(): String = modelEpoch
+
     /**
      * Get current memory usage
      */
@@ -245,7 +676,9 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
      */
     fun cleanup() {
         try {
-            resultCache.clear()
+            selectionScope.cancel()
+            NativeResultCache.clear()
+            NativeResultCache.flushPersistent()
             
             if (isInitialized) {
                 LlamaInference.nativeCleanup()
@@ -253,6 +686,7 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
             
             isModelLoaded = false
             isInitialized = false
+            cascadeEnabled = false
             modelPath = null
             
             Timber.d("LLama inference manager cleaned up")
@@ -262,10 +696,222 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
         }
     }
 
+    /**
+     * Open the on-disk verdict cache so classifications survive restarts. It opens
+     * at the epoch of the last model loaded; [onModelLoaded] moves it on if the
+     * next load turns out to be a different model.
+     */
+    private fun openPersistentCache() {
+        val cacheDir = File(context.filesDir, "cache").apply { mkdirs() }
+        val cacheFile = File(cacheDir, PERSISTENT_CACHE_FILENAME)
+        modelEpoch = try {
+            File(cacheDir, PERSISTENT_CACHE_MODEL_FILENAME).takeIf { it.exists() }?.readText()?.trim() ?: ""
+        } catch (e: IOException) {
+            ""
+        }
+        val opened = NativeResultCache.openPersistent(
+            cacheFile.absolutePath,
+            modelEpoch,
+            LEXICON_VERSION
+        )
+        if (!opened) {
+            Timber.w("Persistent classification cache unavailable, using memory cache only")
+        }
+    }
+
+    /**
+     * Cache epoch of a model file: the name, size and modification time of the file
+     * loads actually open. A switch to a requantized variant (see [optimizeModelFormat])
+     * or a re-downloaded model saved under the same name drops the old verdicts.
+     */
+    private fun modelEpochFor(modelFile: File): String {
+        val opened = try {
+            File(LlamaInference.nativeResolveModelPath(modelFile.absolutePath))
+        } catch (e: UnsatisfiedLinkError) {
+            modelFile
+        }
+        return modelEpochOf(opened.name, opened.length(), opened.lastModified())
+    }
+
+    private fun modelEpochOf(name: String, length: Long, modifiedMs: Long): String = "$name:$length:$modifiedMs"
+
+    /**
+     * Move the verdict caches to a model that just loaded, before it classifies
+     * anything. Verdicts from a different model are dropped from every tier.
+     * The caller holds inferenceMutex.
+     */
+    private fun onModelLoaded(epoch: String) {
+        if (epoch == modelEpoch) return
+        
+        NativeResultCache.invalidatePersistent(epoch, LEXICON_VERSION)
+        modelEpoch = epoch
+        try {
+            val cacheDir = File(context.filesDir, "cache").apply { mkdirs() }
+            File(cacheDir, PERSISTENT_CACHE_MODEL_FILENAME).writeText(epoch)
+        } catch (e: IOException) {
+            Timber.w(e, "Could not record the cache model epoch")
+        }
+        Timber.d("Verdict caches moved to model $epoch")
+    }
+
+    /**
+     * Hand the shipped model manifest to the native registry; the built-in
+     * catalog is kept if it is missing or invalid
+     */
+    private fun loadModelManifest() {
+        try {
+            val manifest = context.assets.open(MODEL_MANIFEST_ASSET).bufferedReader().use { it.readText() }
+            if (!LlamaInference.nativeLoadModelManifest(manifest)) {
+                Timber.w("Model manifest rejected, using built-in model list")
+            }
+        } catch (e: IOException) {
+            Timber.w("No model manifest in assets, using built-in model list")
+        }
+    }
+
+    /**
+     * Pick the largest downloaded model that meets the latency and memory budget.
+     * The choice is reused until the manifest, hardware or downloaded files change.
+     * @param benchmark Benchmark the candidates when no stored choice is valid; slow,
+     *                  so only done off the load path
+     * @return Selected model file, or null if none is selected
+     */
+    private fun selectModelFile(benchmark: Boolean): File? {
+        try {
+            val json = LlamaInference.nativeSelectModel(
+                modelsDir = modelDownloadManager.getModelsDirectory().absolutePath,
+                p95LatencyMs = P95_LATENCY_BUDGET_MS,
+                memoryBudgetBytes = MODEL_MEMORY_BUDGET_BYTES,
+                nCtx = DEFAULT_N_CTX,
+                nThreads = DEFAULT_N_THREADS,
+                benchmark = benchmark
+            )
+            if (json.contains("\"success\":true")) {
+                val path = extractJsonValue(json, "path")
+                if (path != null) {
+                    Timber.d("Selected model: $json")
+                    selectedModelFile = File(path)
+                    return File(path)
+                }
+            }
+            Timber.d("No model selected: ${extractJsonValue(json, "error")}")
+        } catch (e: Exception) {
+            Timber.e(e, "Error selecting model")
+        } catch (e: UnsatisfiedLinkError) {
+            Timber.e(e, "Native model selection unavailable")
+        }
+        return null
+    }
+
+    /**
+     * Benchmark the downloaded models in the background and switch to the chosen one
+     * if it differs from the model that was loaded meanwhile. A still-valid stored
+     * choice returns without benchmarking.
+     */
+    private fun scheduleModelSelection() {
+        if (selectionJob?.isActive == true) return
+        
+        selectionJob = selectionScope.launch {
+            val selected = selectModelFile(benchmark = true) ?: return@launch
+            if (selected.absolutePath != modelPath) {
+                Timber.d("Switching to benchmarked model ${selected.name}")
+                switchModel(selected.absolutePath)
+            }
+        }
+    }
+
+    /**
+     * Enable the cascade in the background once a screening model is loaded, if the
+     * manifest lists an escalation model and it is downloaded. The screening model
+     * serves alone until the larger one has loaded.
+     */
+    private fun scheduleCascade() {
+        if (cascadeEnabled || cascadeJob?.isActive == true) return
+        
+        cascadeJob = selectionScope.launch(Dispatchers.IO) {
+            val escalationPath = try {
+                LlamaInference.nativeFindEscalationModel(modelDownloadManager.getModelsDirectory().absolutePath)
+            } catch (e: UnsatisfiedLinkError) {
+                null
+            }
+            if (escalationPath == null) {
+                Timber.d("No escalation model downloaded, screening model serves alone")
+                return@launch
+            }
+            enableCascade(escalationPath)
+        }
+    }
+
+    private fun hasBundledModel(): Boolean = try {
+        context.assets.openFd(BUNDLED_MODEL_ASSET).close()
+        true
+    } catch (e: IOException) {
+        false
+    }
+
+    /**
+     * Load the APK-bundled model; assets opened with openFd are stored uncompressed
+     * (see noCompress in build.gradle.kts), so the range is copied without extraction
+     */
+    private suspend fun loadBundledModel(): Boolean {
+        return context.assets.openFd(BUNDLED_MODEL_ASSET).use { afd ->
+            loadFromFd(
+                afd.parcelFileDescriptor.fd,
+                afd.startOffset,
+                afd.length,
+                MODEL_FILENAME,
+                "asset:$BUNDLED_MODEL_ASSET",
+                File(context.applicationInfo.sourceDir)
+            )
+        }
+    }
+
+    /**
+     * Load a model held in a byte range of an open file; the caller holds inferenceMutex.
+     * An embedded range is copied into no-backup storage rather than cacheDir, which the
+     * OS may clear under storage pressure and force a full recopy on the next load.
+     * @param container File fd was opened from (bundle or APK); its modification time
+     *                  stands in for the model's in the cache epoch
+     */
+    private suspend fun loadFromFd(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        modelName: String,
+        source: String,
+        container: File
+    ): Boolean {
+        Timber.d("Loading model from $source (offset $offset, $length bytes)")
+        val cacheDir = File(context.noBackupFilesDir, "models").apply { mkdirs() }
+        val loadResult = LlamaInference.nativeLoadModelFromFd(
+            fd = fd,
+            offset = offset,
+            length = length,
+            cacheDir = cacheDir.absolutePath,
+            nCtx = DEFAULT_N_CTX,
+            nThreads = DEFAULT_N_THREADS,
+            temperature = DEFAULT_TEMPERATURE
+        )
+        
+        if (!loadResult) {
+            Timber.e("Failed to load model from $source")
+            return false
+        }
+        
+        modelPath = source
+        isModelLoaded = true
+        onModelLoaded(modelEpochOf(modelName, length, container.lastModified()))
+        warmUpModel()
+        scheduleCascade()
+        Timber.d("Model loaded successfully")
+        return true
+    }
+
     /**
      * Get default model file location
      */
     private fun getDefaultModelFile(): File {
+        selectedModelFile?.let { return it }
         val modelsDir = File(context.filesDir, "models")
         return File(modelsDir, MODEL_FILENAME)
     }
@@ -314,11 +960,46 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
     }
 
     /**
-     * Simple JSON value extraction (avoiding dependencies)
+     * Simple JSON value extraction (avoiding dependencies). String values are
+     * read up to their closing quote and unescaped, so free-text reasons and
+     * paths may contain commas, quotes and newlines.
      */
     private fun extractJsonValue(json: String, key: String): String? {
-        val pattern = "\"$key\"\\s*:\\s*\"?([^,}\"]+)\"?".toRegex()
-        return pattern.find(json)?.groupValues?.get(1)
+        val pattern = "\"$key\"\\s*:\\s*(?:\"((?:[^\"\\\\]|\\\\.)*)\"|([^,}\\s]+))".toRegex()
+        val match = pattern.find(json) ?: return null
+        match.groups[1]?.let { return unescapeJson(it.value) }
+        return match.groupValues[2]
+    }
+
+    private fun unescapeJson(value: String): String {
+        if (!value.contains('\\')) return value
+        val out = StringBuilder(value.length)
+        var i = 0
+        while (i < value.length) {
+            val c = value[i]
+            if (c != '\\' || i + 1 >= value.length) {
+                out.append(c)
+                i++
+                continue
+            }
+            when (val escaped = value[i + 1]) {
+                'n' -> out.append('\n')
+                'r' -> out.append('\r')
+                't' -> out.append('\t')
+                'b' -> out.append('\b')
+                'f' -> out.append('\u000C')
+                'u' -> {
+                    val code = value.substring(i + 2, minOf(i + 6, value.length)).toIntOrNull(16)
+                    if (code != null) {
+                        out.append(code.toChar())
+                        i += 4
+                    }
+                }
+                else -> out.append(escaped)
+            }
+            i += 2
+        }
+        return out.toString()
     }
 
     /**
@@ -374,7 +1055,8 @@ Respond with only: PRODUCTIVE or UNPRODUCTIVE
             isProductive = isProductive,
             confidence = confidence,
             reason = reason,
-            processingTimeMs = processingTime
+            processingTimeMs = processingTime,
+            isHeuristic = true
         )
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@ package com.scrollguard.app.service.llm
 
 import android.content.Context
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
@@ -12,7 +13,7 @@ import java.io.FileOutputStream
 import java.io.IOException
 import java.net.HttpURLConnection
 import java.net.URL
-import java.security.MessageDigest
+import kotlin.coroutines.coroutineContext
 
 /**
  * Manages downloading and validation of GGUF models for ScrollGuard.
@@ -22,7 +23,7 @@ class ModelDownloadManager(private val context: Context) {
 
     companion object {
         private const val MODELS_DIR = "models"
-        private const val DOWNLOAD_BUFFER_SIZE = 8192
+        private const val DOWNLOAD_BUFFER_SIZE = 64 * 1024
         private const val CONNECTION_TIMEOUT = 30000 // 30 seconds
         private const val READ_TIMEOUT = 60000 // 60 seconds
         
@@ -65,7 +66,8 @@ class ModelDownloadManager(private val context: Context) {
         val filename: String,
         val url: String,
         val sizeMB: Int,
-        val isRecommended: Boolean
+        val isRecommended: Boolean,
+        val sha256: String = "" // Expected SHA-256 hex digest, empty if not published
     )
 
     data class DownloadProgress(
@@ -138,6 +140,10 @@ class ModelDownloadManager(private val context: Context) {
             )
 
             val modelFile = File(getModelsDirectory(), modelInfo.filename)
+            if (NativeModelDownloader.isSupported()) {
+                return@withContext downloadResumable(modelInfo, modelFile)
+            }
+            
             val tempFile = File(modelFile.absolutePath + ".tmp")
 
             // Clean up any existing temp file
@@ -145,13 +151,16 @@ class ModelDownloadManager(private val context: Context) {
                 tempFile.delete()
             }
 
-            // Download from URL
-            val success = downloadFromUrl(
+            // Download from URL, hashing as the bytes are written
+            val digest = downloadFromUrl(
                 url = modelInfo.url,
                 targetFile = tempFile,
                 expectedSizeBytes = modelInfo.sizeMB * 1024L * 1024L
             )
             
+            Timber.d("Downloaded ${modelInfo.filename} with SHA-256 $digest")
+            val success = modelInfo.sha256.isEmpty() || digest.equals(modelInfo.sha256, ignoreCase = true)
+            
             if (success) {
                 // Move temp file to final location
                 if (tempFile.renameTo(modelFile)) {
@@ -194,10 +203,11 @@ class ModelDownloadManager(private val context: Context) {
                     false
                 }
             } else {
+                Timber.e("Checksum mismatch for ${modelInfo.name}: expected ${modelInfo.sha256}, got $digest")
                 _downloadProgress.value = DownloadProgress(
                     status = DownloadStatus.ERROR,
-                    message = "Download failed",
-                    error = "Failed to download from server"
+                    message = "Model verification failed",
+                    error = "Downloaded file is corrupted or incomplete"
                 )
                 tempFile.delete()
                 false
@@ -215,13 +225,74 @@ class ModelDownloadManager(private val context: Context) {
     }
 
     /**
-     * Download model from URL (real implementation)
+     * Download with the native multi-connection downloader, resuming any partial
+     * download left by an earlier attempt. Cancelling the coroutine keeps the
+     * finished chunks on disk for the next attempt.
+     */
+    private suspend fun downloadResumable(modelInfo: ModelInfo, modelFile: File): Boolean {
+        val job = coroutineContext[Job]
+        val result = NativeModelDownloader.download(
+            url = modelInfo.url,
+            target = modelFile,
+            expectedSha256 = modelInfo.sha256
+        ) { downloadedBytes, totalBytes ->
+            _downloadProgress.value = DownloadProgress(
+                downloadedBytes = downloadedBytes,
+                totalBytes = totalBytes,
+                progressPercent = if (totalBytes > 0) ((downloadedBytes * 100) / totalBytes).toInt() else 0,
+                status = DownloadStatus.DOWNLOADING,
+                message = "Downloading... ${formatFileSize(downloadedBytes)} / ${formatFileSize(totalBytes)}"
+            )
+            job?.isActive != false
+        } ?: return false
+        
+        if (result.cancelled) {
+            _downloadProgress.value = DownloadProgress(
+                status = DownloadStatus.CANCELLED,
+                message = "Download paused"
+            )
+            return false
+        }
+        if (!result.success) {
+            Timber.e("Native download of ${modelInfo.name} failed: ${result.error}")
+            _downloadProgress.value = DownloadProgress(
+                status = DownloadStatus.ERROR,
+                message = if (result.error == "Checksum mismatch") "Model verification failed" else "Download failed",
+                error = result.error
+            )
+            return false
+        }
+        
+        Timber.d("Downloaded ${modelInfo.filename} (${result.fetchedBytes} bytes fetched, resumed=${result.resumed}) with SHA-256 ${result.sha256}")
+        if (!validateModelFile(modelFile)) {
+            _downloadProgress.value = DownloadProgress(
+                status = DownloadStatus.ERROR,
+                message = "Model validation failed",
+                error = "Downloaded file is not a valid GGUF model"
+            )
+            modelFile.delete()
+            return false
+        }
+        
+        _downloadProgress.value = DownloadProgress(
+            downloadedBytes = modelFile.length(),
+            totalBytes = modelFile.length(),
+            progressPercent = 100,
+            status = DownloadStatus.COMPLETED,
+            message = "Download completed successfully"
+        )
+        return true
+    }
+
+    /**
+     * Download model from URL, hashing it in the same pass
+     * @return SHA-256 hex digest of the downloaded file
      */
     private suspend fun downloadFromUrl(
         url: String,
         targetFile: File,
         expectedSizeBytes: Long
-    ): Boolean = withContext(Dispatchers.IO) {
+    ): String = withContext(Dispatchers.IO) {
         try {
             val connection = URL(url).openConnection() as HttpURLConnection
             connection.connectTimeout = CONNECTION_TIMEOUT
@@ -235,34 +306,37 @@ class ModelDownloadManager(private val context: Context) {
             val totalBytes = connection.contentLengthLong
             var downloadedBytes = 0L
 
-            connection.inputStream.use { input ->
-                FileOutputStream(targetFile).use { output ->
-                    val buffer = ByteArray(DOWNLOAD_BUFFER_SIZE)
-                    var bytesRead: Int
-
-                    while (input.read(buffer).also { bytesRead = it } != -1) {
-                        output.write(buffer, 0, bytesRead)
-                        downloadedBytes += bytesRead
-
-                        // Update progress
-                        val progressPercent = if (totalBytes > 0) {
-                            ((downloadedBytes * 100) / totalBytes).toInt()
-                        } else {
-                            0
+            ModelVerifier.newHasher().use { hasher ->
+                connection.inputStream.use { input ->
+                    FileOutputStream(targetFile).use { output ->
+                        val buffer = ByteArray(DOWNLOAD_BUFFER_SIZE)
+                        var bytesRead: Int
+
+                        while (input.read(buffer).also { bytesRead = it } != -1) {
+                            output.write(buffer, 0, bytesRead)
+                            hasher.update(buffer, 0, bytesRead)
+                            downloadedBytes += bytesRead
+
+                            // Update progress
+                            val progressPercent = if (totalBytes > 0) {
+                                ((downloadedBytes * 100) / totalBytes).toInt()
+                            } else {
+                                0
+                            }
+
+                            _downloadProgress.value = DownloadProgress(
+                                downloadedBytes = downloadedBytes,
+                                totalBytes = totalBytes,
+                                progressPercent = progressPercent,
+                                status = DownloadStatus.DOWNLOADING,
+                                message = "Downloading... ${formatFileSize(downloadedBytes)} / ${formatFileSize(totalBytes)}"
+                            )
                         }
-
-                        _downloadProgress.value = DownloadProgress(
-                            downloadedBytes = downloadedBytes,
-                            totalBytes = totalBytes,
-                            progressPercent = progressPercent,
-                            status = DownloadStatus.DOWNLOADING,
-                            message = "Downloading... ${formatFileSize(downloadedBytes)} / ${formatFileSize(totalBytes)}"
-                        )
                     }
                 }
-            }
 
-            true
+                hasher.finish()
+            }
 
         } catch (e: Exception) {
             Timber.e(e, "Error downloading from URL: $url")
@@ -353,23 +427,36 @@ class ModelDownloadManager(private val context: Context) {
     }
 
     /**
-     * Calculate file checksum (SHA-256)
+     * Calculate file checksum (SHA-256) with the native verifier
      */
-    private fun calculateChecksum(file: File): String {
-        return try {
-            val digest = MessageDigest.getInstance("SHA-256")
-            file.inputStream().use { input ->
-                val buffer = ByteArray(DOWNLOAD_BUFFER_SIZE)
-                var bytesRead: Int
-                while (input.read(buffer).also { bytesRead = it } != -1) {
-                    digest.update(buffer, 0, bytesRead)
-                }
-            }
-            digest.digest().joinToString("") { "%02x".format(it) }
-        } catch (e: Exception) {
-            Timber.e(e, "Error calculating checksum")
-            ""
+    private fun calculateChecksum(file: File, listener: ModelVerifier.ProgressListener? = null): String {
+        return ModelVerifier.hashFile(file, listener) ?: ""
+    }
+
+    /**
+     * Verify an already downloaded model against its published checksum, reporting progress
+     * @return true if it matches or no checksum is published
+     */
+    suspend fun verifyModel(modelInfo: ModelInfo): Boolean = withContext(Dispatchers.IO) {
+        if (modelInfo.sha256.isEmpty()) return@withContext true
+        
+        val modelFile = File(getModelsDirectory(), modelInfo.filename)
+        val digest = calculateChecksum(modelFile) { hashed, total ->
+            _downloadProgress.value = DownloadProgress(
+                downloadedBytes = hashed,
+                totalBytes = total,
+                progressPercent = if (total > 0) ((hashed * 100) / total).toInt() else 0,
+                status = DownloadStatus.VALIDATING,
+                message = "Verifying model..."
+            )
+            true
         }
+        
+        val matches = digest.equals(modelInfo.sha256, ignoreCase = true)
+        if (!matches) {
+            Timber.e("Checksum mismatch for ${modelInfo.name}: expected ${modelInfo.sha256}, got $digest")
+        }
+        matches
     }
 
     /**
@@ -378,6 +465,12 @@ class ModelDownloadManager(private val context: Context) {
     fun deleteModel(modelInfo: ModelInfo): Boolean {
         val modelFile = File(getModelsDirectory(), modelInfo.filename)
         return try {
+            NativeModelDownloader.discardPartial(modelFile)
+            // Per-device load profile and requantized variants kept next to the model
+            File(modelFile.absolutePath + ".profile").delete()
+            if (NativeModelDownloader.isSupported()) {
+                LlamaInference.nativeDiscardModelVariants(modelFile.absolutePath)
+            }
             if (modelFile.exists()) {
                 modelFile.delete()
             } else {
@@ -407,7 +500,8 @@ class ModelDownloadManager(private val context: Context) {
     fun clearCache() {
         try {
             getModelsDirectory().listFiles()?.forEach { file ->
-                if (file.name.endsWith(".tmp")) {
+                // Includes partial native downloads (.part) and their chunk records (.chunks)
+                if (file.name.endsWith(".tmp") || file.name.endsWith(".part") || file.name.endsWith(".chunks")) {
                     file.delete()
                 }
             }
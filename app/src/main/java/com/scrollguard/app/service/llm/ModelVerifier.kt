@@ -0,0 +1,131 @@
+package com.scrollguard.app.service.llm
+
+import timber.log.Timber
+import java.io.Closeable
+import java.io.File
+import java.security.MessageDigest
+
+/**
+ * JNI interface for native SHA-256 verification of model files.
+ * Uses ARMv8 SHA2 or SHA-NI instructions when the CPU has them, and can be fed
+ * incrementally while a download is written so verification needs no second pass.
+ */
+object ModelVerifier {
+
+    private val isAvailable: Boolean = try {
+        System.loadLibrary("scrollguard-native")
+        true
+    } catch (e: UnsatisfiedLinkError) {
+        Timber.e(e, "Native model verifier unavailable")
+        false
+    }
+
+    /**
+     * Receives hashing progress; return false to cancel
+     */
+    fun interface ProgressListener {
+        fun onProgress(bytesHashed: Long, totalBytes: Long): Boolean
+    }
+
+    /**
+     * Incremental SHA-256 hasher
+     */
+    interface Hasher : Closeable {
+        fun update(buffer: ByteArray, offset: Int, length: Int)
+
+        /**
+         * Finish and return the lower-case hex digest
+         */
+        fun finish(): String
+    }
+
+    external fun nativeCreate(): Long
+    external fun nativeUpdate(handle: Long, buffer: ByteArray, offset: Int, length: Int)
+    external fun nativeFinish(handle: Long): String
+    external fun nativeDestroy(handle: Long)
+
+    /**
+     * Hash a file in large chunks, overlapping reads with hashing
+     * @return Hex digest, or null on I/O error or cancellation
+     */
+    external fun nativeHashFile(path: String, listener: ProgressListener?): String?
+
+    /**
+     * Name of the native SHA-256 implementation ("armv8-sha2", "sha-ni" or "portable")
+     */
+    external fun nativeBackend(): String
+
+    /**
+     * Create a hasher, falling back to MessageDigest if the native library is missing
+     */
+    fun newHasher(): Hasher = if (isAvailable) NativeHasher(nativeCreate()) else JdkHasher()
+
+    /**
+     * Hash a file with progress reporting
+     * @return Hex digest, or null on error or cancellation
+     */
+    fun hashFile(file: File, listener: ProgressListener? = null): String? {
+        if (isAvailable) {
+            return nativeHashFile(file.absolutePath, listener)
+        }
+        
+        return try {
+            newHasher().use { hasher ->
+                val total = file.length()
+                var hashed = 0L
+                file.inputStream().use { input ->
+                    val buffer = ByteArray(1024 * 1024)
+                    var bytesRead: Int
+                    while (input.read(buffer).also { bytesRead = it } != -1) {
+                        hasher.update(buffer, 0, bytesRead)
+                        hashed += bytesRead
+                        if (listener?.onProgress(hashed, total) == false) return null
+                    }
+                }
+                hasher.finish()
+            }
+        } catch (e: Exception) {
+            Timber.e(e, "Error hashing ${file.absolutePath}")
+            null
+        }
+    }
+
+    /**
+     * Check a file against an expected SHA-256 hex digest
+     */
+    fun verifyFile(file: File, expectedSha256: String, listener: ProgressListener? = null): Boolean {
+        val actual = hashFile(file, listener) ?: return false
+        return actual.equals(expectedSha256, ignoreCase = true)
+    }
+
+    private class NativeHasher(private var handle: Long) : Hasher {
+        override fun update(buffer: ByteArray, offset: Int, length: Int) {
+            check(handle != 0L) { "Hasher is closed" }
+            nativeUpdate(handle, buffer, offset, length)
+        }
+
+        override fun finish(): String {
+            check(handle != 0L) { "Hasher is closed" }
+            return nativeFinish(handle)
+        }
+
+        override fun close() {
+            if (handle != 0L) {
+                nativeDestroy(handle)
+                handle = 0L
+            }
+        }
+    }
+
+    private class JdkHasher : Hasher {
+        private val digest = MessageDigest.getInstance("SHA-256")
+
+        override fun update(buffer: ByteArray, offset: Int, length: Int) {
+            digest.update(buffer, offset, length)
+        }
+
+        override fun finish(): String = digest.digest().joinToString("") { "%02x".format(it) }
+
+        override fun close() {}
+    }
+}
@@ -0,0 +1,172 @@
+package com.scrollguard.app.service.llm
+
+import timber.log.Timber
+import java.io.File
+import java.io.IOException
+import java.net.HttpURLConnection
+import java.net.URL
+
+/**
+ * JNI interface for the native resumable model downloader.
+ * Fetches a model over several concurrent range requests into a preallocated
+ * file, records finished chunks so an interrupted download resumes where it
+ * stopped, hashes as it goes and renames the verified file into place.
+ */
+object NativeModelDownloader {
+
+    private const val DEFAULT_CONNECTIONS = 4
+    private const val CONNECTION_TIMEOUT = 30000 // 30 seconds
+    private const val READ_TIMEOUT = 60000 // 60 seconds
+
+    private val isAvailable: Boolean = try {
+        System.loadLibrary("scrollguard-native")
+        true
+    } catch (e: UnsatisfiedLinkError) {
+        Timber.e(e, "Native model downloader unavailable")
+        false
+    }
+
+    /**
+     * Source of byte ranges; called from native worker threads
+     */
+    interface RangeSource {
+        /**
+         * @return Total size in bytes, or -1 if unknown
+         */
+        fun contentLength(url: String): Long
+
+        /**
+         * @return Exactly [length] bytes starting at [offset], or null on failure
+         */
+        fun fetchRange(url: String, offset: Long, length: Int): ByteArray?
+    }
+
+    /**
+     * Range source over HttpURLConnection, which handles HTTPS and redirects
+     */
+    class HttpRangeSource : RangeSource {
+
+        override fun contentLength(url: String): Long {
+            return try {
+                val connection = openRange(url, 0, 0)
+                try {
+                    when (connection.responseCode) {
+                        HttpURLConnection.HTTP_PARTIAL ->
+                            connection.getHeaderField("Content-Range")?.substringAfterLast('/')?.toLongOrNull() ?: -1L
+                        HttpURLConnection.HTTP_OK -> connection.contentLengthLong
+                        else -> -1L
+                    }
+                } finally {
+                    connection.disconnect()
+                }
+            } catch (e: IOException) {
+                Timber.e(e, "Error sizing $url")
+                -1L
+            }
+        }
+
+        override fun fetchRange(url: String, offset: Long, length: Int): ByteArray? {
+            return try {
+                val connection = openRange(url, offset, offset + length - 1)
+                try {
+                    if (connection.responseCode != HttpURLConnection.HTTP_PARTIAL) {
+                        Timber.w("Range request for $url returned HTTP ${connection.responseCode}")
+                        return null
+                    }
+
+                    val bytes = ByteArray(length)
+                    var filled = 0
+                    connection.inputStream.use { input ->
+                        while (filled < length) {
+                            val read = input.read(bytes, filled, length - filled)
+                            if (read == -1) break
+                            filled += read
+                        }
+                    }
+                    if (filled == length) bytes else null
+                } finally {
+                    connection.disconnect()
+                }
+            } catch (e: IOException) {
+                Timber.w(e, "Range $offset+$length of $url failed")
+                null
+            }
+        }
+
+        private fun openRange(url: String, first: Long, last: Long): HttpURLConnection {
+            val connection = URL(url).openConnection() as HttpURLConnection
+            connection.connectTimeout = CONNECTION_TIMEOUT
+            connection.readTimeout = READ_TIMEOUT
+            connection.setRequestProperty("Range", "bytes=$first-$last")
+            connection.setRequestProperty("Accept-Encoding", "identity")
+            return connection
+        }
+    }
+
+    data class Result(
+        val success: Boolean,
+        val cancelled: Boolean,
+        val resumed: Boolean,
+        val totalBytes: Long,
+        val fetchedBytes: Long,
+        val sha256: String,
+        val error: String?
+    )
+
+    external fun nativeDownload(
+        url: String,
+        targetPath: String,
+        expectedSha256: String?,
+        connections: Int,
+        source: RangeSource?,
+        listener: ModelVerifier.ProgressListener?
+    ): String
+
+    external fun nativeDiscardPartial(targetPath: String)
+
+    /**
+     * Whether downloads can go through the native downloader
+     */
+    fun isSupported(): Boolean = isAvailable
+
+    /**
+     * Download [url] to [target], resuming a previous partial download of the same URL.
+     * Cancelling from [listener] keeps the partial file so the next call picks it up.
+     * @return Result, or null if the native library is unavailable
+     */
+    fun download(
+        url: String,
+        target: File,
+        expectedSha256: String = "",
+        listener: ModelVerifier.ProgressListener? = null,
+        connections: Int = DEFAULT_CONNECTIONS
+    ): Result? {
+        if (!isAvailable) return null
+
+        target.parentFile?.mkdirs()
+        val json = nativeDownload(url, target.absolutePath, expectedSha256, connections, HttpRangeSource(), listener)
+        return Result(
+            success = json.contains("\"success\":true"),
+            cancelled = json.contains("\"cancelled\":true"),
+            resumed = json.contains("\"resumed\":true"),
+            totalBytes = extractJsonValue(json, "total_bytes")?.toLongOrNull() ?: 0L,
+            fetchedBytes = extractJsonValue(json, "fetched_bytes")?.toLongOrNull() ?: 0L,
+            sha256 = extractJsonValue(json, "sha256") ?: "",
+            error = extractJsonValue(json, "error")
+        )
+    }
+
+    /**
+     * Forget an unfinished download of [target]
+     */
+    fun discardPartial(target: File) {
+        if (isAvailable) {
+            nativeDiscardPartial(target.absolutePath)
+        }
+    }
+
+    private fun extractJsonValue(json: String, key: String): String? {
+        val pattern = "\"$key\"\\s*:\\s*\"?([^,}\"]+)\"?".toRegex()
+        return pattern.find(json)?.groupValues?.get(1)
+    }
+}
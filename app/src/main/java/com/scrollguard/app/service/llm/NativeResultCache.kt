@@ -0,0 +1,260 @@
+package com.scrollguard.app.service.llm
+
+import timber.log.Timber
+
+/**
+ * JNI interface for the native classification result cache.
+ * One process-wide cache keyed by a 64-bit content hash, shared by every
+ * classification call site.
+ */
+object NativeResultCache {
+
+    private val isAvailable: Boolean = try {
+        System.loadLibrary("scrollguard-native")
+        true
+    } catch (e: UnsatisfiedLinkError) {
+        Timber.e(e, "Native result cache unavailable")
+        false
+    }
+
+    /**
+     * Hash canonicalized content with the native 64-bit hash.
+     * Volatile tokens (relative times, like/view counts, trailing "See more")
+     * are stripped first using the rules for the app package, so re-renders
+     * of the same post map to the same key.
+     * @param content The text content to hash
+     * @param packageName App package selecting the canonicalization rules ("" for defaults)
+     * @return 64-bit content hash
+     */
+    external fun nativeHashContent(content: String, packageName: String): Long
+
+    /**
+     * Override the canonicalization rules for an app package
+     * @param packageName App package, or "" to replace the default rules
+     * @param countNouns Nouns that mark a preceding number as a volatile counter
+     * @param trailingPhrases Phrases stripped from the end of the text
+     * @param stripRelativeTimes Drop relative timestamps such as "2h" or "5 min ago"
+     * @param stripBareCounts Drop abbreviated counters without a noun such as "1.2K"
+     */
+    external fun nativeSetCanonicalizerRules(
+        packageName: String,
+        countNouns: Array<String>,
+        trailingPhrases: Array<String>,
+        stripRelativeTimes: Boolean,
+        stripBareCounts: Boolean
+    )
+
+    /**
+     * Look up a cached verdict
+     * @param contentHash Hash from [nativeHashContent]
+     * @return Classification JSON (same shape as nativeClassifyContent), or null on miss
+     */
+    external fun nativeLookup(contentHash: Long): String?
+
+    /**
+     * Store a verdict in the cache
+     */
+    external fun nativeInsert(
+        contentHash: Long,
+        isProductive: Boolean,
+        confidence: Float,
+        reason: String,
+        processingTimeMs: Int
+    )
+
+    /**
+     * Warm the cache with stored verdicts in a single call.
+     * Arrays are parallel; newest verdicts first, since loading stops once the budget is reached.
+     * Keys that are already cached keep their current verdict.
+     * @return Number of verdicts inserted
+     */
+    external fun nativePreload(contentHashes: LongArray, isProductive: BooleanArray, confidences: FloatArray): Int
+
+    /**
+     * Set the cache memory budget in bytes
+     */
+    external fun nativeSetByteBudget(byteBudget: Long)
+
+    /**
+     * Get cache statistics as JSON string (hits, misses, evictions, entries, bytes)
+     */
+    external fun nativeGetStats(): String
+
+    /**
+     * Drop all cached verdicts
+     */
+    external fun nativeClear()
+
+    /**
+     * Check the rotating Bloom filter of content known to be productive.
+     * One cache line per check. The filter is cleared when a verdict flips to
+     * unproductive or the model changes; false positives remain possible.
+     * @param contentHash Hash from [nativeHashContent]
+     * @return true if the content was recently classified productive
+     */
+    external fun nativeIsKnownProductive(contentHash: Long): Boolean
+
+    /**
+     * Open the persistent memory-mapped verdict cache that survives restarts
+     * @param path Cache file path
+     * @param modelVersion Identifies the model producing verdicts
+     * @param lexiconVersion Identifies the heuristic keyword lexicon
+     * @return true if the cache file was opened or created
+     */
+    external fun nativeOpenPersistent(path: String, modelVersion: String, lexiconVersion: String): Boolean
+
+    /**
+     * Invalidate persisted verdicts and clear the in-memory tiers after a model or
+     * lexicon change
+     */
+    external fun nativeInvalidatePersistent(modelVersion: String, lexiconVersion: String)
+
+    /**
+     * Synchronously write the persistent cache back to storage
+     */
+    external fun nativeFlushPersistent()
+
+    /**
+     * SimHash fingerprint of canonicalized content for near-duplicate lookup
+     * @return 64-bit fingerprint, or 0 if the text is too short to fingerprint
+     */
+    external fun nativeSimHash(content: String, packageName: String): Long
+
+    /**
+     * Find the verdict of a cached near-duplicate (reposts, lightly edited captions).
+     * Short texts must match more closely than long ones.
+     * @param content The text content, canonicalized and fingerprinted natively
+     * @param packageName App package selecting the canonicalization rules ("" for defaults)
+     * @return Classification JSON with reason "near_duplicate", or null if none is close enough
+     */
+    external fun nativeFindNearDuplicate(content: String, packageName: String): String?
+
+    /**
+     * Index a verdict by fingerprint for near-duplicate reuse
+     */
+    external fun nativeInsertNearDuplicate(fingerprint: Long, isProductive: Boolean, confidence: Float)
+
+    /**
+     * Apply a user correction to the near-duplicate index: verdicts close enough to be
+     * served for the content are dropped and the corrected verdict takes their place
+     * @param content The corrected text, canonicalized and fingerprinted natively
+     * @param packageName App package selecting the canonicalization rules ("" for defaults)
+     */
+    external fun nativeCorrectNearDuplicate(
+        content: String,
+        packageName: String,
+        isProductive: Boolean,
+        confidence: Float
+    )
+
+    /**
+     * Fingerprint content, 0 if too short or the native library is missing
+     */
+    fun simHash(content: String, packageName: String = ""): Long {
+        return if (isAvailable) nativeSimHash(content, packageName) else 0L
+    }
+
+    /**
+     * Find a near-duplicate verdict, null if none or the native library is missing
+     */
+    fun findNearDuplicate(content: String, packageName: String = ""): String? {
+        return if (isAvailable) nativeFindNearDuplicate(content, packageName) else null
+    }
+
+    /**
+     * Index a verdict for near-duplicate reuse if the native library is available
+     */
+    fun insertNearDuplicate(fingerprint: Long, isProductive: Boolean, confidence: Float) {
+        if (isAvailable && fingerprint != 0L) nativeInsertNearDuplicate(fingerprint, isProductive, confidence)
+    }
+
+    /**
+     * Correct near-duplicate verdicts for content if the native library is available
+     */
+    fun correctNearDuplicate(content: String, packageName: String, isProductive: Boolean, confidence: Float) {
+        if (isAvailable) nativeCorrectNearDuplicate(content, packageName, isProductive, confidence)
+    }
+
+    /**
+     * Open the persistent cache if the native library is available
+     */
+    fun openPersistent(path: String, modelVersion: String, lexiconVersion: String): Boolean {
+        return isAvailable && nativeOpenPersistent(path, modelVersion, lexiconVersion)
+    }
+
+    /**
+     * Invalidate persisted verdicts if the native library is available
+     */
+    fun invalidatePersistent(modelVersion: String, lexiconVersion: String) {
+        if (isAvailable) nativeInvalidatePersistent(modelVersion, lexiconVersion)
+    }
+
+    /**
+     * Flush the persistent cache if the native library is available
+     */
+    fun flushPersistent() {
+        if (isAvailable) nativeFlushPersistent()
+    }
+
+    /**
+     * Hash canonicalized content, falling back to String.hashCode() if the native library is missing
+     */
+    fun hash(content: String, packageName: String = ""): Long {
+        return if (isAvailable) nativeHashContent(content, packageName) else content.hashCode().toLong()
+    }
+
+    /**
+     * Check the known-productive filter, false if the native library is missing
+     */
+    fun isKnownProductive(contentHash: Long): Boolean {
+        return isAvailable && nativeIsKnownProductive(contentHash)
+    }
+
+    /**
+     * Look up a cached verdict, null on miss or if the native library is missing
+     */
+    fun lookup(contentHash: Long): String? {
+        return if (isAvailable) nativeLookup(contentHash) else null
+    }
+
+    /**
+     * Store a verdict if the native library is available
+     */
+    fun insert(
+        contentHash: Long,
+        isProductive: Boolean,
+        confidence: Float,
+        reason: String,
+        processingTimeMs: Int
+    ) {
+        if (isAvailable) {
+            nativeInsert(contentHash, isProductive, confidence, reason, processingTimeMs)
+        }
+    }
+
+    /**
+     * Bulk-load stored verdicts if the native library is available
+     */
+    fun preload(contentHashes: LongArray, isProductive: BooleanArray, confidences: FloatArray): Int {
+        return if (isAvailable) nativePreload(contentHashes, isProductive, confidences) else 0
+    }
+
+    /**
+     * Clear the cache if the native library is available
+     */
+    fun clear() {
+        if (isAvailable) nativeClear()
+    }
+
+    /**
+     * Get cache statistics JSON
+     */
+    fun getStats(): String {
+        return if (isAvailable) nativeGetStats() else "{}"
+    }
+
+    /**
+     * Format a content hash as the string key stored in ContentAnalysis.contentHash
+     */
+    fun toHashKey(contentHash: Long): String = java.lang.Long.toHexString(contentHash)
+}
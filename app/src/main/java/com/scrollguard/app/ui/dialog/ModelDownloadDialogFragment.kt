@@ -83,7 +83,13 @@ class ModelDownloadDialogFragment : DialogFragment() {
                 val modelDownloadManager = app.modelDownloadManager
                 val recommendedModel = modelDownloadManager.getRecommendedModel()
                 
-                // Check if model is already downloaded
+                // Check if model is already downloaded; a copy that no longer matches its
+                // published checksum is discarded and downloaded again
+                if (modelDownloadManager.isModelDownloaded(recommendedModel) &&
+                    !modelDownloadManager.verifyModel(recommendedModel)) {
+                    updateProgress("Model is corrupted, downloading again...", 5)
+                    modelDownloadManager.deleteModel(recommendedModel)
+                }
                 if (modelDownloadManager.isModelDownloaded(recommendedModel)) {
                     updateProgress("Model already exists, loading...", 50)
                     val loaded = app.llamaInferenceManager.loadModel()
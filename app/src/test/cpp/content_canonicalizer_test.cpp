@@ -0,0 +1,52 @@
+#include "content_canonicalizer.h"
+#include "test_util.h"
+
+#include <string>
+
+using namespace scrollguard;
+
+namespace {
+
+std::string canonical(const std::string& content, const std::string& package = "") {
+    return ContentCanonicalizer::instance().canonicalize(content, package);
+}
+
+void test_relative_times() {
+    CHECK_EQ(canonical("posted 3d ago great thread"), "posted great thread");
+    CHECK_EQ(canonical("posted 5 years ago great thread"), "posted great thread");
+    CHECK_EQ(canonical("alice \xC2\xB7 3d \xC2\xB7 great thread"), "alice great thread");
+    CHECK_EQ(canonical("great thread 2h"), "great thread");
+    CHECK_EQ(canonical("great thread just now"), "great thread");
+
+    // Outside a timestamp context the same tokens are words
+    CHECK_EQ(canonical("3d printing tutorial"), "3d printing tutorial");
+    CHECK_EQ(canonical("5s workout plan"), "5s workout plan");
+    CHECK_EQ(canonical("I lived there 5 years"), "i lived there 5 years");
+}
+
+void test_counters_and_suffixes() {
+    CHECK_EQ(canonical("great thread 1.2K likes See more"), "great thread");
+    CHECK_EQ(canonical("great thread 2h See more"), "great thread");
+    CHECK_EQ(canonical("I want to read more"), "i want to read more");
+    CHECK_EQ(canonical("give me more"), "give me more");
+    CHECK_EQ(canonical("long thread Show more", "com.twitter.android"), "long thread");
+}
+
+void test_rerenders_share_a_key() {
+    const ContentCanonicalizer& c = ContentCanonicalizer::instance();
+    CHECK_EQ(c.canonical_hash("alice \xC2\xB7 2m \xC2\xB7 hello 12 likes", ""),
+             c.canonical_hash("alice \xC2\xB7 3m \xC2\xB7 hello 13 likes", ""));
+    CHECK(c.canonical_hash("3d printing tutorial", "") != c.canonical_hash("printing tutorial", ""));
+    // Text made only of volatile tokens keeps its own key
+    CHECK(c.canonical_hash("2h", "") != c.canonical_hash("3h", ""));
+}
+
+} // namespace
+
+int main() {
+    test_relative_times();
+    test_counters_and_suffixes();
+    test_rerenders_share_a_key();
+    std::printf("content_canonicalizer_test passed\n");
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include "model_downloader.h"
+#include "sha256.h"
+#include "test_util.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace scrollguard;
+
+namespace {
+
+/**
+ * Loopback HTTP/1.1 server standing in for the model host. Serves one body
+ * with Range support (or plain 200s when ranges are disabled), one request
+ * per connection.
+ */
+class LocalHttpServer {
+public:
+    explicit LocalHttpServer(std::vector<uint8_t> body, bool ranges = true)
+        : body_(std::move(body)), ranges_(ranges) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        CHECK(listen_fd_ >= 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK_EQ(bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+        CHECK_EQ(listen(listen_fd_, 16), 0);
+
+        socklen_t len = sizeof(addr);
+        CHECK_EQ(getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len), 0);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~LocalHttpServer() {
+        stopping_ = true;
+        shutdown(listen_fd_, SHUT_RDWR);
+        close(listen_fd_);
+        thread_.join();
+        while (active_ > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port_) + "/model.gguf"; }
+
+    // Body bytes requested, excluding the one-byte size probes
+    uint64_t bytes_served() const { return bytes_served_.load(); }
+
+private:
+    void serve() {
+        while (!stopping_) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            active_++;
+            std::thread([this, fd] {
+                handle(fd);
+                active_--;
+            }).detach();
+        }
+    }
+
+    void handle(int fd) {
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                close(fd);
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        uint64_t first = 0;
+        uint64_t last = body_.size() - 1;
+        bool ranged = false;
+        size_t range = request.find("Range: bytes=");
+        if (ranges_ && range != std::string::npos) {
+            unsigned long long a = 0, b = 0;
+            if (std::sscanf(request.c_str() + range, "Range: bytes=%llu-%llu", &a, &b) == 2) {
+                first = a;
+                last = std::min<uint64_t>(b, body_.size() - 1);
+                ranged = true;
+            }
+        }
+
+        uint64_t length = last - first + 1;
+        std::string head = ranged ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        if (ranged) {
+            head += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" +
+                    std::to_string(body_.size()) + "\r\n";
+        }
+        head += "Content-Length: " + std::to_string(length) + "\r\nConnection: close\r\n\r\n";
+
+        // Counted before sending so the total is settled once the client has the bytes
+        if (length > 1) {
+            bytes_served_ += length;
+        }
+        send(fd, head.data(), head.size(), MSG_NOSIGNAL);
+        size_t sent = 0;
+        while (sent < length) {
+            ssize_t n = send(fd, body_.data() + first + sent, static_cast<size_t>(length) - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        close(fd);
+    }
+
+    std::vector<uint8_t> body_;
+    bool ranges_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> bytes_served_{0};
+    std::atomic<int> active_{0};
+    std::thread thread_;
+};
+
+std::vector<uint8_t> model_bytes(size_t size) {
+    std::vector<uint8_t> bytes(size);
+    uint32_t x = 0x12345678;
+    for (auto& b : bytes) {
+        x = x * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(x >> 24);
+    }
+    return bytes;
+}
+
+std::string sha256_hex(const std::vector<uint8_t>& bytes) {
+    Sha256 hasher;
+    hasher.update(bytes.data(), bytes.size());
+    return hasher.finish_hex();
+}
+
+std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+bool exists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+DownloadOptions options_for(const LocalHttpServer& server, const std::string& target, const std::string& sha) {
+    DownloadOptions options;
+    options.url = server.url();
+    options.target_path = target;
+    options.expected_sha256 = sha;
+    options.chunk_size = 64 * 1024;
+    options.max_retries = 0;
+    return options;
+}
+
+void test_full_download(const std::string& dir) {
+    std::vector<uint8_t> body = model_bytes(1024 * 1024 + 4321);
+    LocalHttpServer server(body);
+    std::string target = dir + "/full.gguf";
+
+    DownloadResult result = ModelDownloader(std::make_shared<HttpRangeFetcher>())
+        .download(options_for(server, target, sha256_hex(body)));
+    CHECK(result.success);
+    CHECK(!result.resumed);
+    CHECK_EQ(result.total_bytes, body.size());
+    CHECK_EQ(result.fetched_bytes, body.size());
+    CHECK_EQ(result.sha256, sha256_hex(body));
+    CHECK(read_file(target) == body);
+    CHECK(!exists(ModelDownloader::partial_path(target)));
+    CHECK(!exists(ModelDownloader::sidecar_path(target)));
+}
+
+void test_resume(const std::string& dir) {
+    std::vector<uint8_t> body = model_bytes(1024 * 1024 + 99);
+    LocalHttpServer server(body);
+    std::string target = dir + "/resumed.gguf";
+    DownloadOptions options = options_for(server, target, sha256_hex(body));
+    options.connections = 1;
+
+    // Stop once a few chunks are on disk; the partial file and sidecar are kept
+    uint64_t stopped_at = 0;
+    DownloadResult first = ModelDownloader(std::make_shared<HttpRangeFetcher>())
+        .download(options, [&](uint64_t done, uint64_t) {
+            stopped_at = done;
+            return done < 4 * options.chunk_size;
+        });
+    CHECK(first.cancelled);
+    CHECK(!first.success);
+    CHECK(stopped_at >= 4 * options.chunk_size && stopped_at < body.size());
+    CHECK(exists(ModelDownloader::partial_path(target)));
+    CHECK(exists(ModelDownloader::sidecar_path(target)));
+    CHECK(!exists(target));
+
+    uint64_t served_before = server.bytes_served();
+    options.connections = 4;
+    DownloadResult second = ModelDownloader(std::make_shared<HttpRangeFetcher>()).download(options);
+    CHECK(second.success);
+    CHECK(second.resumed);
+    CHECK_EQ(second.fetched_bytes, body.size() - stopped_at);
+    CHECK_EQ(server.bytes_served() - served_before, body.size() - stopped_at);
+    CHECK_EQ(second.sha256, sha256_hex(body));
+    CHECK(read_file(target) == body);
+    CHECK(!exists(ModelDownloader::sidecar_path(target)));
+}
+
+void test_checksum_mismatch(const std::string& dir) {
+    std::vector<uint8_t> body = model_bytes(300 * 1024);
+    LocalHttpServer server(body);
+    std::string target = dir + "/corrupt.gguf";
+
+    DownloadResult result = ModelDownloader(std::make_shared<HttpRangeFetcher>())
+        .download(options_for(server, target, std::string(64, '0')));
+    CHECK(!result.success);
+    CHECK_EQ(result.error, "Checksum mismatch");
+    CHECK_EQ(result.sha256, sha256_hex(body));
+    // Nothing is kept: resuming would only reproduce the same bytes
+    CHECK(!exists(target));
+    CHECK(!exists(ModelDownloader::partial_path(target)));
+    CHECK(!exists(ModelDownloader::sidecar_path(target)));
+}
+
+void test_server_without_ranges(const std::string& dir) {
+    std::vector<uint8_t> body = model_bytes(200 * 1024);
+    LocalHttpServer server(body, false);
+    std::string target = dir + "/no-ranges.gguf";
+
+    DownloadResult result = ModelDownloader(std::make_shared<HttpRangeFetcher>())
+        .download(options_for(server, target, ""));
+    CHECK(!result.success);
+    CHECK(result.error.find("does not support range requests") != std::string::npos);
+    CHECK(!exists(target));
+}
+
+} // namespace
+
+int main() {
+    std::string dir = test::make_temp_dir("model_downloader_test");
+    test_full_download(dir);
+    test_resume(dir);
+    test_checksum_mismatch(dir);
+    test_server_without_ranges(dir);
+    std::printf("model_downloader_test passed\n");
+    return 0;
+}
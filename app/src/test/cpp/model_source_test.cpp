@@ -0,0 +1,233 @@
+#include "model_source.h"
+#include "test_util.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace scrollguard;
+
+namespace {
+
+struct Entry {
+    std::string name;
+    std::vector<uint8_t> data;
+    uint16_t method;
+    uint32_t uncompressed_size;
+    uint16_t local_padding;         // Extra bytes only in the local header, as zipalign adds
+};
+
+void put16(std::vector<uint8_t>* out, uint16_t v) {
+    out->push_back(static_cast<uint8_t>(v));
+    out->push_back(static_cast<uint8_t>(v >> 8));
+}
+
+void put32(std::vector<uint8_t>* out, uint32_t v) {
+    put16(out, static_cast<uint16_t>(v));
+    put16(out, static_cast<uint16_t>(v >> 16));
+}
+
+// Write a zip archive; returns the data offset of each entry
+std::vector<uint64_t> write_zip(const std::string& path, const std::vector<Entry>& entries,
+                                const std::string& comment) {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> central;
+    std::vector<uint64_t> data_offsets;
+
+    for (const Entry& e : entries) {
+        uint32_t local_offset = static_cast<uint32_t>(out.size());
+        put32(&out, 0x04034b50);
+        put16(&out, 20);
+        put16(&out, 0);
+        put16(&out, e.method);
+        put32(&out, 0);                                 // time/date
+        put32(&out, 0);                                 // crc32, not checked
+        put32(&out, static_cast<uint32_t>(e.data.size()));
+        put32(&out, e.uncompressed_size);
+        put16(&out, static_cast<uint16_t>(e.name.size()));
+        put16(&out, e.local_padding);
+        out.insert(out.end(), e.name.begin(), e.name.end());
+        out.insert(out.end(), e.local_padding, 0);
+        data_offsets.push_back(out.size());
+        out.insert(out.end(), e.data.begin(), e.data.end());
+
+        put32(&central, 0x02014b50);
+        put16(&central, 20);
+        put16(&central, 20);
+        put16(&central, 0);
+        put16(&central, e.method);
+        put32(&central, 0);
+        put32(&central, 0);
+        put32(&central, static_cast<uint32_t>(e.data.size()));
+        put32(&central, e.uncompressed_size);
+        put16(&central, static_cast<uint16_t>(e.name.size()));
+        put16(&central, 0);
+        put16(&central, 0);
+        put16(&central, 0);
+        put16(&central, 0);
+        put32(&central, 0);
+        put32(&central, local_offset);
+        central.insert(central.end(), e.name.begin(), e.name.end());
+    }
+
+    uint32_t central_offset = static_cast<uint32_t>(out.size());
+    out.insert(out.end(), central.begin(), central.end());
+    put32(&out, 0x06054b50);
+    put16(&out, 0);
+    put16(&out, 0);
+    put16(&out, static_cast<uint16_t>(entries.size()));
+    put16(&out, static_cast<uint16_t>(entries.size()));
+    put32(&out, static_cast<uint32_t>(central.size()));
+    put32(&out, central_offset);
+    put16(&out, static_cast<uint16_t>(comment.size()));
+    out.insert(out.end(), comment.begin(), comment.end());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return data_offsets;
+}
+
+std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::vector<uint8_t> model_bytes(size_t size, uint8_t seed) {
+    std::vector<uint8_t> bytes(size);
+    const char magic[] = "GGUF";
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = i < 4 ? static_cast<uint8_t>(magic[i]) : static_cast<uint8_t>(i * 31 + seed);
+    }
+    return bytes;
+}
+
+void test_locate_stored_entry(const std::string& dir) {
+    std::string archive = dir + "/bundle.zip";
+    std::vector<uint8_t> model = model_bytes(300000, 7);
+    std::vector<uint64_t> offsets = write_zip(archive, {
+        {"notes.txt", {1, 2, 3}, 8, 40, 0},
+        {"models/tiny.gguf", model, 0, static_cast<uint32_t>(model.size()), 3},
+    }, "bundle comment");
+
+    int fd = open(archive.c_str(), O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+
+    std::string error;
+    ModelSource source;
+    CHECK(zip::locate_stored_entry(fd, "models/tiny.gguf", &source, &error));
+    CHECK_EQ(source.fd, fd);
+    CHECK_EQ(source.offset, offsets[1]);
+    CHECK_EQ(source.length, model.size());
+
+    std::vector<uint8_t> in_place(model.size());
+    CHECK_EQ(pread(fd, in_place.data(), in_place.size(), static_cast<off_t>(source.offset)),
+             static_cast<ssize_t>(in_place.size()));
+    CHECK(in_place == model);
+
+    // Compressed entries cannot be mapped
+    CHECK(!zip::locate_stored_entry(fd, "notes.txt", &source, &error));
+    CHECK(error.find("compressed") != std::string::npos);
+
+    CHECK(!zip::locate_stored_entry(fd, "models/missing.gguf", &source, &error));
+    CHECK(error.find("not found") != std::string::npos);
+
+    close(fd);
+}
+
+void test_not_a_zip(const std::string& dir) {
+    std::string path = dir + "/plain.gguf";
+    std::vector<uint8_t> model = model_bytes(4096, 1);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(model.data()),
+                                                static_cast<std::streamsize>(model.size()));
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+    std::string error;
+    ZipEntryLocation location;
+    CHECK(!zip::locate_entry(fd, "models/tiny.gguf", &location, &error));
+    CHECK(error.find("not a zip") != std::string::npos);
+    close(fd);
+}
+
+void test_resolve_whole_file(const std::string& dir) {
+    std::string path = dir + "/whole.gguf";
+    std::vector<uint8_t> model = model_bytes(8192, 2);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(model.data()),
+                                                static_cast<std::streamsize>(model.size()));
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+    ModelSource source{fd, 0, model.size()};
+    std::string resolved;
+    std::string error;
+    CHECK(model_source::resolve_loadable_path(source, dir + "/unused", &resolved, &error));
+    CHECK_EQ(resolved, "/proc/self/fd/" + std::to_string(fd));
+
+    ModelSource past_end{fd, 100, model.size()};
+    CHECK(!model_source::resolve_loadable_path(past_end, dir, &resolved, &error));
+    close(fd);
+}
+
+void test_resolve_embedded(const std::string& dir) {
+    std::string archive = dir + "/embedded.zip";
+    std::string copies = dir + "/copies";
+    CHECK_EQ(mkdir(copies.c_str(), 0700), 0);
+
+    std::vector<uint8_t> model = model_bytes(2 * 1024 * 1024 + 123, 3);
+    write_zip(archive, {{"model.gguf", model, 0, static_cast<uint32_t>(model.size()), 0}}, "");
+
+    int fd = open(archive.c_str(), O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+    std::string error;
+    ModelSource source;
+    CHECK(zip::locate_stored_entry(fd, "model.gguf", &source, &error));
+
+    std::string first;
+    CHECK(model_source::resolve_loadable_path(source, copies, &first, &error));
+    CHECK_EQ(first.compare(0, copies.size() + 10, copies + "/embedded-"), 0);
+    CHECK(read_file(first) == model);
+    CHECK(access((first + ".tmp").c_str(), F_OK) != 0);
+
+    // The copy is reused while the archive is unchanged
+    struct stat before;
+    CHECK_EQ(stat(first.c_str(), &before), 0);
+    std::string second;
+    CHECK(model_source::resolve_loadable_path(source, copies, &second, &error));
+    CHECK_EQ(second, first);
+    struct stat after;
+    CHECK_EQ(stat(second.c_str(), &after), 0);
+    CHECK_EQ(before.st_ino, after.st_ino);
+    close(fd);
+
+    // A new archive version gets a fresh copy and the stale one is removed
+    std::vector<uint8_t> updated = model_bytes(1024 * 1024 + 77, 4);
+    unlink(archive.c_str());
+    write_zip(archive, {{"model.gguf", updated, 0, static_cast<uint32_t>(updated.size()), 5}}, "v2");
+    fd = open(archive.c_str(), O_RDONLY | O_CLOEXEC);
+    CHECK(fd >= 0);
+    CHECK(zip::locate_stored_entry(fd, "model.gguf", &source, &error));
+    std::string third;
+    CHECK(model_source::resolve_loadable_path(source, copies, &third, &error));
+    CHECK(third != first);
+    CHECK(read_file(third) == updated);
+    CHECK(access(first.c_str(), F_OK) != 0);
+    close(fd);
+}
+
+} // namespace
+
+int main() {
+    std::string dir = test::make_temp_dir("model_source_test");
+    test_locate_stored_entry(dir);
+    test_not_a_zip(dir);
+    test_resolve_whole_file(dir);
+    test_resolve_embedded(dir);
+    std::printf("model_source_test passed\n");
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "persistent_cache.h"
+#include "test_util.h"
+
+#include <cstdint>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace scrollguard;
+
+namespace {
+
+constexpr uint32_t kCapacity = 64;
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kSlotSize = 32;
+
+std::string cache_path(const char* name) {
+    return test::make_temp_dir(name) + "/verdicts.cache";
+}
+
+bool cached(const PersistentCache& cache, uint64_t key, PersistentVerdict* out = nullptr) {
+    return cache.lookup(key, out);
+}
+
+void test_insert_and_lookup() {
+    PersistentCache cache;
+    CHECK(!cache.is_open());
+    CHECK(!cached(cache, 1));
+    CHECK(!cache.insert(1, true, 0.9f, 100));
+
+    CHECK(cache.open(cache_path("pcache-basic"), "model-a", "lexicon-1", kCapacity));
+    CHECK(cache.is_open());
+    CHECK(cache.get_epoch() != 0);
+
+    CHECK(cache.insert(1, true, 0.9f, 100));
+    CHECK(cache.insert(2, false, 0.75f, 200));
+    PersistentVerdict verdict;
+    CHECK(cached(cache, 1, &verdict));
+    CHECK(verdict.is_productive);
+    CHECK_EQ(verdict.confidence, 0.9f);
+    CHECK_EQ(verdict.timestamp_ms, 100);
+    CHECK_EQ(verdict.model_version, cache.get_epoch());
+    CHECK(cached(cache, 2, &verdict));
+    CHECK(!verdict.is_productive);
+    CHECK(!cached(cache, 3));
+
+    // A second verdict for a key replaces the first
+    CHECK(cache.insert(2, true, 0.6f, 300));
+    CHECK(cached(cache, 2, &verdict));
+    CHECK(verdict.is_productive);
+    CHECK_EQ(verdict.timestamp_ms, 300);
+}
+
+void test_capacity_must_be_a_power_of_two() {
+    PersistentCache cache;
+    CHECK(!cache.open(cache_path("pcache-capacity"), "model-a", "lexicon-1", 48));
+    CHECK(!cache.open(cache_path("pcache-capacity"), "model-a", "lexicon-1", 0));
+    CHECK(!cache.is_open());
+}
+
+void test_epoch_invalidation() {
+    PersistentCache cache;
+    CHECK(cache.open(cache_path("pcache-epoch"), "model-a", "lexicon-1", kCapacity));
+    uint32_t epoch = cache.get_epoch();
+    CHECK(cache.insert(1, true, 0.9f, 100));
+
+    CHECK(!cache.invalidate("model-a", "lexicon-1"));
+    CHECK(cached(cache, 1));
+
+    CHECK(cache.invalidate("model-a", "lexicon-2"));
+    CHECK(cache.get_epoch() != epoch);
+    CHECK(!cached(cache, 1));
+
+    // Stale slots are reused by new verdicts
+    CHECK(cache.insert(1, false, 0.8f, 200));
+    PersistentVerdict verdict;
+    CHECK(cached(cache, 1, &verdict));
+    CHECK(!verdict.is_productive);
+
+    // Going back to an old epoch does not revive what it wrote
+    CHECK(cache.insert(2, true, 0.9f, 300));
+    CHECK(cache.invalidate("model-b", "lexicon-2"));
+    CHECK(cache.invalidate("model-a", "lexicon-2"));
+    CHECK(cached(cache, 1));
+    CHECK(cached(cache, 2));
+    CHECK(cache.invalidate("model-a", "lexicon-1"));
+    CHECK(!cached(cache, 1));
+    CHECK(!cached(cache, 2));
+}
+
+void test_probe_overflow() {
+    PersistentCache cache;
+    CHECK(cache.open(cache_path("pcache-probe"), "model-a", "lexicon-1", kCapacity));
+
+    // Every key starts probing at slot 5
+    auto colliding = [](uint64_t i) { return i * kCapacity + 5; };
+    for (uint64_t i = 0; i < PersistentCache::kMaxProbes; i++) {
+        CHECK(cache.insert(colliding(i), true, 0.9f, static_cast<int64_t>(100 + i)));
+    }
+    for (uint64_t i = 0; i < PersistentCache::kMaxProbes; i++) {
+        CHECK(cached(cache, colliding(i)));
+    }
+
+    // A full probe window evicts its oldest verdict
+    uint64_t extra = colliding(PersistentCache::kMaxProbes);
+    CHECK(cache.insert(extra, false, 0.7f, 1000));
+    CHECK(cached(cache, extra));
+    CHECK(!cached(cache, colliding(0)));
+    for (uint64_t i = 1; i < PersistentCache::kMaxProbes; i++) {
+        CHECK(cached(cache, colliding(i)));
+    }
+
+    // A key homed inside the window probes past it into a free slot
+    CHECK(cache.insert(6, true, 0.9f, 2000));
+    CHECK(cached(cache, 6));
+    CHECK(cached(cache, extra));
+    for (uint64_t i = 1; i < PersistentCache::kMaxProbes; i++) {
+        CHECK(cached(cache, colliding(i)));
+    }
+}
+
+void test_reopen_existing_file() {
+    std::string path = cache_path("pcache-reopen");
+    uint32_t epoch;
+    {
+        PersistentCache cache;
+        CHECK(cache.open(path, "model-a", "lexicon-1", kCapacity));
+        epoch = cache.get_epoch();
+        CHECK(cache.insert(1, true, 0.9f, 100));
+        CHECK(cache.insert(2, false, 0.8f, 200));
+        cache.close();
+        CHECK(!cache.is_open());
+        CHECK(!cached(cache, 1));
+    }
+
+    struct stat st;
+    CHECK_EQ(stat(path.c_str(), &st), 0);
+    CHECK_EQ(static_cast<size_t>(st.st_size), kHeaderSize + kCapacity * kSlotSize);
+
+    PersistentCache cache;
+    // The file keeps its own capacity
+    CHECK(cache.open(path, "model-a", "lexicon-1", 2 * kCapacity));
+    CHECK_EQ(cache.get_epoch(), epoch);
+    PersistentVerdict verdict;
+    CHECK(cached(cache, 1, &verdict));
+    CHECK(verdict.is_productive);
+    CHECK_EQ(verdict.timestamp_ms, 100);
+    CHECK(cached(cache, 2, &verdict));
+    CHECK(!verdict.is_productive);
+    cache.close();
+    CHECK_EQ(stat(path.c_str(), &st), 0);
+    CHECK_EQ(static_cast<size_t>(st.st_size), kHeaderSize + kCapacity * kSlotSize);
+
+    // Opening for another model keeps the file but misses its verdicts
+    CHECK(cache.open(path, "model-b", "lexicon-1", kCapacity));
+    CHECK(cache.get_epoch() != epoch);
+    CHECK(!cached(cache, 1));
+    CHECK(!cached(cache, 2));
+    cache.close();
+}
+
+void test_torn_and_corrupt_files() {
+    std::string path = cache_path("pcache-torn");
+    {
+        PersistentCache cache;
+        CHECK(cache.open(path, "model-a", "lexicon-1", kCapacity));
+        CHECK(cache.insert(3, true, 0.9f, 100));
+        CHECK(cache.insert(4, true, 0.9f, 100));
+    }
+
+    // A write interrupted by a crash leaves an odd sequence in the slot
+    int fd = open(path.c_str(), O_RDWR);
+    CHECK(fd >= 0);
+    uint32_t seq = 0;
+    off_t seq_offset = static_cast<off_t>(kHeaderSize + 3 * kSlotSize);
+    CHECK_EQ(pread(fd, &seq, sizeof(seq), seq_offset), static_cast<ssize_t>(sizeof(seq)));
+    seq |= 1u;
+    CHECK_EQ(pwrite(fd, &seq, sizeof(seq), seq_offset), static_cast<ssize_t>(sizeof(seq)));
+    close(fd);
+
+    {
+        PersistentCache cache;
+        CHECK(cache.open(path, "model-a", "lexicon-1", kCapacity));
+        CHECK(!cached(cache, 3));
+        CHECK(cached(cache, 4));
+        CHECK(cache.insert(3, false, 0.6f, 200));
+        PersistentVerdict verdict;
+        CHECK(cached(cache, 3, &verdict));
+        CHECK(!verdict.is_productive);
+    }
+
+    // A file whose size does not match its header is rebuilt
+    CHECK_EQ(truncate(path.c_str(), static_cast<off_t>(kHeaderSize + 10 * kSlotSize)), 0);
+    PersistentCache cache;
+    CHECK(cache.open(path, "model-a", "lexicon-1", kCapacity));
+    CHECK(!cached(cache, 3));
+    CHECK(!cached(cache, 4));
+    CHECK(cache.insert(4, true, 0.9f, 300));
+    CHECK(cached(cache, 4));
+}
+
+} // namespace
+
+int main() {
+    test_insert_and_lookup();
+    test_capacity_must_be_a_power_of_two();
+    test_epoch_invalidation();
+    test_probe_overflow();
+    test_reopen_existing_file();
+    test_torn_and_corrupt_files();
+    std::printf("persistent_cache_test passed\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "prefix_tree.h"
+#include "test_util.h"
+
+#include <vector>
+
+using namespace scrollguard;
+
+namespace {
+
+using Tokens = std::vector<TokenPrefixTree::Token>;
+
+size_t lookup(const TokenPrefixTree& tree, const Tokens& tokens, int* slot) {
+    *slot = -1;
+    return tree.longest_prefix(tokens.data(), tokens.size(), slot);
+}
+
+void insert(TokenPrefixTree* tree, int slot, const Tokens& tokens) {
+    tree->insert(slot, tokens.data(), tokens.size());
+}
+
+void test_longest_prefix() {
+    TokenPrefixTree tree;
+    int slot = -1;
+    CHECK_EQ(lookup(tree, {1, 2, 3}, &slot), 0u);
+
+    insert(&tree, 0, {1, 2, 3, 4});
+    insert(&tree, 1, {1, 2, 5});
+    CHECK_EQ(tree.slot_count(), 2u);
+    CHECK_EQ(lookup(tree, {1, 2, 3, 4, 9}, &slot), 4u);
+    CHECK_EQ(slot, 0);
+    CHECK_EQ(lookup(tree, {1, 2, 5, 6}, &slot), 3u);
+    CHECK_EQ(slot, 1);
+    CHECK_EQ(lookup(tree, {1, 2, 3, 7}, &slot), 3u);
+    CHECK_EQ(slot, 0);
+    // Both slots hold the shared head
+    CHECK_EQ(lookup(tree, {1, 2, 9}, &slot), 2u);
+    CHECK(slot == 0 || slot == 1);
+    CHECK_EQ(lookup(tree, {9, 1, 2}, &slot), 0u);
+    CHECK_EQ(lookup(tree, {1, 2, 3}, &slot), 3u);
+}
+
+void test_sequence_ending_inside_an_edge() {
+    TokenPrefixTree tree;
+    int slot = -1;
+    insert(&tree, 0, {1, 2, 3, 4, 5});
+    insert(&tree, 1, {1, 2, 3});
+    CHECK_EQ(lookup(tree, {1, 2, 3, 4, 5}, &slot), 5u);
+    CHECK_EQ(slot, 0);
+
+    // The shorter sequence survives the longer one
+    tree.erase(0);
+    CHECK_EQ(lookup(tree, {1, 2, 3, 4, 5}, &slot), 3u);
+    CHECK_EQ(slot, 1);
+}
+
+void test_erase_shared_branch() {
+    TokenPrefixTree tree;
+    int slot = -1;
+    insert(&tree, 0, {1, 2, 3, 4});
+    insert(&tree, 1, {1, 2, 5, 6});
+    insert(&tree, 2, {1, 2, 5, 7});
+
+    // Removing one side of the fork under {1, 2, 5} merges the other back into one edge
+    tree.erase(1);
+    CHECK_EQ(lookup(tree, {1, 2, 5, 6}, &slot), 3u);
+    CHECK_EQ(slot, 2);
+    CHECK_EQ(lookup(tree, {1, 2, 5, 7}, &slot), 4u);
+    CHECK_EQ(slot, 2);
+
+    // Then the whole branch; the remaining sequence is one edge from the root
+    tree.erase(2);
+    CHECK_EQ(lookup(tree, {1, 2, 5, 7}, &slot), 2u);
+    CHECK_EQ(slot, 0);
+    CHECK_EQ(lookup(tree, {1, 2, 3, 4}, &slot), 4u);
+    CHECK_EQ(slot, 0);
+    CHECK_EQ(tree.slot_count(), 1u);
+
+    // Merged edges still split and erase on their boundaries
+    insert(&tree, 3, {1, 2, 3, 8});
+    CHECK_EQ(lookup(tree, {1, 2, 3, 8}, &slot), 4u);
+    CHECK_EQ(slot, 3);
+    tree.erase(0);
+    CHECK_EQ(lookup(tree, {1, 2, 3, 4}, &slot), 3u);
+    CHECK_EQ(slot, 3);
+    tree.erase(3);
+    CHECK_EQ(lookup(tree, {1, 2, 3, 4}, &slot), 0u);
+    CHECK_EQ(tree.slot_count(), 0u);
+}
+
+void test_insert_replaces_slot() {
+    TokenPrefixTree tree;
+    int slot = -1;
+    insert(&tree, 0, {1, 2, 3});
+    insert(&tree, 0, {4, 5});
+    CHECK_EQ(tree.slot_count(), 1u);
+    CHECK_EQ(lookup(tree, {1, 2, 3}, &slot), 0u);
+    CHECK_EQ(lookup(tree, {4, 5}, &slot), 2u);
+    CHECK_EQ(slot, 0);
+    CHECK(tree.tokens_of(0) == Tokens({4, 5}));
+
+    // An empty sequence only forgets the slot
+    insert(&tree, 0, {});
+    CHECK_EQ(tree.slot_count(), 0u);
+    CHECK(tree.tokens_of(0).empty());
+    CHECK_EQ(lookup(tree, {4, 5}, &slot), 0u);
+}
+
+void test_erase_and_clear() {
+    TokenPrefixTree tree;
+    int slot = -1;
+    tree.erase(7);  // Unknown slots are ignored
+
+    insert(&tree, 0, {1, 2});
+    insert(&tree, 1, {3, 4});
+    tree.clear();
+    CHECK_EQ(tree.slot_count(), 0u);
+    CHECK_EQ(lookup(tree, {1, 2}, &slot), 0u);
+    CHECK_EQ(lookup(tree, {3, 4}, &slot), 0u);
+
+    insert(&tree, 1, {1, 2});
+    CHECK_EQ(lookup(tree, {1, 2}, &slot), 2u);
+    CHECK_EQ(slot, 1);
+}
+
+} // namespace
+
+int main() {
+    test_longest_prefix();
+    test_sequence_ending_inside_an_edge();
+    test_erase_shared_branch();
+    test_insert_replaces_slot();
+    test_erase_and_clear();
+    std::printf("prefix_tree_test passed\n");
+    return 0;
+}
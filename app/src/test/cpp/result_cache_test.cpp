@@ -0,0 +1,141 @@
+#include "result_cache.h"
+#include "test_util.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace scrollguard;
+
+namespace {
+
+// Keys below 2^60 all land in shard 0
+constexpr uint64_t kShardZero = 0;
+constexpr uint64_t kShardOne = 1ull << 60;
+
+CachedVerdict verdict(bool is_productive, float confidence, const std::string& reason = "label") {
+    CachedVerdict v;
+    v.is_productive = is_productive;
+    v.confidence = confidence;
+    v.reason = reason;
+    v.processing_time_ms = 12;
+    return v;
+}
+
+// Bytes one verdict with reason is charged
+size_t cost_of(const std::string& reason) {
+    ResultCache cache;
+    cache.insert(1, verdict(true, 0.9f, reason));
+    return cache.get_stats().bytes;
+}
+
+void test_insert_and_lookup() {
+    ResultCache cache;
+    CachedVerdict out;
+    CHECK(!cache.lookup(1, &out));
+
+    cache.insert(1, verdict(true, 0.9f, "news"));
+    cache.insert(kShardOne | 1, verdict(false, 0.7f));
+    CHECK(cache.lookup(1, &out));
+    CHECK(out.is_productive);
+    CHECK_EQ(out.confidence, 0.9f);
+    CHECK_EQ(out.reason, "news");
+    CHECK_EQ(out.processing_time_ms, 12);
+    CHECK(cache.lookup(kShardOne | 1, &out));
+    CHECK(!out.is_productive);
+
+    // A second verdict for a key replaces the first
+    cache.insert(1, verdict(false, 0.6f, "a much longer reason"));
+    CHECK(cache.lookup(1, &out));
+    CHECK(!out.is_productive);
+    CHECK_EQ(out.reason, "a much longer reason");
+
+    CacheStats stats = cache.get_stats();
+    CHECK_EQ(stats.entries, 2u);
+    CHECK_EQ(stats.insertions, 2u);
+    CHECK_EQ(stats.hits, 3u);
+    CHECK_EQ(stats.misses, 1u);
+    CHECK_EQ(stats.bytes, cost_of("a much longer reason") + cost_of("label"));
+    CHECK_EQ(stats.byte_budget, ResultCache::kDefaultByteBudget);
+
+    cache.erase(1);
+    CHECK(!cache.lookup(1, nullptr));
+    CHECK_EQ(cache.get_stats().bytes, cost_of("label"));
+
+    cache.clear();
+    stats = cache.get_stats();
+    CHECK_EQ(stats.entries, 0u);
+    CHECK_EQ(stats.bytes, 0u);
+    CHECK(!cache.lookup(kShardOne | 1, nullptr));
+}
+
+void test_clock_eviction() {
+    size_t cost = cost_of("label");
+    ResultCache cache(3 * cost * ResultCache::kShardCount);
+    for (uint64_t key = 1; key <= 3; key++) {
+        cache.insert(kShardZero | key, verdict(true, 0.9f));
+    }
+    CHECK_EQ(cache.get_stats().entries, 3u);
+
+    // A hit survives the next sweep; the oldest unreferenced entry goes
+    CHECK(cache.lookup(1, nullptr));
+    cache.insert(4, verdict(true, 0.9f));
+    CacheStats stats = cache.get_stats();
+    CHECK_EQ(stats.entries, 3u);
+    CHECK_EQ(stats.evictions, 1u);
+    CHECK(stats.bytes <= 3 * cost);
+    CHECK(cache.lookup(1, nullptr));
+    CHECK(!cache.lookup(2, nullptr));
+    CHECK(cache.lookup(3, nullptr));
+    CHECK(cache.lookup(4, nullptr));
+
+    // Other shards have their own budget
+    cache.insert(kShardOne | 1, verdict(true, 0.9f));
+    CHECK(cache.lookup(kShardOne | 1, nullptr));
+    CHECK_EQ(cache.get_stats().entries, 4u);
+
+    // A verdict larger than a shard's budget is not cached
+    cache.insert(5, verdict(true, 0.9f, std::string(4 * cost, 'x')));
+    CHECK(!cache.lookup(5, nullptr));
+    CHECK(cache.lookup(1, nullptr));
+
+    // Shrinking the budget evicts down to it
+    cache.set_byte_budget(cost * ResultCache::kShardCount);
+    stats = cache.get_stats();
+    CHECK_EQ(stats.entries, 2u);
+    CHECK(stats.bytes <= 2 * cost);
+}
+
+void test_preload() {
+    size_t cost = cost_of("stored");
+    ResultCache cache(3 * cost * ResultCache::kShardCount);
+    cache.insert(1, verdict(false, 0.5f, "stored"));
+
+    const uint64_t keys[] = {1, 2, kShardOne | 2, 3, 4};
+    const uint8_t productive[] = {1, 1, 0, 1, 1};
+    const float confidences[] = {0.9f, 0.8f, 0.7f, 0.6f, 0.5f};
+
+    // Cached keys are kept, and shard 0 fills after two more
+    CHECK_EQ(cache.preload(keys, productive, confidences, 5, "stored"), 3u);
+    CachedVerdict out;
+    CHECK(cache.lookup(1, &out));
+    CHECK(!out.is_productive);
+    CHECK(cache.lookup(2, &out));
+    CHECK(out.is_productive);
+    CHECK_EQ(out.confidence, 0.8f);
+    CHECK_EQ(out.reason, "stored");
+    CHECK(cache.lookup(kShardOne | 2, &out));
+    CHECK(!out.is_productive);
+    CHECK(cache.lookup(3, nullptr));
+    CHECK(!cache.lookup(4, nullptr));
+    CHECK_EQ(cache.get_stats().evictions, 0u);
+}
+
+} // namespace
+
+int main() {
+    test_insert_and_lookup();
+    test_clock_eviction();
+    test_preload();
+    std::printf("result_cache_test passed\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "sequence_checkpoint.h"
+#include "test_util.h"
+
+#include <string>
+
+using namespace scrollguard;
+
+namespace {
+
+SequenceCheckpoint checkpoint(size_t state_bytes, size_t n_past = 4) {
+    SequenceCheckpoint c;
+    c.tokens = {1, 2, 3, 4};
+    c.n_past = n_past;
+    c.state.assign(state_bytes, 0xAB);
+    return c;
+}
+
+// Bytes a checkpoint of state_bytes is charged under a one-character key
+size_t cost_of(size_t state_bytes) {
+    SequenceCheckpointStore store(1 << 20);
+    store.put("k", checkpoint(state_bytes));
+    return store.bytes();
+}
+
+void test_take_moves_the_checkpoint() {
+    SequenceCheckpointStore store;
+    store.put("a", checkpoint(100, 7));
+    CHECK_EQ(store.size(), 1u);
+    CHECK(store.bytes() > 100);
+
+    SequenceCheckpoint out;
+    CHECK(store.take("a", &out));
+    CHECK_EQ(out.n_past, 7u);
+    CHECK_EQ(out.state.size(), 100u);
+    CHECK_EQ(out.tokens.size(), 4u);
+    CHECK_EQ(store.size(), 0u);
+    CHECK_EQ(store.bytes(), 0u);
+    CHECK(!store.take("a", &out));
+}
+
+void test_put_replaces() {
+    SequenceCheckpointStore store;
+    store.put("a", checkpoint(100));
+    store.put("a", checkpoint(200, 9));
+    CHECK_EQ(store.size(), 1u);
+    CHECK_EQ(store.bytes(), cost_of(200));
+
+    SequenceCheckpoint out;
+    CHECK(store.take("a", &out));
+    CHECK_EQ(out.n_past, 9u);
+}
+
+void test_budget_evicts_oldest() {
+    size_t cost = cost_of(1000);
+    SequenceCheckpointStore store(3 * cost);
+    store.put("a", checkpoint(1000));
+    store.put("b", checkpoint(1000));
+    store.put("c", checkpoint(1000));
+    CHECK_EQ(store.size(), 3u);
+    CHECK_EQ(store.bytes(), 3 * cost);
+
+    store.put("d", checkpoint(1000));
+    CHECK_EQ(store.size(), 3u);
+    CHECK(store.bytes() <= store.byte_budget());
+    SequenceCheckpoint out;
+    CHECK(!store.take("a", &out));
+
+    // Storing again makes a key the newest
+    store.put("b", checkpoint(1000));
+    store.put("e", checkpoint(1000));
+    CHECK(!store.take("c", &out));
+    CHECK(store.take("b", &out));
+    CHECK(store.take("d", &out));
+    CHECK(store.take("e", &out));
+    CHECK_EQ(store.bytes(), 0u);
+}
+
+void test_oversized_checkpoint_is_dropped() {
+    size_t cost = cost_of(1000);
+    SequenceCheckpointStore store(2 * cost);
+    store.put("a", checkpoint(1000));
+    store.put("b", checkpoint(10 * 1000));
+    CHECK_EQ(store.size(), 1u);
+    SequenceCheckpoint out;
+    CHECK(!store.take("b", &out));
+
+    // A too-large replacement still drops the stale checkpoint it replaces
+    store.put("a", checkpoint(10 * 1000));
+    CHECK_EQ(store.size(), 0u);
+    CHECK_EQ(store.bytes(), 0u);
+}
+
+void test_shrinking_budget() {
+    size_t cost = cost_of(1000);
+    SequenceCheckpointStore store(4 * cost);
+    store.put("a", checkpoint(1000));
+    store.put("b", checkpoint(1000));
+    store.put("c", checkpoint(1000));
+
+    store.set_byte_budget(cost);
+    CHECK_EQ(store.size(), 1u);
+    SequenceCheckpoint out;
+    CHECK(store.take("c", &out));
+
+    store.put("d", checkpoint(1000));
+    store.set_byte_budget(0);
+    CHECK_EQ(store.size(), 0u);
+    CHECK_EQ(store.bytes(), 0u);
+    store.put("e", checkpoint(1));
+    CHECK_EQ(store.size(), 0u);
+
+    store.put("f", checkpoint(1000));
+    store.clear();
+    CHECK_EQ(store.bytes(), 0u);
+}
+
+} // namespace
+
+int main() {
+    test_take_moves_the_checkpoint();
+    test_put_replaces();
+    test_budget_evicts_oldest();
+    test_oversized_checkpoint_is_dropped();
+    test_shrinking_budget();
+    std::printf("sequence_checkpoint_test passed\n");
+    return 0;
+}
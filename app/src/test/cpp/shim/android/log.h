@@ -0,0 +1,16 @@
+// Host stand-in for the NDK logging header so native sources build off-device.
+
+#ifndef SCROLLGUARD_TEST_ANDROID_LOG_H
+#define SCROLLGUARD_TEST_ANDROID_LOG_H
+
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+};
+
+inline int __android_log_print(int, const char*, const char*, ...) { return 0; }
+
+#endif // SCROLLGUARD_TEST_ANDROID_LOG_H
@@ -0,0 +1,133 @@
+#include "simhash_index.h"
+#include "test_util.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace scrollguard;
+
+namespace {
+
+// fingerprint with the lowest n bits flipped
+uint64_t flipped(uint64_t fingerprint, int n) {
+    return fingerprint ^ ((1ull << n) - 1);
+}
+
+void test_fingerprints() {
+    uint64_t fingerprint = 0;
+    size_t words = 0;
+    CHECK(!simhash::compute("too short to fingerprint", &fingerprint, &words));
+    CHECK_EQ(words, 4u);
+
+    const std::string caption =
+        "we spent the whole weekend rebuilding the old bridge over the river with the neighbours "
+        "and it finally opened to cars again this morning after three long years of waiting";
+    const std::string edited =
+        "we spent the whole weekend rebuilding the old bridge over the river with our neighbours "
+        "and it finally opened to cars again this morning after three long years of waiting";
+    const std::string unrelated =
+        "ten minute pasta recipe with garlic butter lemon and parmesan that my kids actually eat "
+        "every single time I make it for dinner on busy school nights";
+    uint64_t a = 0, b = 0, c = 0;
+    CHECK(simhash::compute(caption, &a, &words));
+    CHECK_EQ(words, 30u);
+    CHECK(simhash::compute(edited, &b));
+    CHECK(simhash::compute(unrelated, &c));
+
+    uint64_t again = 0;
+    CHECK(simhash::compute(caption, &again));
+    CHECK_EQ(again, a);
+    CHECK(simhash::hamming_distance(a, b) <= simhash::max_distance_for(words));
+    CHECK(simhash::hamming_distance(a, c) > SimHashIndex::kDefaultMaxDistance);
+
+    CHECK_EQ(simhash::max_distance_for(6), 2);
+    CHECK_EQ(simhash::max_distance_for(30), 10);
+    CHECK_EQ(simhash::max_distance_for(1000), SimHashIndex::kMaxSupportedDistance);
+}
+
+void test_find_nearest() {
+    SimHashIndex index;
+    NearDuplicateMatch match;
+    const uint64_t base = 0x0123456789abcdefull;
+    CHECK(!index.find(base, &match));
+
+    index.insert(flipped(base, 6), true, 0.9f);
+    index.insert(flipped(base, 2), false, 0.8f);
+    index.insert(~base, true, 0.7f);
+    CHECK_EQ(index.size(), 3u);
+
+    CHECK(index.find(base, &match));
+    CHECK(!match.is_productive);
+    CHECK_EQ(match.confidence, 0.8f);
+    CHECK_EQ(match.distance, 2);
+
+    // A tighter per-lookup distance rejects both
+    CHECK(!index.find(base, &match, 1));
+    // The index's own distance is never loosened
+    CHECK(!index.find(flipped(base, 2) ^ 0x00000000fff00000ull, &match, 40));
+
+    // An exact duplicate is refreshed in place
+    index.insert(flipped(base, 2), true, 0.95f);
+    CHECK_EQ(index.size(), 3u);
+    CHECK(index.find(base, &match));
+    CHECK(match.is_productive);
+    CHECK_EQ(match.confidence, 0.95f);
+
+    index.clear();
+    CHECK_EQ(index.size(), 0u);
+    CHECK(!index.find(base, &match));
+}
+
+void test_capacity_overwrites_oldest() {
+    SimHashIndex index(2);
+    NearDuplicateMatch match;
+    index.insert(0x1111000000000000ull, true, 0.9f);
+    index.insert(0x0000111100000000ull, true, 0.9f);
+    index.insert(0x0000000011110000ull, false, 0.9f);
+    CHECK_EQ(index.size(), 2u);
+    CHECK(!index.find(0x1111000000000000ull, &match, 0));
+    CHECK(index.find(0x0000111100000000ull, &match, 0));
+    CHECK(index.find(0x0000000011110000ull, &match, 0));
+}
+
+void test_erase_near() {
+    SimHashIndex index;
+    NearDuplicateMatch match;
+    const uint64_t base = 0x0f1e2d3c4b5a6978ull;
+    index.insert(base, false, 0.9f);
+    index.insert(flipped(base, 3), false, 0.8f);
+    index.insert(flipped(base, 8), false, 0.7f);
+    index.insert(~base, true, 0.6f);
+
+    // A correction drops what would be served for the text and its close edits
+    CHECK_EQ(index.erase_near(base, 4), 2u);
+    CHECK_EQ(index.size(), 2u);
+    CHECK(!index.find(base, &match, 4));
+    CHECK(index.find(base, &match));
+    CHECK_EQ(match.distance, 8);
+    CHECK(index.find(~base, &match, 0));
+
+    index.insert(base, true, 1.0f);
+    CHECK(index.find(flipped(base, 3), &match));
+    CHECK(match.is_productive);
+    CHECK_EQ(match.distance, 3);
+    CHECK_EQ(index.erase_near(0x5555555555555555ull, 2), 0u);
+
+    // Erased slots are refilled without disturbing the rest
+    for (int i = 0; i < 8; i++) {
+        index.insert(0x1000000000000000ull * static_cast<uint64_t>(i + 1), true, 0.5f);
+    }
+    CHECK_EQ(index.size(), 11u);
+    CHECK(index.find(~base, &match, 0));
+}
+
+} // namespace
+
+int main() {
+    test_fingerprints();
+    test_find_nearest();
+    test_capacity_overwrites_oldest();
+    test_erase_near();
+    std::printf("simhash_index_test passed\n");
+    return 0;
+}
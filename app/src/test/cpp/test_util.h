@@ -0,0 +1,41 @@
+#ifndef SCROLLGUARD_TEST_UTIL_H
+#define SCROLLGUARD_TEST_UTIL_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Minimal assertions for the host-side native tests: a failed check prints
+ * its location and exits non-zero so ctest reports the test as failed.
+ */
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                               \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+namespace scrollguard {
+namespace test {
+
+// Fresh scratch directory under TMPDIR, removed by the OS or the next run
+inline std::string make_temp_dir(const char* name) {
+    const char* base = std::getenv("TMPDIR");
+    std::string pattern = std::string(base ? base : "/tmp") + "/" + name + "-XXXXXX";
+    if (!mkdtemp(&pattern[0])) {
+        std::perror("mkdtemp");
+        std::exit(1);
+    }
+    return pattern;
+}
+
+} // namespace test
+} // namespace scrollguard
+
+#endif // SCROLLGUARD_TEST_UTIL_H